@@ -73,6 +73,14 @@ static const struct number_limit valid_uint16 = {
     0, UINT16_MAX
 };
 
+static const struct number_limit valid_radius_window = {
+    1, UINT8_MAX
+};
+
+static const struct number_limit valid_eap_tls_threads = {
+    0, 64
+};
+
 static const struct number_limit valid_gtk_new_install_required = {
     0, 100
 };
@@ -511,9 +519,14 @@ static void parse_config_line(struct wsbrd_conf *config, struct storage_parse_in
         { "ipv6_prefix",                   &config->ipv6_prefix,                      conf_set_netmask,     NULL },
         { "storage_prefix",                config->storage_prefix,                    conf_set_string,      (void *)sizeof(config->storage_prefix) },
         { "trace",                         &g_enabled_traces,                         conf_set_flags,       &valid_traces },
+        { "log_level",                     &g_log_level,                              conf_set_enum,        &valid_log_levels },
+        { "log_buffer_size",               &config->log_buffer_size,                  conf_set_number,      &valid_unsigned },
         { "internal_dhcp",                 &config->internal_dhcp,                    conf_set_bool,        NULL },
         { "radius_server",                 &config->radius_server,                    conf_set_netaddr,     NULL },
         { "radius_secret",                 config->radius_secret,                     conf_set_string,      (void *)sizeof(config->radius_secret) },
+        { "eapol_max_full_auth",           &config->eapol_max_full_auth,              conf_set_number,      &valid_uint16 },
+        { "eapol_max_key_auth",            &config->eapol_max_key_auth,               conf_set_number,      &valid_uint16 },
+        { "radius_window",                 &config->radius_window,                    conf_set_number,      &valid_radius_window },
         { "key",                           &config->tls_own,                          conf_set_key,         NULL },
         { "certificate",                   &config->tls_own,                          conf_set_cert,        NULL },
         { "authority",                     &config->tls_ca,                           conf_set_cert,        NULL },
@@ -555,7 +568,18 @@ static void parse_config_line(struct wsbrd_conf *config, struct storage_parse_in
         { "async_frag_duration",           &config->ws_async_frag_duration,           conf_set_number,      &valid_async_frag_duration },
         { "lowpan_mtu",                    &config->lowpan_mtu,                       conf_set_number,      &valid_lowpan_mtu },
         { "pan_size",                      &config->pan_size,                         conf_set_number,      &valid_uint16 },
+        { "eap_tls_threads",               &config->eap_tls_threads,                  conf_set_number,      &valid_eap_tls_threads },
+        { "eap_tls_queue_size",            &config->eap_tls_queue_size,               conf_set_number,      &valid_positive },
+        { "eap_tls_session_cache_size",    &config->eap_tls_session_cache_size,       conf_set_number,      &valid_unsigned },
+        { "eap_tls_session_lifetime",      &config->eap_tls_session_lifetime,         conf_set_number,      &valid_unsigned },
         { "pcap_file",                     config->pcap_file,                         conf_set_string,      (void *)sizeof(config->pcap_file) },
+        { "pcap_buffer_size",              &config->pcap_buffer_size,                 conf_set_number,      &valid_unsigned },
+        { "pcap_flush_interval",           &config->pcap_flush_interval,              conf_set_number,      &valid_unsigned },
+        { "pcap_rotate_size",              &config->pcap_rotate_size,                 conf_set_number,      &valid_unsigned },
+        { "pcap_rotate_interval",          &config->pcap_rotate_interval,             conf_set_number,      &valid_unsigned },
+        { "pcap_rotate_count",             &config->pcap_rotate_count,                conf_set_number,      &valid_positive },
+        { "pcap_filter",                   config->pcap_filter,                       conf_set_string,      (void *)sizeof(config->pcap_filter) },
+        { "dbus_nodes_signal_interval",    &config->dbus_nodes_signal_interval,       conf_set_number,      &valid_unsigned },
     };
     int i;
 
@@ -647,6 +671,14 @@ void parse_commandline(struct wsbrd_conf *config, int argc, char *argv[],
     config->ws_regional_regulation = 0;
     config->ws_async_frag_duration = 500;
     config->pan_size = -1;
+    config->eap_tls_queue_size = 32;
+    config->eap_tls_session_cache_size = 256;
+    config->radius_window = 32;
+    config->log_buffer_size = 262144;
+    config->pcap_buffer_size = 65536;
+    config->pcap_flush_interval = 1;
+    config->pcap_rotate_count = 2;
+    config->dbus_nodes_signal_interval = 1000;
     strcpy(config->storage_prefix, "/var/lib/wsbrd/");
     memset(config->ws_allowed_channels, 0xFF, sizeof(config->ws_allowed_channels));
     while ((opt = getopt_long(argc, argv, opts_short, opts_long, NULL)) != -1) {
@@ -801,6 +833,8 @@ void parse_commandline(struct wsbrd_conf *config, int argc, char *argv[],
         FATAL(1, "\"phy_operating_modes\" depends on \"phy_mode_id\"");
     if (config->bc_interval < config->bc_dwell_interval)
         FATAL(1, "broadcast interval %d can't be lower than broadcast dwell interval %d", config->bc_interval, config->bc_dwell_interval);
+    if (config->log_buffer_size & (config->log_buffer_size - 1))
+        FATAL(1, "\"log_buffer_size\" must be a power of 2");
     if (config->ws_allowed_mac_address_count > 0 && config->ws_denied_mac_address_count > 0)
         FATAL(1, "allowed_mac64 and denied_mac64 are exclusive");
     if (storage_check_access(config->storage_prefix))
@@ -27,6 +27,7 @@
 struct wsbrd_conf {
     bool list_rf_configs;
     int  color_output;
+    int  log_buffer_size;
 
     char cpc_instance[PATH_MAX];
 
@@ -72,6 +73,9 @@ struct wsbrd_conf {
     bool ws_lgtk_force[4];
     struct sockaddr_storage radius_server;
     char radius_secret[256];
+    int radius_window;
+    int eapol_max_full_auth;
+    int eapol_max_key_auth;
 
     int  tx_power;
     int  ws_fan_version;
@@ -100,7 +104,18 @@ struct wsbrd_conf {
 
     int lowpan_mtu;
     int pan_size;
+    int eap_tls_threads;
+    int eap_tls_queue_size;
+    int eap_tls_session_cache_size;
+    int eap_tls_session_lifetime;
     char pcap_file[PATH_MAX];
+    int pcap_buffer_size;
+    int pcap_flush_interval;
+    int pcap_rotate_size;
+    int pcap_rotate_interval;
+    int pcap_rotate_count;
+    char pcap_filter[256];
+    int dbus_nodes_signal_interval;
 };
 
 void print_help_br(FILE *stream);
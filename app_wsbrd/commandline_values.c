@@ -88,6 +88,14 @@ const struct name_value valid_traces[] = {
     { NULL },
 };
 
+const struct name_value valid_log_levels[] = {
+    { "debug",   LOG_LEVEL_DEBUG },
+    { "info",    LOG_LEVEL_INFO },
+    { "warning", LOG_LEVEL_WARN },
+    { "error",   LOG_LEVEL_ERROR },
+    { NULL },
+};
+
 const struct name_value valid_tristate[] = {
     { "auto",    -1 },
     { "true",    1 },
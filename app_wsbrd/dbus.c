@@ -13,6 +13,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <pthread.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <systemd/sd-bus.h>
 #include <netinet/in.h>
@@ -27,6 +28,7 @@
 #include "meter_collector/wisun_meter_collector.h"
 #include "meter_collector/wisun_meter_collector_config.h"
 
+#include "stack/source/6lowpan/iphc_decode/iphc_compress.h"
 #include "stack/source/6lowpan/ws/ws_common.h"
 #include "stack/source/6lowpan/ws/ws_pae_controller.h"
 #include "stack/source/6lowpan/ws/ws_pae_key_storage.h"
@@ -37,12 +39,15 @@
 #include "stack/source/6lowpan/ws/ws_llc.h"
 #include "stack/source/nwk_interface/protocol.h"
 #include "stack/source/security/protocols/sec_prot_keys.h"
+#include "stack/source/security/protocols/tls_sec_prot/tls_sec_prot_lib.h"
 #include "stack/source/common_protocols/icmpv6.h"
+#include "stack/source/ipv6_stack/ipv6_routing_table.h"
 #include "stack/stack/ws_management_api.h"
 
 #include "commandline_values.h"
 #include "rcp_api.h"
 #include "wsbr.h"
+#include "wsbr_nodes.h"
 #include "tun.h"
 
 #include "dbus.h"
@@ -367,12 +372,116 @@ static int dbus_install_lgtk(sd_bus_message *m, void *userdata, sd_bus_error *re
     return dbus_install_group_key(m, userdata, ret_error, true);
 }
 
+static int dbus_set_pcap_filter(sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
+{
+    struct wsbr_ctxt *ctxt = userdata;
+    const char *expr;
+    int ret;
+
+    ret = sd_bus_message_read_basic(m, 's', &expr);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+    if (!ctxt->config.pcap_file[0])
+        return sd_bus_error_set_errno(ret_error, ENOTSUP);
+    ret = wsbr_pcapng_filter_set(ctxt, expr);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+    sd_bus_emit_properties_changed(ctxt->dbus,
+                       "/com/silabs/Wisun/BorderRouter",
+                       "com.silabs.Wisun.BorderRouter",
+                       "PcapFilter", NULL);
+    sd_bus_reply_method_return(m, NULL);
+    return 0;
+}
+
+static void dbus_emit_nodes_changed_signal(struct wsbr_ctxt *ctxt)
+{
+    struct wsbr_nodes_page page;
+    sd_bus_message *m;
+    int ret;
+
+    ret = wsbr_nodes_get_since(ctxt, ctxt->dbus_nodes_generation, NULL, 0, &page);
+    if (ret < 0)
+        return;
+    if (page.generation == ctxt->dbus_nodes_generation) {
+        free(page.entries);
+        return;
+    }
+    ctxt->dbus_nodes_generation = page.generation;
+
+    ret = sd_bus_message_new_signal(ctxt->dbus, &m,
+                                    "/com/silabs/Wisun/BorderRouter",
+                                    "com.silabs.Wisun.BorderRouter",
+                                    "NodesChanged");
+    if (ret < 0) {
+        WARN("%s: %s", __func__, strerror(-ret));
+        free(page.entries);
+        return;
+    }
+    ret = sd_bus_message_append(m, "u", page.generation);
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    for (int removed = 0; removed <= 1; removed++) {
+        ret = sd_bus_message_open_container(m, 'a', "ay");
+        WARN_ON(ret < 0, "%s", strerror(-ret));
+        for (int i = 0; i < page.len; i++) {
+            if (page.entries[i]->is_removed != removed)
+                continue;
+            ret = sd_bus_message_append_array(m, 'y', page.entries[i]->node.eui64, 8);
+            WARN_ON(ret < 0, "%s", strerror(-ret));
+        }
+        ret = sd_bus_message_close_container(m);
+        WARN_ON(ret < 0, "%s", strerror(-ret));
+    }
+    free(page.entries);
+    ret = sd_bus_send(ctxt->dbus, m, NULL);
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    sd_bus_message_unref(m);
+}
+
+static uint64_t dbus_now_ms(void)
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000 + tp.tv_nsec / 1000000;
+}
+
+/*
+ * The nodes change on many RPL, PAE and DHCP events, especially during the
+ * network formation. The first change is signaled on the next timer tick, so
+ * the stack is done with the current event. The following ones are coalesced
+ * until dbus_nodes_signal_interval has elapsed.
+ */
 void dbus_emit_nodes_change(struct wsbr_ctxt *ctxt)
 {
+    if (!ctxt->dbus)
+        return;
+    ctxt->dbus_nodes_pending = true;
+    if (!ctxt->dbus_nodes_deadline)
+        ctxt->dbus_nodes_deadline = dbus_now_ms();
+}
+
+void dbus_nodes_timer(struct wsbr_ctxt *ctxt)
+{
+    uint64_t now;
+
+    if (!ctxt->dbus_nodes_deadline)
+        return;
+    now = dbus_now_ms();
+    if (now < ctxt->dbus_nodes_deadline)
+        return;
+    // Nothing changed during the last interval
+    if (!ctxt->dbus_nodes_pending) {
+        ctxt->dbus_nodes_deadline = 0;
+        return;
+    }
+    ctxt->dbus_nodes_pending = false;
+    dbus_emit_nodes_changed_signal(ctxt);
     sd_bus_emit_properties_changed(ctxt->dbus,
                        "/com/silabs/Wisun/BorderRouter",
                        "com.silabs.Wisun.BorderRouter",
                        "Nodes", NULL);
+    ctxt->dbus_nodes_deadline = now + ctxt->config.dbus_nodes_signal_interval;
 }
 
 static int dbus_message_open_info(sd_bus_message *m, const char *property,
@@ -400,32 +509,20 @@ static int dbus_message_close_info(sd_bus_message *m, const char *property)
     return ret;
 }
 
-struct neighbor_info {
-    int rssi;
-    int rsl;
-    int rsl_adv;
-};
-
-static int dbus_message_append_node(
-    sd_bus_message *m,
-    const char *property,
-    const uint8_t self[8],
-    const uint8_t parent[8],
-    const uint8_t ipv6[][16],
-    bool is_br,
-    supp_entry_t *supp,
-    struct neighbor_info *neighbor)
+static int dbus_message_append_node(sd_bus_message *m, const char *property,
+                                    const struct wsbr_node *node)
 {
+    const uint8_t (*ipv6)[16] = node->ipv6;
     int ret, val;
 
     ret = sd_bus_message_open_container(m, 'r', "aya{sv}");
     WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
-    ret = sd_bus_message_append_array(m, 'y', self, 8);
+    ret = sd_bus_message_append_array(m, 'y', node->eui64, 8);
     WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
     ret = sd_bus_message_open_container(m, 'a', "{sv}");
     WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
     {
-        if (is_br) {
+        if (node->is_br) {
             dbus_message_open_info(m, property, "is_border_router", "b");
             ret = sd_bus_message_append(m, "b", true);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
@@ -435,43 +532,43 @@ static int dbus_message_append_node(
             ret = sd_bus_message_append(m, "y", WS_NR_ROLE_BR);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
             dbus_message_close_info(m, property);
-        } else if (supp) {
+        } else if (node->is_authenticated) {
             dbus_message_open_info(m, property, "is_authenticated", "b");
             val = true;
             ret = sd_bus_message_append(m, "b", val);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
             dbus_message_close_info(m, property);
-            if (ws_common_is_valid_nr(supp->sec_keys.node_role)) {
+            if (ws_common_is_valid_nr(node->node_role)) {
                 dbus_message_open_info(m, property, "node_role", "y");
-                ret = sd_bus_message_append(m, "y", supp->sec_keys.node_role);
+                ret = sd_bus_message_append(m, "y", node->node_role);
                 WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
                 dbus_message_close_info(m, property);
             }
         }
-        if (parent) {
+        if (node->has_parent) {
             dbus_message_open_info(m, property, "parent", "ay");
-            ret = sd_bus_message_append_array(m, 'y', parent, 8);
+            ret = sd_bus_message_append_array(m, 'y', node->parent, 8);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
             dbus_message_close_info(m, property);
         }
-        if (neighbor) {
+        if (node->is_neighbor) {
             dbus_message_open_info(m, property, "is_neighbor", "b");
             ret = sd_bus_message_append(m, "b", true);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
             dbus_message_close_info(m, property);
             dbus_message_open_info(m, property, "rssi", "i");
-            ret = sd_bus_message_append_basic(m, 'i', &neighbor->rssi);
+            ret = sd_bus_message_append_basic(m, 'i', &node->rssi);
             WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
             dbus_message_close_info(m, property);
-            if (neighbor->rsl != INT_MIN) {
+            if (node->rsl != INT_MIN) {
                 dbus_message_open_info(m, property, "rsl", "i");
-                ret = sd_bus_message_append_basic(m, 'i', &neighbor->rsl);
+                ret = sd_bus_message_append_basic(m, 'i', &node->rsl);
                 WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
                 dbus_message_close_info(m, property);
             }
-            if (neighbor->rsl_adv != INT_MIN) {
+            if (node->rsl_adv != INT_MIN) {
                 dbus_message_open_info(m, property, "rsl_adv", "i");
-                ret = sd_bus_message_append_basic(m, 'i', &neighbor->rsl_adv);
+                ret = sd_bus_message_append_basic(m, 'i', &node->rsl_adv);
                 WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
                 dbus_message_close_info(m, property);
             }
@@ -494,116 +591,91 @@ static int dbus_message_append_node(
     return ret;
 }
 
-static uint8_t *dhcp_eui64_to_ipv6(struct wsbr_ctxt *ctxt, const uint8_t eui64[8])
-{
-    for (int i = 0; i < ctxt->dhcp_leases_len; i++)
-        if (!memcmp(eui64, ctxt->dhcp_leases[i].eui64, 8))
-            return ctxt->dhcp_leases[i].ipv6;
-    return NULL;
-}
-
-static uint8_t *dhcp_ipv6_to_eui64(struct wsbr_ctxt *ctxt, const uint8_t ipv6[16])
+int dbus_get_nodes(sd_bus *bus, const char *path, const char *interface,
+                       const char *property, sd_bus_message *reply,
+                       void *userdata, sd_bus_error *ret_error)
 {
-    for (int i = 0; i < ctxt->dhcp_leases_len; i++)
-        if (!memcmp(ipv6, ctxt->dhcp_leases[i].ipv6, 16))
-            return ctxt->dhcp_leases[i].eui64;
-    return NULL;
-}
+    struct wsbr_ctxt *ctxt = userdata;
+    struct wsbr_node *nodes;
+    int len, ret;
 
-static bool dbus_get_neighbor_info(struct wsbr_ctxt *ctxt, struct neighbor_info *info, const uint8_t eui64[8])
-{
-    struct net_if *net_if = protocol_stack_interface_info_get_by_id(ctxt->rcp_if_id);
-    ws_neighbor_class_entry_t *neighbor_ws = NULL;
-    ws_neighbor_temp_class_t *neighbor_ws_tmp;
-    llc_neighbour_req_t neighbor_llc;
+    len = wsbr_nodes_get(ctxt, &nodes);
+    if (len < 0)
+        return sd_bus_error_set_errno(ret_error, -len);
 
-    neighbor_ws_tmp = ws_llc_get_eapol_temp_entry(net_if, eui64);
-    if (!neighbor_ws_tmp)
-        neighbor_ws_tmp = ws_llc_get_multicast_temp_entry(net_if, eui64);
-    if (neighbor_ws_tmp) {
-        neighbor_ws = &neighbor_ws_tmp->neigh_info_list;
-        neighbor_ws->rssi = neighbor_ws_tmp->signal_dbm;
-    }
-    if (!neighbor_ws) {
-        if (ws_bootstrap_neighbor_get(net_if, eui64, &neighbor_llc))
-            neighbor_ws = neighbor_llc.ws_neighbor;
-        else
-            return false;
-    }
-    info->rssi = neighbor_ws->rssi;
-    info->rsl = neighbor_ws->rsl_in == RSL_UNITITIALIZED
-              ? INT_MIN
-              : -174 + ws_neighbor_class_rsl_in_get(neighbor_ws);
-    info->rsl_adv = neighbor_ws->rsl_in == RSL_UNITITIALIZED
-                  ? INT_MIN
-                  : -174 + ws_neighbor_class_rsl_out_get(neighbor_ws);
-    return true;
+    ret = sd_bus_message_open_container(reply, 'a', "(aya{sv})");
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    for (int i = 0; i < len; i++)
+        dbus_message_append_node(reply, property, &nodes[i]);
+    ret = sd_bus_message_close_container(reply);
+    WARN_ON(ret < 0, "d %s: %s", property, strerror(-ret));
+    free(nodes);
+    return 0;
 }
 
-int dbus_get_nodes(sd_bus *bus, const char *path, const char *interface,
-                       const char *property, sd_bus_message *reply,
-                       void *userdata, sd_bus_error *ret_error)
+static int dbus_get_nodes_since(sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
 {
-    struct neighbor_info *neighbor_info_ptr;
-    struct neighbor_info neighbor_info;
     struct wsbr_ctxt *ctxt = userdata;
-    uint8_t node_ipv6[3][16] = { 0 };
-    bbr_route_info_t table[4096];
-    uint8_t *parent, *ucast_addr;
-    int len_pae, len_rpl, ret, j;
-    uint8_t eui64_pae[4096][8];
-    bbr_information_t br_info;
-    supp_entry_t *supp;
-    uint8_t ipv6[16];
-
-    ret = ws_bbr_info_get(ctxt->rcp_if_id, &br_info);
-    if (ret)
-        return sd_bus_error_set_errno(ret_error, EAGAIN);
-    len_pae = ws_pae_auth_supp_list(ctxt->rcp_if_id, eui64_pae, sizeof(eui64_pae));
-    len_rpl = ws_bbr_routing_table_get(ctxt->rcp_if_id, table, ARRAY_SIZE(table));
-    if (len_rpl < 0)
-        return sd_bus_error_set_errno(ret_error, EAGAIN);
+    struct wsbr_nodes_page page;
+    sd_bus_message *reply;
+    const uint8_t *cursor;
+    size_t cursor_len;
+    uint32_t since, max;
+    int ret;
+
+    ret = sd_bus_message_read_basic(m, 'u', &since);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+    ret = sd_bus_message_read_array(m, 'y', (const void **)&cursor, &cursor_len);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+    ret = sd_bus_message_read_basic(m, 'u', &max);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+    if (cursor_len == 0)
+        cursor = NULL;
+    else if (cursor_len != 8)
+        return sd_bus_error_set_errno(ret_error, EINVAL);
+    if (max > INT_MAX)
+        return sd_bus_error_set_errno(ret_error, EINVAL);
 
+    ret = wsbr_nodes_get_since(ctxt, since, cursor, max, &page);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
+
+    ret = sd_bus_message_new_method_return(m, &reply);
+    if (ret < 0) {
+        free(page.entries);
+        return sd_bus_error_set_errno(ret_error, -ret);
+    }
+    ret = sd_bus_message_append(reply, "ub", page.generation, page.is_full);
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    ret = sd_bus_message_append_array(reply, 'y', page.has_more ? page.entries[page.len - 1]->node.eui64 : NULL,
+                                      page.has_more ? 8 : 0);
+    WARN_ON(ret < 0, "%s", strerror(-ret));
     ret = sd_bus_message_open_container(reply, 'a', "(aya{sv})");
-    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
-    tun_addr_get_link_local(ctxt->config.tun_dev, node_ipv6[0]);
-    tun_addr_get_global_unicast(ctxt->config.tun_dev, node_ipv6[1]);
-    dbus_message_append_node(reply, property, ctxt->rcp.eui64, NULL,
-                             node_ipv6, true, false, NULL);
-
-    for (int i = 0; i < len_pae; i++) {
-        memcpy(node_ipv6[0], ADDR_LINK_LOCAL_PREFIX, 8);
-        memcpy(node_ipv6[0] + 8, eui64_pae[i], 8);
-        memcpy(node_ipv6[1], ADDR_UNSPECIFIED, 16);
-        parent = NULL;
-        ucast_addr = dhcp_eui64_to_ipv6(ctxt, eui64_pae[i]);
-        if (ucast_addr) {
-            memcpy(node_ipv6[1], ucast_addr, 16);
-            for (j = 0; j < len_rpl; j++)
-                if (!memcmp(table[j].target, node_ipv6[1] + 8, 8))
-                    break;
-            if (j != len_rpl) {
-                memcpy(ipv6, br_info.prefix, 8);
-                memcpy(ipv6 + 8, table[j].parent, 8);
-                parent = dhcp_ipv6_to_eui64(ctxt, ipv6);
-                WARN_ON(!parent, "RPL parent not in DHCP leases (%s)", tr_ipv6(ipv6));
-            }
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    for (int i = 0; i < page.len; i++)
+        if (!page.entries[i]->is_removed)
+            dbus_message_append_node(reply, "GetNodesSince", &page.entries[i]->node);
+    ret = sd_bus_message_close_container(reply);
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    ret = sd_bus_message_open_container(reply, 'a', "ay");
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    for (int i = 0; i < page.len; i++) {
+        if (page.entries[i]->is_removed) {
+            ret = sd_bus_message_append_array(reply, 'y', page.entries[i]->node.eui64, 8);
+            WARN_ON(ret < 0, "%s", strerror(-ret));
         }
-        if (dbus_get_neighbor_info(ctxt, &neighbor_info, eui64_pae[i]))
-            neighbor_info_ptr = &neighbor_info;
-        else
-            neighbor_info_ptr = NULL;
-        if (ws_pae_key_storage_supp_exists(eui64_pae[i]))
-            supp = ws_pae_key_storage_supp_read(NULL, eui64_pae[i], NULL, NULL, NULL);
-        else
-            supp = NULL;
-        dbus_message_append_node(reply, property, eui64_pae[i], parent, node_ipv6,
-                                 false, supp, neighbor_info_ptr);
-        if (supp)
-            free(supp);
     }
     ret = sd_bus_message_close_container(reply);
-    WARN_ON(ret < 0, "d %s: %s", property, strerror(-ret));
+    WARN_ON(ret < 0, "%s", strerror(-ret));
+    free(page.entries);
+
+    ret = sd_bus_send(NULL, reply, NULL);
+    sd_bus_message_unref(reply);
+    if (ret < 0)
+        return sd_bus_error_set_errno(ret_error, -ret);
     return 0;
 }
 
@@ -619,6 +691,76 @@ int dbus_get_hw_address(sd_bus *bus, const char *path, const char *interface,
     return 0;
 }
 
+static int dbus_get_eap_tls_sessions(sd_bus *bus, const char *path, const char *interface,
+                                     const char *property, sd_bus_message *reply,
+                                     void *userdata, sd_bus_error *ret_error)
+{
+    uint32_t hits, misses;
+    int ret;
+
+    tls_sec_prot_lib_sessions_stats(&hits, &misses);
+    ret = sd_bus_message_append(reply, "(uu)", hits, misses);
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    return 0;
+}
+
+static int dbus_get_pae_auth_stats(sd_bus *bus, const char *path, const char *interface,
+                                   const char *property, sd_bus_message *reply,
+                                   void *userdata, sd_bus_error *ret_error)
+{
+    int interface_id = *(int *)userdata;
+    uint32_t full_handshake, pmk_reuse;
+    int ret;
+
+    ws_pae_auth_stats(interface_id, &full_handshake, &pmk_reuse);
+    ret = sd_bus_message_append(reply, "(uu)", full_handshake, pmk_reuse);
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    return 0;
+}
+
+static int dbus_get_ip_cache_stats(sd_bus *bus, const char *path, const char *interface,
+                                   const char *property, sd_bus_message *reply,
+                                   void *userdata, sd_bus_error *ret_error)
+{
+    struct ipv6_cache_stats stats;
+    int ret;
+
+    ipv6_cache_stats(&stats);
+    ret = sd_bus_message_append(reply, "(uuuuuu)",
+                                stats.ncache_size, stats.ncache_peak, stats.ncache_chain_max,
+                                stats.dcache_size, stats.dcache_peak, stats.dcache_chain_max);
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    return 0;
+}
+
+static int dbus_get_iphc_flow_cache_stats(sd_bus *bus, const char *path, const char *interface,
+                                          const char *property, sd_bus_message *reply,
+                                          void *userdata, sd_bus_error *ret_error)
+{
+    uint32_t hits, misses;
+    int ret;
+
+    iphc_flow_cache_stats(&hits, &misses);
+    ret = sd_bus_message_append(reply, "(uu)", hits, misses);
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    return 0;
+}
+
+static int dbus_get_dhcp_server_stats(sd_bus *bus, const char *path, const char *interface,
+                                      const char *property, sd_bus_message *reply,
+                                      void *userdata, sd_bus_error *ret_error)
+{
+    struct dhcp_server_stats *stats = userdata;
+    int ret;
+
+    ret = sd_bus_message_append(reply, "(uuuuu)",
+                                stats->rx_count, stats->tx_count,
+                                stats->rx_batch_count, stats->rx_batch_max,
+                                stats->rx_overrun_count);
+    WARN_ON(ret < 0, "%s: %s", property, strerror(-ret));
+    return 0;
+}
+
 int dbus_get_ws_pan_id(sd_bus *bus, const char *path, const char *interface,
                        const char *property, sd_bus_message *reply,
                        void *userdata, sd_bus_error *ret_error)
@@ -1682,6 +1824,11 @@ static const sd_bus_vtable dbus_vtable[] = {
                       dbus_install_gtk, 0),
         SD_BUS_METHOD("InstallLgtk", "ay", NULL,
                       dbus_install_lgtk, 0),
+        SD_BUS_METHOD("SetPcapFilter", "s", NULL,
+                      dbus_set_pcap_filter, 0),
+        SD_BUS_METHOD("GetNodesSince", "uayu", "ubaya(aya{sv})aay",
+                      dbus_get_nodes_since, 0),
+        SD_BUS_SIGNAL("NodesChanged", "uaayaay", 0),
         SD_BUS_PROPERTY("Gtks", "aay", dbus_get_gtks,
                         offsetof(struct wsbr_ctxt, rcp_if_id),
                         SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
@@ -1699,6 +1846,21 @@ static const sd_bus_vtable dbus_vtable[] = {
         SD_BUS_PROPERTY("HwAddress", "ay", dbus_get_hw_address,
                         offsetof(struct wsbr_ctxt, rcp.eui64),
                         0),
+        SD_BUS_PROPERTY("EapTlsSessions", "(uu)", dbus_get_eap_tls_sessions, 0,
+                        0),
+        SD_BUS_PROPERTY("PaeAuthStats", "(uu)", dbus_get_pae_auth_stats,
+                        offsetof(struct wsbr_ctxt, rcp_if_id),
+                        0),
+        SD_BUS_PROPERTY("IpCacheStats", "(uuuuuu)", dbus_get_ip_cache_stats, 0,
+                        0),
+        SD_BUS_PROPERTY("IphcFlowCacheStats", "(uu)", dbus_get_iphc_flow_cache_stats, 0,
+                        0),
+        SD_BUS_PROPERTY("DhcpServerStats", "(uuuuu)", dbus_get_dhcp_server_stats,
+                        offsetof(struct wsbr_ctxt, dhcp_server.stats),
+                        0),
+        SD_BUS_PROPERTY("PcapFilter", "s", dbus_get_string,
+                        offsetof(struct wsbr_ctxt, pcapng_filter.expr),
+                        SD_BUS_VTABLE_PROPERTY_EMITS_CHANGE),
         SD_BUS_PROPERTY("WisunNetworkName", "s", dbus_get_string,
                         offsetof(struct wsbr_ctxt, config.ws_name),
                         SD_BUS_VTABLE_PROPERTY_CONST),
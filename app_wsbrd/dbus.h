@@ -19,6 +19,8 @@ struct wsbr_ctxt;
 
 void dbus_emit_keys_change(struct wsbr_ctxt *ctxt);
 void dbus_emit_nodes_change(struct wsbr_ctxt *ctxt);
+// Called on each tick of the main loop timer
+void dbus_nodes_timer(struct wsbr_ctxt *ctxt);
 void dbus_register(struct wsbr_ctxt *ctxt);
 int dbus_get_fd(struct wsbr_ctxt *ctxt);
 int dbus_process(struct wsbr_ctxt *ctxt);
@@ -36,6 +38,10 @@ static inline void dbus_emit_nodes_change(struct wsbr_ctxt *ctxt)
     /* empty */
 }
 
+static inline void dbus_nodes_timer(struct wsbr_ctxt *ctxt)
+{
+}
+
 static inline void dbus_register(struct wsbr_ctxt *ctxt)
 {
     WARN("support for DBus is disabled");
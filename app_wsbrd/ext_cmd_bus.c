@@ -16,6 +16,7 @@
 #include <arpa/inet.h>
 #include <systemd/sd-bus.h>
 #include "app_wsbrd/tun.h"
+#include "common/endian.h"
 #include "common/named_values.h"
 #include "common/utils.h"
 #include "common/log.h"
@@ -41,6 +42,7 @@
 
 #include "commandline_values.h"
 #include "wsbr.h"
+#include "wsbr_nodes.h"
 #include "tun.h"
 
 #include "ext_cmd_bus.h" 
@@ -90,6 +92,52 @@ static void ext_rx_no_op(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_rea
 {
 }
 
+// Return the format asked by the requester, or the latest one we support
+static uint8_t ext_pop_format(struct iobuf_read *buf, uint32_t default_mask, uint32_t *mask)
+{
+    uint8_t version;
+
+    if (!iobuf_remaining_size(buf))
+        return EXT_FORMAT_LABELED;
+    version = spinel_pop_u8(buf);
+    if (version == EXT_FORMAT_LABELED)
+        return EXT_FORMAT_LABELED;
+    *mask = iobuf_remaining_size(buf) ? spinel_pop_u32(buf) : default_mask;
+    if (buf->err)
+        return EXT_FORMAT_LABELED;
+    return MIN(version, EXT_FORMAT_TLV_DELTA);
+}
+
+static void ext_push_format(struct iobuf_write *buf, uint8_t version, uint32_t mask)
+{
+    spinel_push_u8(buf, version);
+    spinel_push_u32(buf, mask);
+}
+
+static void ext_push_field(struct iobuf_write *buf, uint32_t mask, uint8_t id, const void *val, uint8_t len)
+{
+    if (!(mask & (1u << id)))
+        return;
+    iobuf_push_u8(buf, id);
+    iobuf_push_u8(buf, len);
+    iobuf_push_data(buf, val, len);
+}
+
+static void ext_push_field_le16(struct iobuf_write *buf, uint32_t mask, uint8_t id, uint16_t val)
+{
+    uint8_t tmp[2];
+
+    write_le16(tmp, val);
+    ext_push_field(buf, mask, id, tmp, sizeof(tmp));
+}
+
+static void ext_push_record(struct iobuf_write *buf, struct iobuf_write *record)
+{
+    spinel_push_uint(buf, record->len);
+    iobuf_push_data(buf, record->data, record->len);
+    record->len = 0;
+}
+
 /* 
  * response to external get_wisun_status command:
  *  network_name,   char*33
@@ -104,6 +152,33 @@ static void ext_rx_no_op(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_rea
  *  gtk[3]:         u8*16
  *  gak[3]:         u8*16
  */
+static void exp_get_wisun_status_tlv(struct wsbr_ctxt *ctxt, struct iobuf_write *tx_buf, uint32_t mask)
+{
+    struct net_if *interface_ptr = protocol_stack_interface_info_get_by_id(ctxt->rcp_if_id);
+    sec_prot_gtk_keys_t *gtks = ws_pae_controller_get_transient_keys(ctxt->rcp_if_id, false);
+    uint8_t gtk[GTK_NUM][16], gak[GTK_NUM][16];
+    struct iobuf_write record = { };
+    uint8_t tmp[4];
+
+    ext_push_format(tx_buf, EXT_FORMAT_TLV, mask);
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_NETWORK_NAME, ctxt->config.ws_name, strlen(ctxt->config.ws_name));
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_FAN_VERSION, &(uint8_t){ ctxt->config.ws_fan_version }, 1);
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_DOMAIN, &(uint8_t){ ctxt->config.ws_domain }, 1);
+    write_le32(tmp, ctxt->config.ws_mode);
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_MODE, tmp, 4);
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_CLASS, &(uint8_t){ ctxt->config.ws_class }, 1);
+    ext_push_field_le16(&record, mask, EXT_STATUS_FIELD_PAN_ID, ctxt->config.ws_pan_id);
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_SIZE, &(uint8_t){ ctxt->config.ws_size }, 1);
+    for (int i = 0; i < GTK_NUM; i++) {
+        memcpy(gtk[i], gtks->gtk[i].key, 16);
+        ws_pae_controller_gak_from_gtk(gak[i], gtks->gtk[i].key, interface_ptr->ws_info.cfg->gen.network_name);
+    }
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_GTKS, gtk, sizeof(gtk));
+    ext_push_field(&record, mask, EXT_STATUS_FIELD_GAKS, gak, sizeof(gak));
+    ext_push_record(tx_buf, &record);
+    iobuf_free(&record);
+}
+
 static void exp_get_wisun_status(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_read *buf)
 {
     int interface_id = ctxt->rcp_if_id;
@@ -111,9 +186,16 @@ static void exp_get_wisun_status(struct wsbr_ctxt *ctxt, uint32_t prop, struct i
     uint8_t gak[16];
     struct net_if *interface_ptr = protocol_stack_interface_info_get_by_id(interface_id);
     sec_prot_gtk_keys_t *gtks = ws_pae_controller_get_transient_keys(interface_id, false);
+    uint32_t mask;
 
     WARN("-------send wisun status data through spinel");
     spinel_push_hdr_is_prop(&tx_buf, SPINEL_PROP_EXT_WisunStatus);
+    if (ext_pop_format(buf, UINT32_MAX, &mask) != EXT_FORMAT_LABELED) {
+        exp_get_wisun_status_tlv(ctxt, &tx_buf, mask);
+        ext_cmd_tx(ctxt, &tx_buf);
+        iobuf_free(&tx_buf);
+        return;
+    }
     spinel_push_str( &tx_buf, ctxt->config.ws_name);
     spinel_push_uint(&tx_buf, ctxt->config.ws_fan_version);
     spinel_push_uint(&tx_buf, ctxt->config.ws_domain);
@@ -132,12 +214,6 @@ static void exp_get_wisun_status(struct wsbr_ctxt *ctxt, uint32_t prop, struct i
 
 }
 
-struct neighbor_info {
-    int rssi;
-    int rsl;
-    int rsl_adv;
-};
-
 /* spinel push a fixed 20 length char string */
 void spinel_push_string(struct iobuf_write *buf, const char *val)
 {
@@ -146,43 +222,37 @@ void spinel_push_string(struct iobuf_write *buf, const char *val)
     spinel_push_str(buf, attr_tag);
 }
 
-static void ext_message_append_node(
-    struct iobuf_write *buf,
-    const uint8_t self[8],
-    const uint8_t parent[8],
-    const uint8_t ipv6[3][16],
-    bool is_br,
-    supp_entry_t *supp,
-    struct neighbor_info *neighbor)
+static void ext_message_append_node(struct iobuf_write *buf, const struct wsbr_node *node)
 {
-    
+    const uint8_t (*ipv6)[16] = node->ipv6;
+
     spinel_push_string(buf, "node eui64");
-    spinel_push_fixed_u8_array(buf, self, 8);
-    
-    if (is_br) {
+    spinel_push_fixed_u8_array(buf, node->eui64, 8);
+
+    if (node->is_br) {
         spinel_push_string(buf, "isBorderRouter");
-    } else if (supp) {
+    } else if (node->is_authenticated) {
         spinel_push_string(buf, "isAuthenticated");
-        if (ws_common_is_valid_nr(supp->sec_keys.node_role)) {
+        if (ws_common_is_valid_nr(node->node_role)) {
             spinel_push_string(buf, "nodeRole");
-            spinel_push_u8(buf, supp->sec_keys.node_role);
+            spinel_push_u8(buf, node->node_role);
         }
     }
-    if (parent) {
+    if (node->has_parent) {
         spinel_push_string(buf, "parent eui64");
-        spinel_push_fixed_u8_array(buf, parent, 8);
+        spinel_push_fixed_u8_array(buf, node->parent, 8);
     }
-    if (neighbor) {
+    if (node->is_neighbor) {
         spinel_push_string(buf, "neighbor rssi");
-        spinel_push_uint(buf, neighbor->rssi);
-        
-        if (neighbor->rsl != INT_MIN) {
+        spinel_push_uint(buf, node->rssi);
+
+        if (node->rsl != INT_MIN) {
             spinel_push_string(buf, "neighbor rsl");
-            spinel_push_uint(buf, neighbor->rsl);
+            spinel_push_uint(buf, node->rsl);
         }
-        if (neighbor->rsl_adv != INT_MIN) {
+        if (node->rsl_adv != INT_MIN) {
             spinel_push_string(buf, "neighbor rsl_adv");
-            spinel_push_uint(buf, neighbor->rsl_adv);
+            spinel_push_uint(buf, node->rsl_adv);
         }
     }
     for (uint8_t index = 0; memcmp(*ipv6, ADDR_UNSPECIFIED, 16); ipv6++, index++) {
@@ -195,207 +265,179 @@ static void ext_message_append_node(
     }
 }
 
-static uint8_t *dhcp_eui64_to_ipv6(struct wsbr_ctxt *ctxt, const uint8_t eui64[8])
+static void ext_message_append_node_tlv(struct iobuf_write *record, const struct wsbr_node *node, uint32_t mask)
 {
-    for (int i = 0; i < ctxt->dhcp_leases_len; i++)
-        if (!memcmp(eui64, ctxt->dhcp_leases[i].eui64, 8))
-            return ctxt->dhcp_leases[i].ipv6;
-    return NULL;
+    uint8_t flags = 0;
+
+    if (node->is_br)
+        flags |= EXT_NODE_FLAG_BR;
+    if (node->is_authenticated)
+        flags |= EXT_NODE_FLAG_AUTHENTICATED;
+    if (node->is_neighbor)
+        flags |= EXT_NODE_FLAG_NEIGHBOR;
+    ext_push_field(record, mask | 1u << EXT_NODE_FIELD_EUI64, EXT_NODE_FIELD_EUI64, node->eui64, 8);
+    ext_push_field(record, mask, EXT_NODE_FIELD_FLAGS, &flags, 1);
+    if (ws_common_is_valid_nr(node->node_role))
+        ext_push_field(record, mask, EXT_NODE_FIELD_NODE_ROLE, &node->node_role, 1);
+    if (node->has_parent)
+        ext_push_field(record, mask, EXT_NODE_FIELD_PARENT, node->parent, 8);
+    if (node->is_neighbor) {
+        ext_push_field_le16(record, mask, EXT_NODE_FIELD_RSSI, node->rssi);
+        if (node->rsl != INT_MIN)
+            ext_push_field_le16(record, mask, EXT_NODE_FIELD_RSL, node->rsl);
+        if (node->rsl_adv != INT_MIN)
+            ext_push_field_le16(record, mask, EXT_NODE_FIELD_RSL_ADV, node->rsl_adv);
+    }
+    if (memcmp(node->ipv6[0], ADDR_UNSPECIFIED, 16))
+        ext_push_field(record, mask, EXT_NODE_FIELD_IPV6_LL, node->ipv6[0], 16);
+    if (memcmp(node->ipv6[1], ADDR_UNSPECIFIED, 16))
+        ext_push_field(record, mask, EXT_NODE_FIELD_IPV6_GUA, node->ipv6[1], 16);
 }
 
-static uint8_t *dhcp_ipv6_to_eui64(struct wsbr_ctxt *ctxt, const uint8_t ipv6[16])
+static void ext_message_append_nodes_tlv(struct iobuf_write *buf, const struct wsbr_node *nodes, int len,
+                                         uint32_t mask)
 {
-    for (int i = 0; i < ctxt->dhcp_leases_len; i++)
-        if (!memcmp(ipv6, ctxt->dhcp_leases[i].ipv6, 16))
-            return ctxt->dhcp_leases[i].eui64;
-    return NULL;
+    struct iobuf_write record = { };
+
+    ext_push_format(buf, EXT_FORMAT_TLV, mask);
+    spinel_push_uint(buf, len);
+    for (int i = 0; i < len; i++) {
+        ext_message_append_node_tlv(&record, &nodes[i], mask);
+        ext_push_record(buf, &record);
+    }
+    iobuf_free(&record);
 }
 
-static bool dbus_get_neighbor_info(struct wsbr_ctxt *ctxt, struct neighbor_info *info, const uint8_t eui64[8])
+// Reply to the WisunNodes0 and WisunNodes requests in EXT_FORMAT_TLV_DELTA
+static void exp_get_wisun_nodes_delta(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_read *buf, uint32_t mask)
 {
-    struct net_if *net_if = protocol_stack_interface_info_get_by_id(ctxt->rcp_if_id);
-    ws_neighbor_class_entry_t *neighbor_ws = NULL;
-    ws_neighbor_temp_class_t *neighbor_ws_tmp;
-    llc_neighbour_req_t neighbor_llc;
-
-    neighbor_ws_tmp = ws_llc_get_eapol_temp_entry(net_if, eui64);
-    if (!neighbor_ws_tmp)
-        neighbor_ws_tmp = ws_llc_get_multicast_temp_entry(net_if, eui64);
-    if (neighbor_ws_tmp) {
-        neighbor_ws = &neighbor_ws_tmp->neigh_info_list;
-        neighbor_ws->rssi = neighbor_ws_tmp->signal_dbm;
+    struct iobuf_write tx_buf = { };
+    struct iobuf_write record = { };
+    struct wsbr_nodes_page page;
+    const uint8_t *cursor;
+    unsigned int cursor_len, max;
+    uint32_t since;
+    int removed, ret;
+
+    since = spinel_pop_u32(buf);
+    cursor_len = spinel_pop_data_ptr(buf, &cursor);
+    max = spinel_pop_uint(buf);
+    // Errors are answered with an empty page of generation 0
+    if (buf->err || (cursor_len && cursor_len != 8) || max > INT_MAX) {
+        ERROR("%s: malformed request", __func__);
+        memset(&page, 0, sizeof(page));
+    } else {
+        ret = wsbr_nodes_get_since(ctxt, since, cursor_len ? cursor : NULL, max, &page);
+        WARN_ON(ret < 0, "%s: %s", __func__, strerror(-ret));
     }
-    if (!neighbor_ws) {
-        if (ws_bootstrap_neighbor_get(net_if, eui64, &neighbor_llc))
-            neighbor_ws = neighbor_llc.ws_neighbor;
-        else
-            return false;
+
+    spinel_push_hdr_is_prop(&tx_buf, prop);
+    ext_push_format(&tx_buf, EXT_FORMAT_TLV_DELTA, mask);
+    spinel_push_u32(&tx_buf, page.generation);
+    spinel_push_bool(&tx_buf, page.is_full);
+    if (page.has_more)
+        spinel_push_data(&tx_buf, page.entries[page.len - 1]->node.eui64, 8);
+    else
+        spinel_push_data(&tx_buf, NULL, 0);
+    removed = 0;
+    for (int i = 0; i < page.len; i++)
+        if (page.entries[i]->is_removed)
+            removed++;
+    spinel_push_uint(&tx_buf, page.len - removed);
+    for (int i = 0; i < page.len; i++) {
+        if (page.entries[i]->is_removed)
+            continue;
+        ext_message_append_node_tlv(&record, &page.entries[i]->node, mask);
+        ext_push_record(&tx_buf, &record);
     }
-    info->rssi = neighbor_ws->rssi;
-    info->rsl = neighbor_ws->rsl_in == RSL_UNITITIALIZED
-              ? INT_MIN
-              : -174 + ws_neighbor_class_rsl_in_get(neighbor_ws);
-    info->rsl_adv = neighbor_ws->rsl_in == RSL_UNITITIALIZED
-                  ? INT_MIN
-                  : -174 + ws_neighbor_class_rsl_out_get(neighbor_ws);
-    return true;
+    spinel_push_uint(&tx_buf, removed);
+    for (int i = 0; i < page.len; i++)
+        if (page.entries[i]->is_removed)
+            spinel_push_fixed_u8_array(&tx_buf, page.entries[i]->node.eui64, 8);
+    ext_cmd_tx(ctxt, &tx_buf);
+    iobuf_free(&record);
+    iobuf_free(&tx_buf);
+    free(page.entries);
 }
 
 static void exp_get_wisun_nodes(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_read *buf)
 {
-    struct neighbor_info *neighbor_info_ptr;
-    struct neighbor_info neighbor_info;
-    uint8_t node_ipv6[3][16] = { 0 };
-    bbr_route_info_t table[4096];
-    uint8_t *parent, *ucast_addr;
-    int len_pae, len_rpl, ret, j;
-    uint8_t eui64_pae[4096][8];
-    bbr_information_t br_info;
-    supp_entry_t *supp;
-    uint8_t ipv6[16];
     struct iobuf_write tx_buf = { };
+    struct wsbr_node *nodes;
+    uint8_t version;
+    uint32_t mask;
+    int len;
 
-    ret = ws_bbr_info_get(ctxt->rcp_if_id, &br_info);
-    BUG_ON(ret < 0, "%d: %s", prop, strerror(-ret));
-    len_pae = ws_pae_auth_supp_list(ctxt->rcp_if_id, eui64_pae, sizeof(eui64_pae));
-    len_rpl = ws_bbr_routing_table_get(ctxt->rcp_if_id, table, ARRAY_SIZE(table));
-    BUG_ON(len_rpl < 0, "%d: %s", prop, strerror(-len_rpl));
+    version = ext_pop_format(buf, UINT32_MAX, &mask);
+    if (version == EXT_FORMAT_TLV_DELTA)
+        return exp_get_wisun_nodes_delta(ctxt, prop, buf, mask);
 
-    tun_addr_get_link_local(ctxt->config.tun_dev, node_ipv6[0]);
-    tun_addr_get_global_unicast(ctxt->config.tun_dev, node_ipv6[1]);
+    len = wsbr_nodes_get(ctxt, &nodes);
+    BUG_ON(len < 0, "%d: %s", prop, strerror(-len));
 
     WARN("-------send wisun nodes info through spinel");
     spinel_push_hdr_is_prop(&tx_buf, SPINEL_PROP_EXT_WisunNodes);
-    ext_message_append_node(&tx_buf, ctxt->rcp.eui64, NULL,
-                             node_ipv6, true, false, NULL);
-
-    for (int i = 0; i < len_pae; i++) {
-        memcpy(node_ipv6[0], ADDR_LINK_LOCAL_PREFIX, 8);
-        memcpy(node_ipv6[0] + 8, eui64_pae[i], 8);
-        memcpy(node_ipv6[1], ADDR_UNSPECIFIED, 16);
-        parent = NULL;
-        ucast_addr = dhcp_eui64_to_ipv6(ctxt, eui64_pae[i]);
-        if (ucast_addr) {
-            memcpy(node_ipv6[1], ucast_addr, 16);
-            for (j = 0; j < len_rpl; j++)
-                if (!memcmp(table[j].target, node_ipv6[1] + 8, 8))
-                    break;
-            if (j != len_rpl) {
-                memcpy(ipv6, br_info.prefix, 8);
-                memcpy(ipv6 + 8, table[j].parent, 8);
-                parent = dhcp_ipv6_to_eui64(ctxt, ipv6);
-                WARN_ON(!parent, "RPL parent not in DHCP leases (%s)", tr_ipv6(ipv6));
-            }
-        }
-        if (dbus_get_neighbor_info(ctxt, &neighbor_info, eui64_pae[i]))
-            neighbor_info_ptr = &neighbor_info;
-        else
-            neighbor_info_ptr = NULL;
-        if (ws_pae_key_storage_supp_exists(eui64_pae[i]))
-            supp = ws_pae_key_storage_supp_read(NULL, eui64_pae[i], NULL, NULL, NULL);
-        else
-            supp = NULL;
-
-        ext_message_append_node(&tx_buf, eui64_pae[i], parent, node_ipv6,
-                                 false, supp, neighbor_info_ptr);
-        if (supp)
-            free(supp);
-    }
+    if (version == EXT_FORMAT_TLV)
+        ext_message_append_nodes_tlv(&tx_buf, nodes, len, mask);
+    else
+        for (int i = 0; i < len; i++)
+            ext_message_append_node(&tx_buf, &nodes[i]);
     ext_cmd_tx(ctxt, &tx_buf);
     iobuf_free(&tx_buf);
+    free(nodes);
 }
 
-static void ext_message_append_node_reduced(
-    struct iobuf_write *buf,
-    const uint8_t self[8],
-    const uint8_t parent[8],
-    const uint8_t ipv6[3][16],
-    bool is_br,
-    supp_entry_t *supp,
-    struct neighbor_info *neighbor)
+static void ext_message_append_node_reduced(struct iobuf_write *buf, const struct wsbr_node *node)
 {
-    spinel_push_fixed_u8_array(buf, self, 8); //node eui64
-    
-    if (is_br) {
+    static const uint8_t parent_none[8] = { 0 };
+    const uint8_t (*ipv6)[16] = node->ipv6;
+
+    spinel_push_fixed_u8_array(buf, node->eui64, 8); //node eui64
+
+    if (node->is_br) {
         spinel_push_string(buf, "isBdRt");
-    } else if (supp) {
+    } else if (node->is_authenticated) {
         spinel_push_string(buf, "isAuth");
     }
-    if (parent) {
-        spinel_push_fixed_u8_array(buf, parent, 8); //parent eui64
-    } else {
-        uint8_t parent_tmp[8] = {0};
-        spinel_push_fixed_u8_array(buf, parent_tmp, 8); //parent eui64
-    }
+    //parent eui64
+    spinel_push_fixed_u8_array(buf, node->has_parent ? node->parent : parent_none, 8);
 
     // "LinkLocal ipv6" then "global ipv6"
-    for (uint8_t index = 0; memcmp(*ipv6, ADDR_UNSPECIFIED, 16); ipv6++, index++) {
+    for (; memcmp(*ipv6, ADDR_UNSPECIFIED, 16); ipv6++)
         spinel_push_fixed_u8_array(buf, (uint8_t *)ipv6, 16);
-    }
 }
 
 static void exp_set_wisun_nodes_reduced(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_read *buf)
 {
-    struct neighbor_info *neighbor_info_ptr;
-    struct neighbor_info neighbor_info;
-    uint8_t node_ipv6[3][16] = { 0 };
-    bbr_route_info_t table[4096];
-    uint8_t *parent, *ucast_addr;
-    int len_pae, len_rpl, ret, j;
-    uint8_t eui64_pae[4096][8];
-    bbr_information_t br_info;
-    supp_entry_t *supp;
-    uint8_t ipv6[16];
+    // Same content as the labeled reduced format
+    const uint32_t reduced_mask = 1u << EXT_NODE_FIELD_EUI64    |
+                                  1u << EXT_NODE_FIELD_FLAGS    |
+                                  1u << EXT_NODE_FIELD_PARENT   |
+                                  1u << EXT_NODE_FIELD_IPV6_LL  |
+                                  1u << EXT_NODE_FIELD_IPV6_GUA;
     struct iobuf_write tx_buf = { };
+    struct wsbr_node *nodes;
+    uint8_t version;
+    uint32_t mask;
+    int len;
 
-    ret = ws_bbr_info_get(ctxt->rcp_if_id, &br_info);
-    BUG_ON(ret < 0, "%d: %s", prop, strerror(-ret));
-    len_pae = ws_pae_auth_supp_list(ctxt->rcp_if_id, eui64_pae, sizeof(eui64_pae));
-    len_rpl = ws_bbr_routing_table_get(ctxt->rcp_if_id, table, ARRAY_SIZE(table));
-    BUG_ON(len_rpl < 0, "%d: %s", prop, strerror(-len_rpl));
+    version = ext_pop_format(buf, reduced_mask, &mask);
+    if (version == EXT_FORMAT_TLV_DELTA)
+        return exp_get_wisun_nodes_delta(ctxt, prop, buf, mask);
 
-    tun_addr_get_link_local(ctxt->config.tun_dev, node_ipv6[0]);
-    tun_addr_get_global_unicast(ctxt->config.tun_dev, node_ipv6[1]);
+    len = wsbr_nodes_get(ctxt, &nodes);
+    BUG_ON(len < 0, "%d: %s", prop, strerror(-len));
 
     WARN("-------send reduced wisun nodes info through spinel");
     spinel_push_hdr_is_prop(&tx_buf, SPINEL_PROP_EXT_WisunNodes0);
-    ext_message_append_node_reduced(&tx_buf, ctxt->rcp.eui64, NULL,
-                             node_ipv6, true, false, NULL);
-
-    for (int i = 0; i < len_pae; i++) {
-        memcpy(node_ipv6[0], ADDR_LINK_LOCAL_PREFIX, 8);
-        memcpy(node_ipv6[0] + 8, eui64_pae[i], 8);
-        memcpy(node_ipv6[1], ADDR_UNSPECIFIED, 16);
-        parent = NULL;
-        ucast_addr = dhcp_eui64_to_ipv6(ctxt, eui64_pae[i]);
-        if (ucast_addr) {
-            memcpy(node_ipv6[1], ucast_addr, 16);
-            for (j = 0; j < len_rpl; j++)
-                if (!memcmp(table[j].target, node_ipv6[1] + 8, 8))
-                    break;
-            if (j != len_rpl) {
-                memcpy(ipv6, br_info.prefix, 8);
-                memcpy(ipv6 + 8, table[j].parent, 8);
-                parent = dhcp_ipv6_to_eui64(ctxt, ipv6);
-                WARN_ON(!parent, "RPL parent not in DHCP leases (%s)", tr_ipv6(ipv6));
-            }
-        }
-        if (dbus_get_neighbor_info(ctxt, &neighbor_info, eui64_pae[i]))
-            neighbor_info_ptr = &neighbor_info;
-        else
-            neighbor_info_ptr = NULL;
-        if (ws_pae_key_storage_supp_exists(eui64_pae[i]))
-            supp = ws_pae_key_storage_supp_read(NULL, eui64_pae[i], NULL, NULL, NULL);
-        else
-            supp = NULL;
-
-        ext_message_append_node_reduced(&tx_buf, eui64_pae[i], parent, node_ipv6,
-                                 false, supp, neighbor_info_ptr);
-        if (supp)
-            free(supp);
-    }
+    if (version == EXT_FORMAT_TLV)
+        ext_message_append_nodes_tlv(&tx_buf, nodes, len, mask);
+    else
+        for (int i = 0; i < len; i++)
+            ext_message_append_node_reduced(&tx_buf, &nodes[i]);
     ext_cmd_tx(ctxt, &tx_buf);
     iobuf_free(&tx_buf);
+    free(nodes);
 }
 
 
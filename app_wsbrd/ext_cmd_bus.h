@@ -22,6 +22,79 @@ struct extcmd {
 
 };
 
+/*
+ * The WisunStatus, WisunNodes0 and WisunNodes requests may carry a format
+ * version byte, optionally followed by a 32-bit little-endian mask of the
+ * fields to return (bit n selects the field of id n). Without version, or with
+ * EXT_FORMAT_LABELED, the responses use the original format where each value
+ * is preceded by a string label.
+ *
+ * With EXT_FORMAT_TLV (or any later version, the response tells which one is
+ * used), the response payload is:
+ *   u8      format version
+ *   u32     mask of the fields actually selected
+ *   uint    number of records (spinel packed integer, not for WisunStatus)
+ *   records
+ * A record is a packed integer giving its size followed by a sequence of
+ * fields, each of them encoded as a u8 id, a u8 length and the value. Unknown
+ * ids must be skipped. The EUI-64 of a node is always present.
+ *
+ * EXT_FORMAT_TLV_DELTA only applies to WisunNodes0 and WisunNodes (WisunStatus
+ * answers with EXT_FORMAT_TLV). It only returns the nodes changed after a
+ * generation of the node table, by pages (see wsbr_nodes_get_since()). The
+ * mask is followed by:
+ *   u32     generation of the previous query, 0 for the whole table
+ *   data    cursor returned by the previous page, empty for the first page
+ *   uint    maximum number of nodes in the page, 0 for no limit
+ * The response payload is:
+ *   u8      format version
+ *   u32     mask of the fields actually selected
+ *   u32     current generation, to use in the next query
+ *   bool    whole table returned, the host has to forget the nodes it knows
+ *   data    cursor of the next page, empty if this is the last page
+ *   uint    number of records
+ *   records of the nodes added or changed
+ *   uint    number of nodes removed
+ *   EUI-64s of the nodes removed
+ * "data" is a le16 length followed by the bytes. A generation older than
+ * WSBR_NODES_HORIZON generations or greater than the current one (from a
+ * previous run of wsbrd) is handled as 0. If the request is malformed or the
+ * RPL DODAG is not started yet, the response carries generation 0 and no node.
+ */
+enum {
+    EXT_FORMAT_LABELED   = 0,
+    EXT_FORMAT_TLV       = 1,
+    EXT_FORMAT_TLV_DELTA = 2,
+};
+
+enum {
+    EXT_NODE_FIELD_EUI64     = 0,  // 8 bytes
+    EXT_NODE_FIELD_FLAGS     = 1,  // u8, EXT_NODE_FLAG_*
+    EXT_NODE_FIELD_NODE_ROLE = 2,  // u8, only if advertised by the node
+    EXT_NODE_FIELD_PARENT    = 3,  // EUI-64 of the RPL parent
+    EXT_NODE_FIELD_RSSI      = 4,  // le16 signed dBm, neighbors only
+    EXT_NODE_FIELD_RSL       = 5,  // le16 signed dBm, neighbors only, if measured
+    EXT_NODE_FIELD_RSL_ADV   = 6,  // le16 signed dBm, neighbors only, if measured
+    EXT_NODE_FIELD_IPV6_LL   = 7,  // 16 bytes
+    EXT_NODE_FIELD_IPV6_GUA  = 8,  // 16 bytes
+};
+
+#define EXT_NODE_FLAG_BR            0x01
+#define EXT_NODE_FLAG_AUTHENTICATED 0x02
+#define EXT_NODE_FLAG_NEIGHBOR      0x04
+
+enum {
+    EXT_STATUS_FIELD_NETWORK_NAME = 0, // Not null terminated
+    EXT_STATUS_FIELD_FAN_VERSION  = 1, // u8
+    EXT_STATUS_FIELD_DOMAIN       = 2, // u8
+    EXT_STATUS_FIELD_MODE         = 3, // le32
+    EXT_STATUS_FIELD_CLASS        = 4, // u8
+    EXT_STATUS_FIELD_PAN_ID       = 5, // le16
+    EXT_STATUS_FIELD_SIZE         = 6, // u8
+    EXT_STATUS_FIELD_GTKS         = 7, // 4 * 16 bytes
+    EXT_STATUS_FIELD_GAKS         = 8, // 4 * 16 bytes
+};
+
 // Only used by the fuzzer
 struct ext_rx_cmds {
     uint32_t cmd;
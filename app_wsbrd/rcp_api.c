@@ -1029,6 +1029,8 @@ static void rcp_tx_cnf(struct wsbr_ctxt *ctxt, uint32_t prop, struct iobuf_read
     }
     if (!spinel_prop_is_valid(buf, prop))
         return;
+    if (ctxt->config.pcap_file[0])
+        wsbr_pcapng_tx_cnf(ctxt, req.msduHandle, req.status, req.timestamp);
     ctxt->rcp.on_tx_cnf(ctxt->rcp_if_id, &req, &conf_req);
 }
 
@@ -10,7 +10,9 @@
  *
  * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
  */
+#include <errno.h>
 #include <poll.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
 #include <semaphore.h>
@@ -42,10 +44,13 @@
 #include "stack/source/6lowpan/ws/ws_cfg_settings.h"
 #include "stack/source/6lowpan/ws/ws_regulation.h"
 #include "stack/source/6lowpan/ws/ws_llc.h"
+#include "stack/source/6lowpan/ws/ws_pae_key_storage.h"
 #include "stack/source/core/ns_address_internal.h"
 #include "stack/source/nwk_interface/protocol.h"
 #include "stack/source/security/kmp/kmp_socket_if.h"
 #include "stack/source/security/protocols/sec_prot_keys.h"
+#include "stack/source/security/protocols/tls_sec_prot/tls_sec_prot_lib.h"
+#include "stack/source/service_libs/fnv_hash/fnv_hash.h"
 
 #include "mbedtls_config_check.h"
 #include "commandline_values.h"
@@ -326,6 +331,10 @@ static void wsbr_network_init(struct wsbr_ctxt *ctxt)
     if (strlen(ctxt->config.radius_secret) != 0)
         if (ws_bbr_radius_shared_secret_set(ctxt->rcp_if_id, strlen(ctxt->config.radius_secret), (uint8_t *)ctxt->config.radius_secret))
             WARN("ws_bbr_radius_shared_secret_set");
+    if (ws_bbr_radius_window_set(ctxt->rcp_if_id, ctxt->config.radius_window))
+        WARN("ws_bbr_radius_window_set");
+    if (ws_bbr_eapol_auth_limit_set(ctxt->rcp_if_id, ctxt->config.eapol_max_full_auth, ctxt->config.eapol_max_key_auth))
+        WARN("ws_bbr_eapol_auth_limit_set");
     if (ctxt->config.radius_server.ss_family != AF_UNSPEC)
         if (ws_bbr_radius_address_set(ctxt->rcp_if_id, &ctxt->config.radius_server))
             WARN("ws_bbr_radius_address_set");
@@ -377,35 +386,129 @@ static void wsbr_handle_reset(struct wsbr_ctxt *ctxt)
     rcp_get_hw_addr();
 }
 
-void kill_handler(int signal)
+static char trace_ring_path[PATH_MAX];
+
+// Only async-signal-safe calls are allowed here
+static void wsbr_trace_ring_handler(int signal)
+{
+    int fd;
+
+    fd = open(trace_ring_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd >= 0) {
+        trace_ring_dump(fd);
+        close(fd);
+    }
+    // The default action is restored (SA_RESETHAND) and delivered on return
+    if (signal != SIGUSR1)
+        raise(signal);
+}
+
+static void wsbr_trace_ring_init(struct wsbr_ctxt *ctxt)
+{
+    static const int crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTRAP };
+    struct sigaction sa = {
+        .sa_handler = wsbr_trace_ring_handler,
+        .sa_flags = SA_RESTART,
+    };
+
+    snprintf(trace_ring_path, sizeof(trace_ring_path), "%strace-ring", ctxt->config.storage_prefix);
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    sa.sa_flags = SA_RESETHAND;
+    for (int i = 0; i < ARRAY_SIZE(crash_signals); i++)
+        sigaction(crash_signals[i], &sa, NULL);
+}
+
+static struct wsbr_dhcp_lease **wsbr_dhcp_lease_eui64_bucket(struct wsbr_ctxt *ctxt, const uint8_t eui64[8])
+{
+    return &ctxt->dhcp_lease_eui64_hash[fnv_hash_1a_32_reverse_block(eui64, 8) % WSBR_DHCP_LEASE_HASH_SIZE];
+}
+
+static struct wsbr_dhcp_lease **wsbr_dhcp_lease_ipv6_bucket(struct wsbr_ctxt *ctxt, const uint8_t ipv6[16])
+{
+    return &ctxt->dhcp_lease_ipv6_hash[fnv_hash_1a_32_reverse_block(ipv6, 16) % WSBR_DHCP_LEASE_HASH_SIZE];
+}
+
+static void wsbr_dhcp_lease_eui64_remove(struct wsbr_ctxt *ctxt, struct wsbr_dhcp_lease *lease)
+{
+    struct wsbr_dhcp_lease **prev = wsbr_dhcp_lease_eui64_bucket(ctxt, lease->eui64);
+
+    while (*prev != lease)
+        prev = &(*prev)->eui64_hash_next;
+    *prev = lease->eui64_hash_next;
+}
+
+static void wsbr_dhcp_lease_ipv6_remove(struct wsbr_ctxt *ctxt, struct wsbr_dhcp_lease *lease)
 {
-    exit(0);
+    struct wsbr_dhcp_lease **prev = wsbr_dhcp_lease_ipv6_bucket(ctxt, lease->ipv6);
+
+    while (*prev != lease)
+        prev = &(*prev)->ipv6_hash_next;
+    *prev = lease->ipv6_hash_next;
+}
+
+struct wsbr_dhcp_lease *wsbr_dhcp_lease_find_eui64(struct wsbr_ctxt *ctxt, const uint8_t eui64[8])
+{
+    for (struct wsbr_dhcp_lease *cur = *wsbr_dhcp_lease_eui64_bucket(ctxt, eui64); cur; cur = cur->eui64_hash_next)
+        if (!memcmp(cur->eui64, eui64, 8))
+            return cur;
+    return NULL;
+}
+
+struct wsbr_dhcp_lease *wsbr_dhcp_lease_find_ipv6(struct wsbr_ctxt *ctxt, const uint8_t ipv6[16])
+{
+    for (struct wsbr_dhcp_lease *cur = *wsbr_dhcp_lease_ipv6_bucket(ctxt, ipv6); cur; cur = cur->ipv6_hash_next)
+        if (!memcmp(cur->ipv6, ipv6, 16))
+            return cur;
+    return NULL;
 }
 
 void wsbr_dhcp_lease_update(struct wsbr_ctxt *ctxt, const uint8_t eui64[8], const uint8_t ipv6[16])
 {
-    int i;
+    struct wsbr_dhcp_lease **bucket;
+    struct wsbr_dhcp_lease *lease;
 
-    // delete entries that already use this IPv6 address
-    for (i = 0; i < ctxt->dhcp_leases_len; i++) {
-        if (!memcmp(ctxt->dhcp_leases[i].ipv6, ipv6, 16)) {
-            memmove(ctxt->dhcp_leases + i, ctxt->dhcp_leases + i + 1,
-                    (ctxt->dhcp_leases_len - i - 1) * sizeof(*ctxt->dhcp_leases));
-            ctxt->dhcp_leases_len--;
-            i--;
-        }
+    lease = wsbr_dhcp_lease_find_ipv6(ctxt, ipv6);
+    // Most of the DHCP replies renew an existing lease
+    if (lease && !memcmp(lease->eui64, eui64, 8))
+        return;
+    // delete the entry that already uses this IPv6 address
+    if (lease) {
+        wsbr_dhcp_lease_ipv6_remove(ctxt, lease);
+        wsbr_dhcp_lease_eui64_remove(ctxt, lease);
+        free(lease);
     }
 
-    for (i = 0; i < ctxt->dhcp_leases_len; i++)
-        if (!memcmp(ctxt->dhcp_leases[i].eui64, eui64, 8))
-            break;
-    if (i == ctxt->dhcp_leases_len) {
-        ctxt->dhcp_leases_len++;
-        ctxt->dhcp_leases = realloc(ctxt->dhcp_leases, ctxt->dhcp_leases_len * sizeof(*ctxt->dhcp_leases));
-        BUG_ON(!ctxt->dhcp_leases);
+    lease = wsbr_dhcp_lease_find_eui64(ctxt, eui64);
+    if (lease) {
+        wsbr_dhcp_lease_ipv6_remove(ctxt, lease);
+    } else {
+        lease = calloc(1, sizeof(*lease));
+        BUG_ON(!lease);
+        memcpy(lease->eui64, eui64, 8);
+        bucket = wsbr_dhcp_lease_eui64_bucket(ctxt, eui64);
+        lease->eui64_hash_next = *bucket;
+        *bucket = lease;
     }
-    memcpy(ctxt->dhcp_leases[i].eui64, eui64, 8);
-    memcpy(ctxt->dhcp_leases[i].ipv6, ipv6, 16);
+    memcpy(lease->ipv6, ipv6, 16);
+    bucket = wsbr_dhcp_lease_ipv6_bucket(ctxt, ipv6);
+    lease->ipv6_hash_next = *bucket;
+    *bucket = lease;
+    wsbr_nodes_changed(ctxt);
+}
+
+static void wsbr_nodes_changed_cb(void)
+{
+    wsbr_nodes_changed(&g_ctxt);
+}
+
+static volatile sig_atomic_t wsbr_exit_requested;
+
+// Only async-signal-safe calls are allowed here: the main loop exits and
+// flushes the pending writes on the next wake up.
+void kill_handler(int signal)
+{
+    wsbr_exit_requested = 1;
 }
 
 static void wsbr_rcp_init(struct wsbr_ctxt *ctxt)
@@ -417,6 +520,8 @@ static void wsbr_rcp_init(struct wsbr_ctxt *ctxt)
     i = 0;
     do {
         ret = poll(&fds, 1, timeout_values[i] * 1000);
+        if (ret < 0 && errno == EINTR && wsbr_exit_requested)
+            exit(0);
         if (ret < 0)
             FATAL(2, "poll: %m");
         if (ret == 0)
@@ -488,6 +593,8 @@ static void wsbr_poll(struct wsbr_ctxt *ctxt, struct pollfd *fds)
         ret = poll(fds, POLLFD_COUNT, 0);
     else
         ret = poll(fds, POLLFD_COUNT, -1);
+    if (ret < 0 && errno == EINTR)
+        return;
     FATAL_ON(ret < 0, 2, "poll: %m");
 
     if (fds[POLLFD_DBUS].revents & POLLIN)
@@ -517,14 +624,19 @@ static void wsbr_poll(struct wsbr_ctxt *ctxt, struct pollfd *fds)
         fds[POLLFD_EXT_CMD].revents & POLLERR ||
         ctxt->ext_cmd_ctxt->uart_next_frame_ready)
         ext_cmd_rx(ctxt);
-    if (fds[POLLFD_TIMER].revents & POLLIN)
+    if (fds[POLLFD_TIMER].revents & POLLIN) {
         wsbr_common_timer_process(ctxt);
+        dbus_nodes_timer(ctxt);
+        if (ctxt->config.pcap_file[0])
+            wsbr_pcapng_timer(ctxt);
+    }
 }
 
 int wsbr_main(int argc, char *argv[])
 {
     static const char *files[] = {
         "keys-*:*:*:*:*:*:*:*",
+        "keys.bin",
         "network-keys",
         "counters",
         "br-info",
@@ -541,9 +653,13 @@ int wsbr_main(int argc, char *argv[])
     parse_commandline(&ctxt->config, argc, argv, print_help_br);
     if (ctxt->config.color_output != -1)
         g_enable_color_traces = ctxt->config.color_output;
+    log_async_start(ctxt->config.log_buffer_size);
     wsbr_check_mbedtls_features();
     event_scheduler_init(&ctxt->scheduler);
+    tls_sec_prot_lib_workers_start(ctxt->config.eap_tls_threads, ctxt->config.eap_tls_queue_size);
+    tls_sec_prot_lib_sessions_init(ctxt->config.eap_tls_session_cache_size, ctxt->config.eap_tls_session_lifetime);
     g_storage_prefix = ctxt->config.storage_prefix;
+    wsbr_trace_ring_init(ctxt);
     if (ctxt->config.storage_delete)
         storage_delete(files);
     if (ctxt->config.pan_size >= 0)
@@ -587,6 +703,7 @@ int wsbr_main(int argc, char *argv[])
     ctxt->rcp_if_id = arm_nwk_interface_lowpan_init(&ctxt->rcp, ctxt->config.lowpan_mtu, "ws0");
     BUG_ON(ctxt->rcp_if_id < 0, "arm_nwk_interface_lowpan_init: %d", ctxt->rcp_if_id);
 
+    ws_bbr_nodes_changed_cb_set(wsbr_nodes_changed_cb);
     wsbr_network_init(ctxt);
     sl_wisun_collector_init();
     event_scheduler_run_until_idle();
@@ -597,9 +714,12 @@ int wsbr_main(int argc, char *argv[])
 
     wsbr_fds_init(ctxt, fds);
 
-    while (true)
+    while (!wsbr_exit_requested)
         wsbr_poll(ctxt, fds);
 
+    ws_pae_key_storage_flush();
+    if (ctxt->config.pcap_file[0])
+        wsbr_pcapng_flush(ctxt);
     return 0;
 }
 
@@ -23,15 +23,30 @@ typedef struct sd_bus sd_bus;
 
 #include "common/dhcp_server.h"
 #include "common/events_scheduler.h"
+#include "common/iobuf.h"
 #include "stack/mac/mac_api.h"
 #include "stack/mac/fhss_config.h"
 #include "rcp_api.h"
 #include "ext_cmd_bus.h"
+#include "wsbr_pcapng.h"
+#include "wsbr_nodes.h"
 
 #include "commandline.h"
 
 struct iobuf_read;
 
+// Number of buckets of the DHCP lease indexes. Keep it a power of 2.
+#define WSBR_DHCP_LEASE_HASH_SIZE 256
+
+// A lease is indexed by both its EUI-64 and its IPv6 address, each of them
+// being unique among the leases.
+struct wsbr_dhcp_lease {
+    uint8_t eui64[8];
+    uint8_t ipv6[16];
+    struct wsbr_dhcp_lease *eui64_hash_next;
+    struct wsbr_dhcp_lease *ipv6_hash_next;
+};
+
 struct wsbr_ctxt {
     struct os_ctxt *os_ctxt;
     struct os_ctxt *ext_cmd_ctxt;
@@ -53,14 +68,22 @@ struct wsbr_ctxt {
 
     int pcapng_fd;
     mode_t pcapng_type;
+    struct iobuf_write pcapng_buf;
+    struct iobuf_write pcapng_tx[256]; // Indexed by MAC handle
+    time_t pcapng_flush_time;
+    time_t pcapng_file_time;
+    size_t pcapng_file_len;
+    int pcapng_file_index;
+    struct wsbr_pcapng_filter pcapng_filter;
 
     struct extcmd extcmd;
 
-    struct {
-        uint8_t eui64[8];
-        uint8_t ipv6[16];
-    } *dhcp_leases;
-    int dhcp_leases_len;
+    struct wsbr_dhcp_lease *dhcp_lease_eui64_hash[WSBR_DHCP_LEASE_HASH_SIZE];
+    struct wsbr_dhcp_lease *dhcp_lease_ipv6_hash[WSBR_DHCP_LEASE_HASH_SIZE];
+    struct wsbr_nodes_journal nodes_journal;
+    bool dbus_nodes_pending;
+    uint64_t dbus_nodes_deadline;   // Monotonic ms of the next NodesChanged signal, 0 if idle
+    uint32_t dbus_nodes_generation; // Last generation signaled on D-Bus
 
     char *fw_upt_filename;
     char *node_ota_filename;
@@ -72,6 +95,8 @@ struct wsbr_ctxt {
 extern struct wsbr_ctxt g_ctxt;
 
 void wsbr_dhcp_lease_update(struct wsbr_ctxt *ctxt, const uint8_t eui64[8], const uint8_t ipv6[16]);
+struct wsbr_dhcp_lease *wsbr_dhcp_lease_find_eui64(struct wsbr_ctxt *ctxt, const uint8_t eui64[8]);
+struct wsbr_dhcp_lease *wsbr_dhcp_lease_find_ipv6(struct wsbr_ctxt *ctxt, const uint8_t ipv6[16]);
 int wsbr_restart(struct wsbr_ctxt *ctxt);
 
 #endif
@@ -116,6 +116,8 @@ void wsbr_data_req_ext(struct net_if *cur,
         rcp_tx_req(frame.data, frame.len, neighbor_ws, data->msduHandle,
                    data->fhss_type, data->ExtendedFrameExchange,
                    data->priority, data->phy_id);
+        if (g_ctxt.config.pcap_file[0])
+            wsbr_pcapng_tx_req(&g_ctxt, data, ie_ext, frame.data, frame.len);
         iobuf_free(&frame);
     }
 
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2023 Silicon Laboratories Inc. (www.silabs.com)
+ *
+ * The licensor of this software is Silicon Laboratories Inc. Your use of this
+ * software is governed by the terms of the Silicon Labs Master Software License
+ * Agreement (MSLA) available at [1].  This software is distributed to you in
+ * Object Code format and/or Source Code format and is governed by the sections
+ * of the MSLA applicable to Object Code, Source Code and Modified Open Source
+ * Code. By using this software, you agree to the terms of the MSLA.
+ *
+ * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
+ */
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "common/log.h"
+#include "common/utils.h"
+#include "stack/ws_bbr_api.h"
+#include "stack/source/6lowpan/ws/ws_bootstrap.h"
+#include "stack/source/6lowpan/ws/ws_common.h"
+#include "stack/source/6lowpan/ws/ws_common_defines.h"
+#include "stack/source/6lowpan/ws/ws_llc.h"
+#include "stack/source/6lowpan/ws/ws_pae_key_storage.h"
+#include "stack/source/6lowpan/ws/ws_pae_lib.h"
+#include "stack/source/6lowpan/ws/ws_pae_auth.h"
+#include "stack/source/core/ns_address_internal.h"
+#include "stack/source/nwk_interface/protocol.h"
+#include "stack/source/service_libs/fnv_hash/fnv_hash.h"
+
+#include "wsbr.h"
+#include "dbus.h"
+#include "tun.h"
+
+#include "wsbr_nodes.h"
+
+// Initial size of the lists retrieved from the stack, doubled until they fit
+#define WSBR_NODES_LIST_SIZE_MIN 256
+
+static int wsbr_nodes_supp_list(struct wsbr_ctxt *ctxt, uint8_t (**eui64)[8])
+{
+    int size = WSBR_NODES_LIST_SIZE_MIN;
+    int len;
+
+    for (*eui64 = NULL; ; size *= 2) {
+        *eui64 = realloc(*eui64, size * sizeof(**eui64));
+        BUG_ON(!*eui64);
+        len = ws_pae_auth_supp_list(ctxt->rcp_if_id, *eui64, size);
+        if (len < size)
+            return len;
+    }
+}
+
+static int wsbr_nodes_route_list(struct wsbr_ctxt *ctxt, bbr_route_info_t **routes)
+{
+    int size = WSBR_NODES_LIST_SIZE_MIN;
+    int len;
+
+    // The stack takes the table length as a uint16_t
+    for (*routes = NULL; ; size *= 2) {
+        *routes = realloc(*routes, size * sizeof(**routes));
+        BUG_ON(!*routes);
+        len = ws_bbr_routing_table_get(ctxt->rcp_if_id, *routes, size);
+        if (len < size || size > UINT16_MAX / 2)
+            return len;
+    }
+}
+
+// Open addressing table of indexes in routes[], keyed by the target IID
+static int32_t *wsbr_nodes_route_index(const bbr_route_info_t *routes, int len, int *index_size)
+{
+    int32_t *index;
+    uint32_t i;
+
+    for (*index_size = 1; *index_size < 2 * len; *index_size *= 2)
+        ;
+    index = malloc(*index_size * sizeof(*index));
+    BUG_ON(!index);
+    memset(index, 0xff, *index_size * sizeof(*index));
+    for (int j = 0; j < len; j++) {
+        i = fnv_hash_1a_32_reverse_block(routes[j].target, 8) & (*index_size - 1);
+        while (index[i] >= 0)
+            i = (i + 1) & (*index_size - 1);
+        index[i] = j;
+    }
+    return index;
+}
+
+static const bbr_route_info_t *wsbr_nodes_route_find(const bbr_route_info_t *routes,
+                                                     const int32_t *index, int index_size,
+                                                     const uint8_t iid[8])
+{
+    uint32_t i = fnv_hash_1a_32_reverse_block(iid, 8) & (index_size - 1);
+
+    for (; index[i] >= 0; i = (i + 1) & (index_size - 1))
+        if (!memcmp(routes[index[i]].target, iid, 8))
+            return &routes[index[i]];
+    return NULL;
+}
+
+static void wsbr_nodes_neighbor_info(struct wsbr_ctxt *ctxt, struct wsbr_node *node)
+{
+    struct net_if *net_if = protocol_stack_interface_info_get_by_id(ctxt->rcp_if_id);
+    ws_neighbor_class_entry_t *neighbor_ws = NULL;
+    ws_neighbor_temp_class_t *neighbor_ws_tmp;
+    llc_neighbour_req_t neighbor_llc;
+
+    neighbor_ws_tmp = ws_llc_get_eapol_temp_entry(net_if, node->eui64);
+    if (!neighbor_ws_tmp)
+        neighbor_ws_tmp = ws_llc_get_multicast_temp_entry(net_if, node->eui64);
+    if (neighbor_ws_tmp) {
+        neighbor_ws = &neighbor_ws_tmp->neigh_info_list;
+        neighbor_ws->rssi = neighbor_ws_tmp->signal_dbm;
+    }
+    if (!neighbor_ws) {
+        if (ws_bootstrap_neighbor_get(net_if, node->eui64, &neighbor_llc))
+            neighbor_ws = neighbor_llc.ws_neighbor;
+        else
+            return;
+    }
+    node->is_neighbor = true;
+    node->rssi = neighbor_ws->rssi;
+    node->rsl = neighbor_ws->rsl_in == RSL_UNITITIALIZED
+              ? INT_MIN
+              : -174 + ws_neighbor_class_rsl_in_get(neighbor_ws);
+    node->rsl_adv = neighbor_ws->rsl_in == RSL_UNITITIALIZED
+                  ? INT_MIN
+                  : -174 + ws_neighbor_class_rsl_out_get(neighbor_ws);
+}
+
+int wsbr_nodes_get(struct wsbr_ctxt *ctxt, struct wsbr_node **nodes)
+{
+    const bbr_route_info_t *route;
+    struct wsbr_dhcp_lease *lease;
+    bbr_information_t br_info;
+    bbr_route_info_t *routes;
+    uint8_t (*eui64_pae)[8];
+    int len_pae, len_rpl;
+    struct wsbr_node *node;
+    int32_t *route_index;
+    supp_entry_t *supp;
+    int index_size;
+    uint8_t ipv6[16];
+
+    *nodes = NULL;
+    if (ws_bbr_info_get(ctxt->rcp_if_id, &br_info))
+        return -EAGAIN;
+    len_rpl = wsbr_nodes_route_list(ctxt, &routes);
+    if (len_rpl < 0) {
+        free(routes);
+        return -EAGAIN;
+    }
+    route_index = wsbr_nodes_route_index(routes, len_rpl, &index_size);
+    len_pae = wsbr_nodes_supp_list(ctxt, &eui64_pae);
+
+    *nodes = calloc(len_pae + 1, sizeof(**nodes));
+    BUG_ON(!*nodes);
+
+    node = &(*nodes)[0];
+    memcpy(node->eui64, ctxt->rcp.eui64, 8);
+    tun_addr_get_link_local(ctxt->config.tun_dev, node->ipv6[0]);
+    tun_addr_get_global_unicast(ctxt->config.tun_dev, node->ipv6[1]);
+    node->is_br = true;
+    node->node_role = WS_NR_ROLE_BR;
+
+    for (int i = 0; i < len_pae; i++) {
+        node = &(*nodes)[i + 1];
+        memcpy(node->eui64, eui64_pae[i], 8);
+        memcpy(node->ipv6[0], ADDR_LINK_LOCAL_PREFIX, 8);
+        memcpy(node->ipv6[0] + 8, eui64_pae[i], 8);
+        node->node_role = WS_NR_ROLE_UNKNOWN;
+        lease = wsbr_dhcp_lease_find_eui64(ctxt, eui64_pae[i]);
+        if (lease) {
+            memcpy(node->ipv6[1], lease->ipv6, 16);
+            route = wsbr_nodes_route_find(routes, route_index, index_size, lease->ipv6 + 8);
+            if (route) {
+                memcpy(ipv6, br_info.prefix, 8);
+                memcpy(ipv6 + 8, route->parent, 8);
+                lease = wsbr_dhcp_lease_find_ipv6(ctxt, ipv6);
+                WARN_ON(!lease, "RPL parent not in DHCP leases (%s)", tr_ipv6(ipv6));
+                if (lease) {
+                    node->has_parent = true;
+                    memcpy(node->parent, lease->eui64, 8);
+                }
+            }
+        }
+        wsbr_nodes_neighbor_info(ctxt, node);
+        if (ws_pae_key_storage_supp_exists(eui64_pae[i])) {
+            supp = ws_pae_key_storage_supp_read(NULL, eui64_pae[i], NULL, NULL, NULL);
+            node->is_authenticated = true;
+            if (ws_common_is_valid_nr(supp->sec_keys.node_role))
+                node->node_role = supp->sec_keys.node_role;
+            free(supp);
+        }
+    }
+    free(route_index);
+    free(eui64_pae);
+    free(routes);
+    return len_pae + 1;
+}
+
+void wsbr_nodes_changed(struct wsbr_ctxt *ctxt)
+{
+    ctxt->nodes_journal.is_dirty = true;
+    dbus_emit_nodes_change(ctxt);
+}
+
+static int wsbr_nodes_cmp(const void *a, const void *b)
+{
+    return memcmp(((const struct wsbr_node *)a)->eui64, ((const struct wsbr_node *)b)->eui64, 8);
+}
+
+// Signal measurements are ignored, they change with every received frame.
+// is_neighbor is ignored too: the neighbor tables do not call
+// wsbr_nodes_changed(), so its changes would only be noticed by chance.
+static bool wsbr_nodes_differ(const struct wsbr_node *a, const struct wsbr_node *b)
+{
+    return memcmp(a->ipv6, b->ipv6, sizeof(a->ipv6))     ||
+           a->is_br != b->is_br                          ||
+           a->is_authenticated != b->is_authenticated    ||
+           a->node_role != b->node_role                  ||
+           a->has_parent != b->has_parent                ||
+           (a->has_parent && memcmp(a->parent, b->parent, 8));
+}
+
+static void wsbr_nodes_journal_log(struct wsbr_nodes_journal *journal, const uint8_t eui64[8])
+{
+    if (journal->log_len == journal->log_size) {
+        journal->log_size = journal->log_size ? 2 * journal->log_size : WSBR_NODES_LIST_SIZE_MIN;
+        journal->log = realloc(journal->log, journal->log_size * sizeof(*journal->log));
+        BUG_ON(!journal->log);
+    }
+    journal->log[journal->log_len].generation = journal->generation + 1;
+    memcpy(journal->log[journal->log_len].eui64, eui64, 8);
+    journal->log_len++;
+}
+
+// Index of the first change after generation
+static int wsbr_nodes_journal_log_seek(const struct wsbr_nodes_journal *journal, uint32_t generation)
+{
+    int lo = 0, hi = journal->log_len, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (journal->log[mid].generation <= generation)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Forget the changes older than WSBR_NODES_HORIZON generations. The tombstones
+// are dropped on the next merge.
+static void wsbr_nodes_journal_prune(struct wsbr_nodes_journal *journal)
+{
+    int i;
+
+    if (journal->generation - journal->horizon <= WSBR_NODES_HORIZON)
+        return;
+    journal->horizon = journal->generation - WSBR_NODES_HORIZON;
+    i = wsbr_nodes_journal_log_seek(journal, journal->horizon);
+    memmove(journal->log, journal->log + i, (journal->log_len - i) * sizeof(*journal->log));
+    journal->log_len -= i;
+}
+
+static int wsbr_nodes_journal_sync(struct wsbr_ctxt *ctxt)
+{
+    struct wsbr_nodes_journal *journal = &ctxt->nodes_journal;
+    struct wsbr_nodes_entry *entries, *entry;
+    struct wsbr_node *nodes;
+    int log_len = journal->log_len;
+    int i = 0, j = 0;
+    int len, cmp;
+
+    if (journal->entries && !journal->is_dirty)
+        return 0;
+    // Keep increasing across restarts, so generations from a previous run
+    // are unlikely to be mistaken for recent ones
+    if (!journal->generation) {
+        journal->generation = time(NULL);
+        journal->horizon = journal->generation;
+    }
+    len = wsbr_nodes_get(ctxt, &nodes);
+    if (len < 0)
+        return len;
+    qsort(nodes, len, sizeof(*nodes), wsbr_nodes_cmp);
+
+    // Merge the sorted snapshot into the sorted journal
+    entries = calloc(journal->len + len, sizeof(*entries));
+    BUG_ON(!entries);
+    for (entry = entries; i < journal->len || j < len; entry++) {
+        if (j == len)
+            cmp = -1;
+        else if (i == journal->len)
+            cmp = 1;
+        else
+            cmp = memcmp(journal->entries[i].node.eui64, nodes[j].eui64, 8);
+        if (cmp < 0) {
+            *entry = journal->entries[i++];
+            if (!entry->is_removed) {
+                entry->is_removed = true;
+                entry->generation = journal->generation + 1;
+                wsbr_nodes_journal_log(journal, entry->node.eui64);
+            } else if (entry->generation <= journal->horizon) {
+                entry--;
+            }
+        } else if (cmp > 0) {
+            entry->node = nodes[j++];
+            entry->generation = journal->generation + 1;
+            wsbr_nodes_journal_log(journal, entry->node.eui64);
+        } else {
+            *entry = journal->entries[i];
+            if (entry->is_removed || wsbr_nodes_differ(&entry->node, &nodes[j])) {
+                entry->is_removed = false;
+                entry->generation = journal->generation + 1;
+                wsbr_nodes_journal_log(journal, entry->node.eui64);
+            }
+            entry->node = nodes[j];
+            i++;
+            j++;
+        }
+    }
+    free(journal->entries);
+    free(nodes);
+    journal->entries = entries;
+    journal->len = entry - entries;
+    journal->is_dirty = false;
+    if (journal->log_len != log_len) {
+        journal->generation++;
+        wsbr_nodes_journal_prune(journal);
+    }
+    return 0;
+}
+
+// Index of the first entry after eui64
+static int wsbr_nodes_journal_seek(const struct wsbr_nodes_journal *journal, const uint8_t eui64[8])
+{
+    int lo = 0, hi = journal->len, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (memcmp(journal->entries[mid].node.eui64, eui64, 8) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int wsbr_nodes_eui64_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, 8);
+}
+
+static void wsbr_nodes_get_full(struct wsbr_nodes_journal *journal, const uint8_t cursor[8], int max,
+                                struct wsbr_nodes_page *page)
+{
+    page->is_full = true;
+    page->entries = calloc((max ? MIN(max, journal->len) : journal->len) + 1, sizeof(*page->entries));
+    BUG_ON(!page->entries);
+    for (int i = cursor ? wsbr_nodes_journal_seek(journal, cursor) : 0; i < journal->len; i++) {
+        if (journal->entries[i].is_removed)
+            continue;
+        if (max && page->len == max) {
+            page->has_more = true;
+            break;
+        }
+        page->entries[page->len++] = &journal->entries[i];
+    }
+}
+
+static void wsbr_nodes_get_delta(struct wsbr_nodes_journal *journal, uint32_t since,
+                                 const uint8_t cursor[8], int max, struct wsbr_nodes_page *page)
+{
+    int start = wsbr_nodes_journal_log_seek(journal, since);
+    int len = journal->log_len - start;
+    uint8_t (*eui64)[8];
+    int i;
+
+    // A node changed by several generations is logged several times
+    eui64 = malloc((len + 1) * sizeof(*eui64));
+    BUG_ON(!eui64);
+    for (i = 0; i < len; i++)
+        memcpy(eui64[i], journal->log[start + i].eui64, 8);
+    qsort(eui64, len, sizeof(*eui64), wsbr_nodes_eui64_cmp);
+
+    page->entries = calloc((max ? MIN(max, len) : len) + 1, sizeof(*page->entries));
+    BUG_ON(!page->entries);
+    for (i = 0; i < len; i++) {
+        if (i && !memcmp(eui64[i], eui64[i - 1], 8))
+            continue;
+        if (cursor && memcmp(eui64[i], cursor, 8) <= 0)
+            continue;
+        if (max && page->len == max) {
+            page->has_more = true;
+            break;
+        }
+        // Logged changes are newer than the horizon, so are their entries
+        page->entries[page->len] = &journal->entries[wsbr_nodes_journal_seek(journal, eui64[i]) - 1];
+        BUG_ON(memcmp(page->entries[page->len]->node.eui64, eui64[i], 8));
+        page->len++;
+    }
+    free(eui64);
+}
+
+int wsbr_nodes_get_since(struct wsbr_ctxt *ctxt, uint32_t since, const uint8_t cursor[8], int max,
+                         struct wsbr_nodes_page *page)
+{
+    struct wsbr_nodes_journal *journal = &ctxt->nodes_journal;
+    int ret;
+
+    memset(page, 0, sizeof(*page));
+    ret = wsbr_nodes_journal_sync(ctxt);
+    if (ret < 0)
+        return ret;
+    page->generation = journal->generation;
+    // The client may have seen a previous run of wsbrd, or be too late to
+    // find its changes in the log
+    if (since > journal->generation || since < journal->horizon)
+        since = 0;
+    if (since)
+        wsbr_nodes_get_delta(journal, since, cursor, max, page);
+    else
+        wsbr_nodes_get_full(journal, cursor, max, page);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2023 Silicon Laboratories Inc. (www.silabs.com)
+ *
+ * The licensor of this software is Silicon Laboratories Inc. Your use of this
+ * software is governed by the terms of the Silicon Labs Master Software License
+ * Agreement (MSLA) available at [1].  This software is distributed to you in
+ * Object Code format and/or Source Code format and is governed by the sections
+ * of the MSLA applicable to Object Code, Source Code and Modified Open Source
+ * Code. By using this software, you agree to the terms of the MSLA.
+ *
+ * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
+ */
+#ifndef WSBR_NODES_H
+#define WSBR_NODES_H
+#include <stdbool.h>
+#include <stdint.h>
+
+struct wsbr_ctxt;
+
+// Number of generations for which the changes are remembered
+#define WSBR_NODES_HORIZON 1024
+
+/*
+ * View of a node of the network, as reported by D-Bus and the external command
+ * bus. It joins the supplicants known by the authenticator with the DHCP
+ * leases, the RPL routing table and the neighbor tables.
+ */
+struct wsbr_node {
+    uint8_t eui64[8];
+    uint8_t ipv6[3][16]; // Link-local then GUA, terminated by ADDR_UNSPECIFIED
+    bool is_br;
+    bool is_authenticated;
+    uint8_t node_role;   // WS_NR_ROLE_UNKNOWN if not advertised
+    bool has_parent;
+    uint8_t parent[8];
+    bool is_neighbor;
+    int rssi;
+    int rsl;             // INT_MIN if not measured yet
+    int rsl_adv;         // INT_MIN if not measured yet
+};
+
+/*
+ * Fill *nodes with a snapshot of the network, the border router being the
+ * first entry. Return the number of entries, or a negative errno if the RPL
+ * DODAG is not started yet. *nodes has to be freed by the caller.
+ */
+int wsbr_nodes_get(struct wsbr_ctxt *ctxt, struct wsbr_node **nodes);
+
+struct wsbr_nodes_entry {
+    struct wsbr_node node;
+    uint32_t generation; // Generation of the last change
+    bool is_removed;
+};
+
+struct wsbr_nodes_change {
+    uint32_t generation;
+    uint8_t eui64[8];
+};
+
+/*
+ * Copy of the last snapshot where each node is stamped with the generation of
+ * its last change, so management hosts can only fetch what changed since their
+ * previous query. The generation is incremented each time a refreshed snapshot
+ * differs from the previous one. Changes of the signal measurements (RSSI and
+ * RSL) and of is_neighbor alone do not count as a change. The first generation
+ * is the time wsbrd started (in seconds since the Epoch), so it keeps
+ * increasing across restarts.
+ *
+ * The EUI-64s changed by each generation are logged, so a query only walks
+ * through the changes it returns. The log and the tombstones of the removed
+ * nodes are only kept for the last WSBR_NODES_HORIZON generations. A client
+ * older than that receives the whole table again.
+ */
+struct wsbr_nodes_journal {
+    uint32_t generation;
+    uint32_t horizon;                 // Changes up to this generation are forgotten
+    bool is_dirty;                    // Set by wsbr_nodes_changed()
+    struct wsbr_nodes_entry *entries; // Sorted by EUI-64
+    int len;
+    struct wsbr_nodes_change *log;    // Sorted by generation
+    int log_len;
+    int log_size;
+};
+
+struct wsbr_nodes_page {
+    uint32_t generation;                    // To use as "since" in the next query
+    bool is_full;                           // Whole table, without the removed nodes
+    const struct wsbr_nodes_entry **entries; // Has to be freed by the caller
+    int len;
+    bool has_more;                          // Continue after entries[len - 1]
+};
+
+/*
+ * Notify that the RPL, PAE or DHCP state changed. The snapshot is refreshed
+ * lazily on the next query. The D-Bus clients are notified.
+ */
+void wsbr_nodes_changed(struct wsbr_ctxt *ctxt);
+
+/*
+ * Fill page with at most max (0 for no limit) entries changed after generation
+ * since, in EUI-64 order and starting after cursor (NULL for the first page).
+ * If since is 0, older than the horizon of the journal or greater than the
+ * current generation (it comes from another run of wsbrd), the whole table is
+ * returned without the removed nodes and page->is_full is set: the client has
+ * to forget the nodes it knows. To not miss the changes happening while a
+ * client walks through the pages, it should use the generation returned with
+ * the first page in its next query. The entries are valid until the next
+ * call. Return 0, or a negative errno if the RPL DODAG is not started yet.
+ */
+int wsbr_nodes_get_since(struct wsbr_ctxt *ctxt, uint32_t since, const uint8_t cursor[8], int max,
+                         struct wsbr_nodes_page *page);
+
+#endif
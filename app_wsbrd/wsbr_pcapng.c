@@ -2,7 +2,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <strings.h>
 #include <errno.h>
+#include <stdio.h>
+#include <time.h>
 
 #include "common/bits.h"
 #include "common/endian.h"
@@ -11,12 +14,97 @@
 #include "common/iobuf.h"
 #include "common/pcapng.h"
 #include "common/string_extra.h"
+#include "common/named_values.h"
+#include "common/parsers.h"
+#include "common/ieee802154_ie.h"
+#include "stack/mac/mlme.h"
+#include "stack/mac/mac_mcps.h"
+#include "stack/source/6lowpan/ws/ws_common_defines.h"
+#include "stack/source/6lowpan/ws/ws_ie_lib.h"
 
 #include "frame_helpers.h"
 #include "wsbr.h"
 
+enum {
+    WSBR_PCAPNG_FILTER_OR,
+    WSBR_PCAPNG_FILTER_SRC,
+    WSBR_PCAPNG_FILTER_DST,
+    WSBR_PCAPNG_FILTER_ADDR,
+    WSBR_PCAPNG_FILTER_TYPE,
+    WSBR_PCAPNG_FILTER_WH,
+    WSBR_PCAPNG_FILTER_WP_SHORT,
+    WSBR_PCAPNG_FILTER_WP_LONG,
+};
+
+static const struct name_value wsbr_pcapng_filter_ops[] = {
+    { "src",      WSBR_PCAPNG_FILTER_SRC },
+    { "dst",      WSBR_PCAPNG_FILTER_DST },
+    { "addr",     WSBR_PCAPNG_FILTER_ADDR },
+    { "type",     WSBR_PCAPNG_FILTER_TYPE },
+    { "wh",       WSBR_PCAPNG_FILTER_WH },
+    { "wp-short", WSBR_PCAPNG_FILTER_WP_SHORT },
+    { "wp-long",  WSBR_PCAPNG_FILTER_WP_LONG },
+    { NULL },
+};
+
+static const struct name_value wsbr_pcapng_filter_types[] = {
+    { "data",  1 << WS_FT_DATA },
+    { "eapol", 1 << WS_FT_EAPOL },
+    { "async", 1 << WS_FT_PA  | 1 << WS_FT_PAS  | 1 << WS_FT_PC  | 1 << WS_FT_PCS |
+               1 << WS_FT_LPA | 1 << WS_FT_LPAS | 1 << WS_FT_LPC | 1 << WS_FT_LPCS |
+               1 << WS_FT_LTS },
+    { "pa",    1 << WS_FT_PA },
+    { "pas",   1 << WS_FT_PAS },
+    { "pc",    1 << WS_FT_PC },
+    { "pcs",   1 << WS_FT_PCS },
+    { "lpa",   1 << WS_FT_LPA },
+    { "lpas",  1 << WS_FT_LPAS },
+    { "lpc",   1 << WS_FT_LPC },
+    { "lpcs",  1 << WS_FT_LPCS },
+    { "lts",   1 << WS_FT_LTS },
+    { NULL },
+};
+
+// What the filter needs to know about a frame, available before rebuilding it
+struct wsbr_pcapng_frame {
+    const uint8_t *src; // NULL if not an EUI-64
+    const uint8_t *dst; // NULL if not an EUI-64
+    const uint8_t *ie_header;
+    uint16_t ie_header_len;
+    const uint8_t *ie_payload;
+    uint16_t ie_payload_len;
+};
+
 static void wsbr_pcapng_write_start(struct wsbr_ctxt *ctxt);
 
+static time_t wsbr_pcapng_now()
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec;
+}
+
+static bool wsbr_pcapng_rotation_enabled(struct wsbr_ctxt *ctxt)
+{
+    return ctxt->pcapng_type == S_IFREG &&
+           (ctxt->config.pcap_rotate_size || ctxt->config.pcap_rotate_interval);
+}
+
+static void wsbr_pcapng_open(struct wsbr_ctxt *ctxt)
+{
+    char path[PATH_MAX];
+
+    if (wsbr_pcapng_rotation_enabled(ctxt))
+        snprintf(path, sizeof(path), "%s.%d", ctxt->config.pcap_file, ctxt->pcapng_file_index);
+    else
+        snprintf(path, sizeof(path), "%s", ctxt->config.pcap_file);
+    ctxt->pcapng_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    FATAL_ON(ctxt->pcapng_fd < 0, 2, "open %s: %m", path);
+    ctxt->pcapng_file_len = 0;
+    ctxt->pcapng_file_time = wsbr_pcapng_now();
+}
+
 static void wsbr_pcapng_write(struct wsbr_ctxt *ctxt, const struct iobuf_write *buf)
 {
     int ret;
@@ -31,8 +119,10 @@ static void wsbr_pcapng_write(struct wsbr_ctxt *ctxt, const struct iobuf_write *
     }
 
     ret = write(ctxt->pcapng_fd, buf->data, buf->len);
-    if (ret >= 0)
+    if (ret >= 0) {
+        ctxt->pcapng_file_len += ret;
         return;
+    }
     if (ctxt->pcapng_type != S_IFIFO)
         FATAL(2, "write pcapng: %m");
     if (errno == EAGAIN)
@@ -46,6 +136,15 @@ static void wsbr_pcapng_write(struct wsbr_ctxt *ctxt, const struct iobuf_write *
     ctxt->pcapng_fd = -1;
 }
 
+void wsbr_pcapng_flush(struct wsbr_ctxt *ctxt)
+{
+    if (ctxt->pcapng_buf.len)
+        wsbr_pcapng_write(ctxt, &ctxt->pcapng_buf);
+    // Keep the allocation for the next blocks
+    ctxt->pcapng_buf.len = 0;
+    ctxt->pcapng_flush_time = wsbr_pcapng_now();
+}
+
 static void wsbr_pcapng_write_start(struct wsbr_ctxt *ctxt)
 {
     static const struct pcapng_shb shb = {
@@ -65,6 +164,190 @@ static void wsbr_pcapng_write_start(struct wsbr_ctxt *ctxt)
     iobuf_free(&buf);
 }
 
+// Switch to the next file (the oldest one) when the current one is full
+static void wsbr_pcapng_rotate(struct wsbr_ctxt *ctxt, size_t block_len)
+{
+    size_t len = ctxt->pcapng_file_len + ctxt->pcapng_buf.len + block_len;
+    int ret;
+
+    if (!wsbr_pcapng_rotation_enabled(ctxt))
+        return;
+    if ((!ctxt->config.pcap_rotate_size || len <= (size_t)ctxt->config.pcap_rotate_size * 1024 * 1024) &&
+        (!ctxt->config.pcap_rotate_interval || wsbr_pcapng_now() - ctxt->pcapng_file_time < ctxt->config.pcap_rotate_interval))
+        return;
+    wsbr_pcapng_flush(ctxt);
+    ret = close(ctxt->pcapng_fd);
+    FATAL_ON(ret < 0, 2, "close pcapng: %m");
+    ctxt->pcapng_file_index = (ctxt->pcapng_file_index + 1) % ctxt->config.pcap_rotate_count;
+    wsbr_pcapng_open(ctxt);
+    wsbr_pcapng_write_start(ctxt);
+}
+
+static void wsbr_pcapng_write_epb(struct wsbr_ctxt *ctxt, const struct pcapng_epb *epb)
+{
+    // A FIFO is read live, it is not worth delaying the frames
+    int buffer_size = ctxt->pcapng_type == S_IFIFO ? 0 : ctxt->config.pcap_buffer_size;
+
+    wsbr_pcapng_rotate(ctxt, PCAPNG_EPB_SIZE_MIN + epb->pkt_len + 3 + PCAPNG_EPB_FLAGS_SIZE);
+    pcapng_write_epb(&ctxt->pcapng_buf, epb);
+    if (ctxt->pcapng_buf.len >= buffer_size)
+        wsbr_pcapng_flush(ctxt);
+}
+
+static const struct name_value *wsbr_pcapng_filter_lookup(const char *str, const struct name_value table[])
+{
+    for (int i = 0; table[i].name; i++)
+        if (!strcasecmp(table[i].name, str))
+            return &table[i];
+    return NULL;
+}
+
+int wsbr_pcapng_filter_set(struct wsbr_ctxt *ctxt, const char *expr)
+{
+    struct wsbr_pcapng_filter filter = { };
+    struct wsbr_pcapng_filter_term *term;
+    const struct name_value *nv;
+    char *str, *tok, *saveptr;
+    bool expect_term = true;
+    bool has_not = false;
+    char *end;
+    long id;
+
+    if (strlen(expr) >= sizeof(filter.expr)) {
+        WARN("pcapng filter: expression too long");
+        return -EINVAL;
+    }
+    strcpy(filter.expr, expr);
+    str = strdupa(expr);
+    for (tok = strtok_r(str, " \t", &saveptr); tok; tok = strtok_r(NULL, " \t", &saveptr)) {
+        if (!expect_term) {
+            if (!strcasecmp(tok, "or")) {
+                if (filter.term_count == WSBR_PCAPNG_FILTER_MAX_TERMS)
+                    goto too_long;
+                filter.terms[filter.term_count++].op = WSBR_PCAPNG_FILTER_OR;
+            } else if (strcasecmp(tok, "and")) {
+                goto invalid;
+            }
+            expect_term = true;
+            continue;
+        }
+        if (filter.term_count == WSBR_PCAPNG_FILTER_MAX_TERMS)
+            goto too_long;
+        term = &filter.terms[filter.term_count];
+        if (!strcasecmp(tok, "not")) {
+            term->negate = !term->negate;
+            has_not = true;
+            continue;
+        }
+        nv = wsbr_pcapng_filter_lookup(tok, wsbr_pcapng_filter_ops);
+        if (!nv)
+            goto invalid;
+        tok = strtok_r(NULL, " \t", &saveptr);
+        if (!tok)
+            goto invalid;
+        term->op = nv->val;
+        switch (term->op) {
+        case WSBR_PCAPNG_FILTER_SRC:
+        case WSBR_PCAPNG_FILTER_DST:
+        case WSBR_PCAPNG_FILTER_ADDR:
+            if (parse_byte_array(term->eui64, 8, tok))
+                goto invalid;
+            break;
+        case WSBR_PCAPNG_FILTER_TYPE:
+            nv = wsbr_pcapng_filter_lookup(tok, wsbr_pcapng_filter_types);
+            if (!nv)
+                goto invalid;
+            term->frame_types = nv->val;
+            break;
+        default:
+            id = strtol(tok, &end, 0);
+            if (*end || id < 0 || id > UINT8_MAX)
+                goto invalid;
+            term->ie_id = id;
+            break;
+        }
+        filter.term_count++;
+        expect_term = false;
+        has_not = false;
+    }
+    // An empty expression is valid, a dangling "not" is not
+    if (expect_term && (filter.term_count || has_not))
+        goto invalid;
+    ctxt->pcapng_filter = filter;
+    INFO("pcapng filter: \"%s\"", ctxt->pcapng_filter.expr);
+    return 0;
+
+too_long:
+    WARN("pcapng filter: too many terms (max %d)", WSBR_PCAPNG_FILTER_MAX_TERMS);
+    return -EINVAL;
+invalid:
+    WARN("pcapng filter: syntax error near \"%s\"", tok ? tok : "end of expression");
+    return -EINVAL;
+}
+
+static int wsbr_pcapng_frame_type(const struct wsbr_pcapng_frame *frame)
+{
+    struct ws_lutt_ie lutt;
+    struct ws_utt_ie utt;
+
+    if (ws_wh_utt_read(frame->ie_header, frame->ie_header_len, &utt))
+        return utt.message_type;
+    if (ws_wh_lutt_read(frame->ie_header, frame->ie_header_len, &lutt))
+        return lutt.message_type;
+    return -1;
+}
+
+static bool wsbr_pcapng_filter_term_match(const struct wsbr_pcapng_filter_term *term,
+                                          const struct wsbr_pcapng_frame *frame, int *frame_type)
+{
+    struct iobuf_read ie_wp;
+
+    switch (term->op) {
+    case WSBR_PCAPNG_FILTER_SRC:
+        return frame->src && !memcmp(frame->src, term->eui64, 8);
+    case WSBR_PCAPNG_FILTER_DST:
+        return frame->dst && !memcmp(frame->dst, term->eui64, 8);
+    case WSBR_PCAPNG_FILTER_ADDR:
+        return (frame->src && !memcmp(frame->src, term->eui64, 8)) ||
+               (frame->dst && !memcmp(frame->dst, term->eui64, 8));
+    case WSBR_PCAPNG_FILTER_TYPE:
+        // Only parsed once, and only if a clause needs it
+        if (*frame_type == -2)
+            *frame_type = wsbr_pcapng_frame_type(frame);
+        return *frame_type >= 0 && *frame_type < 16 && term->frame_types & (1 << *frame_type);
+    case WSBR_PCAPNG_FILTER_WH:
+        return ws_wh_subid_is_present(frame->ie_header, frame->ie_header_len, term->ie_id);
+    case WSBR_PCAPNG_FILTER_WP_SHORT:
+    case WSBR_PCAPNG_FILTER_WP_LONG:
+        ieee802154_ie_find_payload(frame->ie_payload, frame->ie_payload_len, IEEE802154_IE_ID_WP, &ie_wp);
+        if (ie_wp.err)
+            return false;
+        return ws_wp_nested_is_present(ie_wp.data, ie_wp.data_size, term->ie_id,
+                                       term->op == WSBR_PCAPNG_FILTER_WP_LONG);
+    default:
+        BUG();
+    }
+}
+
+static bool wsbr_pcapng_filter_match(const struct wsbr_pcapng_filter *filter, const struct wsbr_pcapng_frame *frame)
+{
+    const struct wsbr_pcapng_filter_term *term;
+    int frame_type = -2;
+    bool match = true;
+
+    for (int i = 0; i < filter->term_count; i++) {
+        term = &filter->terms[i];
+        if (term->op == WSBR_PCAPNG_FILTER_OR) {
+            if (match)
+                return true;
+            match = true;
+        } else if (match) {
+            match = wsbr_pcapng_filter_term_match(term, frame, &frame_type) != term->negate;
+        }
+    }
+    return match;
+}
+
 void wsbr_pcapng_init(struct wsbr_ctxt *ctxt)
 {
     struct stat statbuf;
@@ -88,26 +371,89 @@ void wsbr_pcapng_init(struct wsbr_ctxt *ctxt)
                 FATAL(2, "open %s: %m", ctxt->config.pcap_file);
         }
     } else {
-        ctxt->pcapng_fd = open(ctxt->config.pcap_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-        FATAL_ON(ctxt->pcapng_fd < 0, 2, "open %s: %m", ctxt->config.pcap_file);
+        wsbr_pcapng_open(ctxt);
     }
 
     wsbr_pcapng_write_start(ctxt);
+    ctxt->pcapng_flush_time = wsbr_pcapng_now();
+    if (wsbr_pcapng_filter_set(ctxt, ctxt->config.pcap_filter))
+        FATAL(1, "invalid \"pcap_filter\"");
+}
+
+void wsbr_pcapng_timer(struct wsbr_ctxt *ctxt)
+{
+    if (ctxt->pcapng_buf.len &&
+        wsbr_pcapng_now() - ctxt->pcapng_flush_time >= ctxt->config.pcap_flush_interval)
+        wsbr_pcapng_flush(ctxt);
 }
 
 void wsbr_pcapng_write_frame(struct wsbr_ctxt *ctxt, mcps_data_ind_t *ind, mcps_data_ie_list_t *ie)
 {
     uint8_t frame[MAC_IEEE_802_15_4G_MAX_PHY_PACKET_SIZE];
-    struct iobuf_write buf = { };
     struct pcapng_epb epb = {
         .if_id = 0, // only one interface is used
         .timestamp = ind->timestamp, // ind->timestamp is in us
+        .flags = PCAPNG_EPB_FLAGS_INBOUND,
+    };
+    struct wsbr_pcapng_frame info = {
+        .src            = ind->SrcAddrMode == MAC_ADDR_MODE_64_BIT ? ind->SrcAddr : NULL,
+        .dst            = ind->DstAddrMode == MAC_ADDR_MODE_64_BIT ? ind->DstAddr : NULL,
+        .ie_header      = ie->headerIeList,
+        .ie_header_len  = ie->headerIeListLength,
+        .ie_payload     = ie->payloadIeList,
+        .ie_payload_len = ie->payloadIeListLength,
     };
 
+    // Rebuilding the frame is the expensive part, filter before
+    if (!wsbr_pcapng_filter_match(&ctxt->pcapng_filter, &info))
+        return;
     epb.pkt_len    = wsbr_data_ind_rebuild(frame, ind, ie);
     epb.pkt_len_og = epb.pkt_len;
     epb.pkt        = frame;
-    pcapng_write_epb(&buf, &epb);
-    wsbr_pcapng_write(ctxt, &buf);
-    iobuf_free(&buf);
+    wsbr_pcapng_write_epb(ctxt, &epb);
+}
+
+void wsbr_pcapng_tx_req(struct wsbr_ctxt *ctxt, const struct mcps_data_req *req,
+                        const struct mcps_data_req_ie_list *ie, const uint8_t *frame, int frame_len)
+{
+    struct iobuf_write *buf = &ctxt->pcapng_tx[req->msduHandle];
+    struct wsbr_pcapng_frame info = {
+        .src = ctxt->rcp.eui64,
+        .dst = req->DstAddrMode == MAC_ADDR_MODE_64_BIT ? req->DstAddr : NULL,
+    };
+
+    if (ie->headerIovLength) {
+        info.ie_header     = ie->headerIeVectorList[0].iov_base;
+        info.ie_header_len = ie->headerIeVectorList[0].iov_len;
+    }
+    // The first payload vector holds the WP-IE, the second one the MPX-IE
+    if (ie->payloadIovLength) {
+        info.ie_payload     = ie->payloadIeVectorList[0].iov_base;
+        info.ie_payload_len = ie->payloadIeVectorList[0].iov_len;
+    }
+    buf->len = 0;
+    if (!wsbr_pcapng_filter_match(&ctxt->pcapng_filter, &info))
+        return;
+    // The RCP timestamps the frame, keep it until the confirmation
+    iobuf_push_data(buf, frame, frame_len);
+}
+
+void wsbr_pcapng_tx_cnf(struct wsbr_ctxt *ctxt, uint8_t handle, uint8_t status, uint32_t timestamp)
+{
+    struct iobuf_write *buf = &ctxt->pcapng_tx[handle];
+    struct pcapng_epb epb = {
+        .if_id = 0, // only one interface is used
+        .timestamp = timestamp, // in us, like received frames
+        .flags = PCAPNG_EPB_FLAGS_OUTBOUND,
+        .pkt_len = buf->len,
+        .pkt_len_og = buf->len,
+        .pkt = buf->data,
+    };
+
+    if (!buf->len)
+        return;
+    // Other errors mean the frame never went on air
+    if (status == MLME_SUCCESS || status == MLME_TX_NO_ACK)
+        wsbr_pcapng_write_epb(ctxt, &epb);
+    buf->len = 0;
 }
@@ -1,11 +1,47 @@
 #ifndef WSBR_PCAPNG_H
 #define WSBR_PCAPNG_H
+#include <stdbool.h>
+#include <stdint.h>
 
 struct wsbr_ctxt;
 struct mcps_data_ind;
 struct mcps_data_ie_list;
+struct mcps_data_req;
+struct mcps_data_req_ie_list;
+
+#define WSBR_PCAPNG_FILTER_MAX_TERMS 16
+
+struct wsbr_pcapng_filter_term {
+    uint8_t  op;
+    bool     negate;
+    uint8_t  ie_id;
+    uint16_t frame_types; // Bitmask of WS_FT_*
+    uint8_t  eui64[8];
+};
+
+/*
+ * Capture filter compiled from an expression like:
+ *     src 00:11:22:33:44:55:66:77 and type eapol or type async
+ * "and" has precedence over "or". Terms are stored in order, clauses being
+ * separated by "or" terms, so the evaluation is a single pass which skips the
+ * rest of a clause as soon as a term fails.
+ */
+struct wsbr_pcapng_filter {
+    char expr[256];
+    int term_count;
+    struct wsbr_pcapng_filter_term terms[WSBR_PCAPNG_FILTER_MAX_TERMS];
+};
 
 void wsbr_pcapng_init(struct wsbr_ctxt *ctxt);
 void wsbr_pcapng_write_frame(struct wsbr_ctxt *ctxt, struct mcps_data_ind *ind, struct mcps_data_ie_list *ie);
+void wsbr_pcapng_tx_req(struct wsbr_ctxt *ctxt, const struct mcps_data_req *req,
+                        const struct mcps_data_req_ie_list *ie, const uint8_t *frame, int frame_len);
+void wsbr_pcapng_tx_cnf(struct wsbr_ctxt *ctxt, uint8_t handle, uint8_t status, uint32_t timestamp);
+// Flush the buffered blocks older than pcap_flush_interval
+void wsbr_pcapng_timer(struct wsbr_ctxt *ctxt);
+// Write all the buffered blocks, called by the main loop before exiting
+void wsbr_pcapng_flush(struct wsbr_ctxt *ctxt);
+// An empty expression captures every frame. Return -EINVAL on syntax error.
+int wsbr_pcapng_filter_set(struct wsbr_ctxt *ctxt, const char *expr);
 
 #endif
@@ -24,7 +24,6 @@
 #include "bus_uart.h"
 #include "spinel_buffer.h"
 
-uintmax_t init_sec;
 int uart_open(const char *device, int bitrate, bool hardflow)
 {
     struct timespec init_tp;        
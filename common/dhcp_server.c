@@ -10,6 +10,7 @@
  *
  * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
  */
+#define _GNU_SOURCE
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <net/if.h>
@@ -146,12 +147,12 @@ static int dhcp_get_client_hwaddr(const uint8_t *req, size_t req_len, const uint
     ll_type = iobuf_pop_be16(&opt);
     if (duid_type != DHCPV6_DUID_TYPE_LINK_LAYER ||
         (ll_type != DHCPV6_DUID_HW_TYPE_EUI64 && ll_type != DHCPV6_DUID_HW_TYPE_IEEE802)) {
-        TRACE(TR_DROP, "drop %-9s: unsupported client ID option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : unsupported client ID option");
         return -ENOTSUP;
     }
     *hwaddr = iobuf_pop_data_ptr(&opt, 8);
     if (opt.err) {
-        TRACE(TR_DROP, "drop %-9s: malformed client ID option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : malformed client ID option");
         return -EINVAL;
     }
     return ll_type;
@@ -165,7 +166,7 @@ static uint32_t dhcp_get_identity_association_id(const uint8_t *req, size_t req_
     dhcp_get_option(req, req_len, DHCPV6_OPT_IA_NA, &opt);
     ia_id = iobuf_pop_be32(&opt);
     if (opt.err) {
-        TRACE(TR_DROP, "drop %-9s: missing IA_NA option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : missing IA_NA option");
         return UINT32_MAX;
     }
     return ia_id;
@@ -177,7 +178,7 @@ static int dhcp_check_rapid_commit(const uint8_t *req, size_t req_len)
 
     dhcp_get_option(req, req_len, DHCPV6_OPT_RAPID_COMMIT, &opt);
     if (opt.err) {
-        TRACE(TR_DROP, "drop %-9s: missing rapid commit option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : missing rapid commit option");
         return -ENOTSUP;
     }
     return 0;
@@ -193,7 +194,7 @@ static int dhcp_check_status_code(const uint8_t *req, size_t req_len)
         return 0;
     status = iobuf_pop_be16(&opt);
     if (status) {
-        TRACE(TR_DROP, "drop %-9s: status code %d", "dhcp", status);
+        TRACE_RING(TR_DROP, "drop dhcp     : status code %d", status);
         return -EFAULT;
     }
     return 0;
@@ -205,7 +206,7 @@ static int dhcp_check_elapsed_time(const uint8_t *req, size_t req_len)
 
     dhcp_get_option(req, req_len, DHCPV6_OPT_ELAPSED_TIME, &opt);
     if (opt.err) {
-        TRACE(TR_DROP, "drop %-9s: missing elapsed time option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : missing elapsed time option");
         return -EINVAL; // Elapsed Time option is mandatory
     }
     return 0;
@@ -261,18 +262,38 @@ static void dhcp_fill_identity_association(struct dhcp_server *dhcp, struct iobu
     iobuf_push_be32(reply, dhcp->valid_lifetime);
 }
 
-static void dhcp_send_reply(struct dhcp_server *dhcp, struct sockaddr_in6 *dest,
-                            struct iobuf_write *reply)
+static void dhcp_prepare_reply(struct dhcp_server *dhcp, struct sockaddr_in6 *dest,
+                               struct iobuf_write *reply, struct iovec *iov, struct mmsghdr *msg)
 {
-    int ret;
-
     dest->sin6_scope_id = dhcp->tun_if_id;
     TRACE(TR_DHCP, "tx-dhcp %-9s dst:%s",
           val_to_str(reply->data[0], dhcp_frames, "[UNK]"),
           tr_ipv6(dest->sin6_addr.s6_addr));
-    ret = sendto(dhcp->fd, reply->data, reply->len, 0,
-                 (struct sockaddr *)dest, sizeof(struct sockaddr_in6));
-    WARN_ON(ret < 0, "%s: sendmsg: %m", __func__);
+    iov->iov_base = reply->data;
+    iov->iov_len = reply->len;
+    memset(msg, 0, sizeof(*msg));
+    msg->msg_hdr.msg_name = dest;
+    msg->msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+    msg->msg_hdr.msg_iov = iov;
+    msg->msg_hdr.msg_iovlen = 1;
+}
+
+static void dhcp_send_replies(struct dhcp_server *dhcp, struct mmsghdr *msgs, int count)
+{
+    int ret;
+
+    while (count) {
+        ret = sendmmsg(dhcp->fd, msgs, count, 0);
+        if (ret < 0) {
+            // Only the first message failed, carry on with the others
+            WARN("%s: sendmmsg: %m", __func__);
+            ret = 1;
+        } else {
+            dhcp->stats.tx_count += ret;
+        }
+        msgs += ret;
+        count -= ret;
+    }
 }
 
 static int dhcp_handle_request_fwd(struct dhcp_server *dhcp,
@@ -298,7 +319,7 @@ static int dhcp_handle_request_fwd(struct dhcp_server *dhcp,
     }
     if (dhcp_get_option(iobuf_ptr(req), iobuf_remaining_size(req),
                         DHCPV6_OPT_RELAY, &opt_relay) < 0) {
-        TRACE(TR_DROP, "drop %-9s: missing relay option", "dhcp");
+        TRACE_RING(TR_DROP, "drop dhcp     : missing relay option");
         return -EINVAL;
     }
     if (dhcp_handle_request(dhcp, &opt_relay, &relay_reply))
@@ -323,7 +344,7 @@ static int dhcp_handle_request(struct dhcp_server *dhcp,
     if (msg_type == DHCPV6_MSG_RELAY_FWD)
         return dhcp_handle_request_fwd(dhcp, req, reply);
     if (msg_type != DHCPV6_MSG_SOLICIT) {
-        TRACE(TR_DROP, "drop %-9s: unsupported msg-type 0x%02x", "dhcp", msg_type);
+        TRACE_RING(TR_DROP, "drop dhcp     : unsupported msg-type 0x%02x", msg_type);
         return -EINVAL;
     }
 
@@ -350,27 +371,91 @@ static int dhcp_handle_request(struct dhcp_server *dhcp,
     return 0;
 }
 
-void dhcp_recv(struct dhcp_server *dhcp)
+// The kernel attaches its cumulative drop counter to the received messages, so
+// an overrun is only accounted once the next request is read.
+static void dhcp_update_overruns(struct dhcp_server *dhcp, struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+    uint32_t drops;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+        memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+        if (drops != dhcp->stats.rx_overrun_count)
+            TRACE_RING(TR_DROP, "drop dhcp     : socket queue full (%u requests)",
+                       drops - dhcp->stats.rx_overrun_count);
+        dhcp->stats.rx_overrun_count = drops;
+    }
+}
+
+static int dhcp_recv_batch(struct dhcp_server *dhcp)
 {
-    socklen_t src_addr_len = sizeof(struct sockaddr_in6);
-    struct sockaddr_in6 src_addr;
-    struct iobuf_read req = { };
-    struct iobuf_write reply = { };
-    uint8_t buf[1024];
-
-    req.data = buf;
-    req.data_size = recvfrom(dhcp->fd, buf, sizeof(buf), 0,
-                             (struct sockaddr *)&src_addr, &src_addr_len);
-    if (src_addr.sin6_family != AF_INET6) {
-        TRACE(TR_DROP, "drop %-9s: not IPv6", "dhcp");
-        return;
+    uint8_t cmsg_buf[DHCP_BATCH_SIZE][CMSG_SPACE(sizeof(uint32_t))];
+    struct iobuf_write reply[DHCP_BATCH_SIZE] = { };
+    struct sockaddr_in6 src_addr[DHCP_BATCH_SIZE];
+    struct mmsghdr rx_msgs[DHCP_BATCH_SIZE];
+    struct mmsghdr tx_msgs[DHCP_BATCH_SIZE];
+    struct iovec rx_iov[DHCP_BATCH_SIZE];
+    struct iovec tx_iov[DHCP_BATCH_SIZE];
+    uint8_t buf[DHCP_BATCH_SIZE][1024];
+    struct iobuf_read req;
+    int rx_count, tx_count = 0;
+
+    memset(rx_msgs, 0, sizeof(rx_msgs));
+    for (int i = 0; i < DHCP_BATCH_SIZE; i++) {
+        rx_iov[i].iov_base = buf[i];
+        rx_iov[i].iov_len = sizeof(buf[i]);
+        rx_msgs[i].msg_hdr.msg_name = &src_addr[i];
+        rx_msgs[i].msg_hdr.msg_namelen = sizeof(src_addr[i]);
+        rx_msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        rx_msgs[i].msg_hdr.msg_control = cmsg_buf[i];
+        rx_msgs[i].msg_hdr.msg_controllen = sizeof(cmsg_buf[i]);
+    }
+    rx_count = recvmmsg(dhcp->fd, rx_msgs, DHCP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    if (rx_count < 0) {
+        WARN_ON(errno != EAGAIN && errno != EWOULDBLOCK, "%s: recvmmsg: %m", __func__);
+        return 0;
+    }
+    if (!rx_count)
+        return 0;
+    dhcp->stats.rx_count += rx_count;
+    dhcp->stats.rx_batch_count++;
+    if (rx_count > dhcp->stats.rx_batch_max)
+        dhcp->stats.rx_batch_max = rx_count;
+    dhcp_update_overruns(dhcp, &rx_msgs[rx_count - 1].msg_hdr);
+
+    for (int i = 0; i < rx_count; i++) {
+        memset(&req, 0, sizeof(req));
+        req.data = buf[i];
+        req.data_size = rx_msgs[i].msg_len;
+        if (src_addr[i].sin6_family != AF_INET6) {
+            TRACE_RING(TR_DROP, "drop dhcp     : not IPv6");
+            continue;
+        }
+        TRACE(TR_DHCP, "rx-dhcp %-9s src:%s",
+              val_to_str(req.data[0], dhcp_frames, "[UNK]"),
+              tr_ipv6(src_addr[i].sin6_addr.s6_addr));
+        // Discard what a rejected request may have written
+        reply[tx_count].len = 0;
+        if (dhcp_handle_request(dhcp, &req, &reply[tx_count]))
+            continue;
+        dhcp_prepare_reply(dhcp, &src_addr[i], &reply[tx_count], &tx_iov[tx_count], &tx_msgs[tx_count]);
+        tx_count++;
     }
-    TRACE(TR_DHCP, "rx-dhcp %-9s src:%s",
-          val_to_str(req.data[0], dhcp_frames, "[UNK]"),
-          tr_ipv6(src_addr.sin6_addr.s6_addr));
-    if (!dhcp_handle_request(dhcp, &req, &reply))
-        dhcp_send_reply(dhcp, &src_addr, &reply);
-    iobuf_free(&reply);
+    dhcp_send_replies(dhcp, tx_msgs, tx_count);
+    for (int i = 0; i < DHCP_BATCH_SIZE; i++)
+        iobuf_free(&reply[i]);
+    return rx_count;
+}
+
+void dhcp_recv(struct dhcp_server *dhcp)
+{
+    // A partial batch means the socket queue has been drained
+    for (int i = 0; i < DHCP_BATCH_COUNT_MAX; i++)
+        if (dhcp_recv_batch(dhcp) < DHCP_BATCH_SIZE)
+            break;
 }
 
 void dhcp_start(struct dhcp_server *dhcp, const char *tun_dev, uint8_t *hwaddr, uint8_t *prefix)
@@ -395,6 +480,8 @@ void dhcp_start(struct dhcp_server *dhcp, const char *tun_dev, uint8_t *hwaddr,
         FATAL(1, "%s: socket: %m", __func__);
     if (setsockopt(dhcp->fd, SOL_SOCKET, SO_BINDTODEVICE, tun_dev, IF_NAMESIZE) < 0)
         FATAL(1, "%s: setsockopt: %m", __func__);
+    if (setsockopt(dhcp->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof(int)) < 0)
+        FATAL(1, "%s: setsockopt: %m", __func__);
     if (bind(dhcp->fd, (struct sockaddr *) &sockaddr, sizeof(sockaddr)) < 0)
         FATAL(1, "%s: bind: %m", __func__);
 }
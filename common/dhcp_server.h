@@ -23,12 +23,25 @@
  *
  * Once started, the caller has to poll (with poll() or equivalent)
  * dhcp_server->fd for any incoming frames. dhcp_recv() has to be called
- * dhcp_server->fd is ready.
+ * dhcp_server->fd is ready. It processes the pending requests by batches of
+ * DHCP_BATCH_SIZE, and returns after DHCP_BATCH_COUNT_MAX batches so the other
+ * file descriptors are not starved during a mass rejoin.
  */
 
 #define DHCPV6_SERVER_PORT 547
 #define DHCPV6_CLIENT_PORT 546
 
+#define DHCP_BATCH_SIZE      16
+#define DHCP_BATCH_COUNT_MAX 4
+
+struct dhcp_server_stats {
+    uint32_t rx_count;         // Requests received
+    uint32_t tx_count;         // Replies sent
+    uint32_t rx_batch_count;   // Non-empty calls to recvmmsg()
+    uint32_t rx_batch_max;     // Largest number of requests read at once
+    uint32_t rx_overrun_count; // Requests dropped by the kernel, the socket queue was full
+};
+
 struct dhcp_server {
     int fd;
     int tun_if_id;
@@ -36,6 +49,7 @@ struct dhcp_server {
     uint32_t valid_lifetime;
     uint8_t hwaddr[8];
     uint8_t prefix[8];
+    struct dhcp_server_stats stats;
 };
 
 void dhcp_start(struct dhcp_server *dhcp, const char *tun_dev, uint8_t *hwaddr, uint8_t *prefix);
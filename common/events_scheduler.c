@@ -48,7 +48,7 @@ static int8_t event_tasklet_get_free_id(void)
     return -1;
 }
 
-static void event_core_write(struct event_storage *event)
+static void event_core_insert(struct event_storage *event)
 {
     struct events_scheduler *ctxt = g_event_scheduler;
 
@@ -57,11 +57,15 @@ static void event_core_write(struct event_storage *event)
     ns_list_foreach(struct event_storage, event_tmp, &ctxt->event_queue) {
         if (event_tmp->data.priority > event->data.priority) {
             ns_list_add_before(&ctxt->event_queue, event_tmp, event);
-            event_scheduler_signal();
             return;
         }
     }
     ns_list_add_to_end(&ctxt->event_queue, event);
+}
+
+static void event_core_write(struct event_storage *event)
+{
+    event_core_insert(event);
     event_scheduler_signal();
 }
 
@@ -109,6 +113,32 @@ void event_send_user_allocated(struct event_storage *event)
     event_core_write(event);
 }
 
+void event_send_from_thread(const struct event_payload *event)
+{
+    struct events_scheduler *ctxt = g_event_scheduler;
+    struct event_storage *event_tmp;
+
+    BUG_ON(!ctxt);
+    event_tmp = malloc(sizeof(struct event_storage));
+    event_tmp->allocator = ARM_LIB_EVENT_DYNAMIC;
+    event_tmp->state = ARM_LIB_EVENT_UNQUEUED;
+    memcpy(&event_tmp->data, event, sizeof(struct event_payload));
+    pthread_mutex_lock(&ctxt->thread_event_lock);
+    ns_list_add_to_end(&ctxt->thread_event_queue, event_tmp);
+    pthread_mutex_unlock(&ctxt->thread_event_lock);
+    event_scheduler_signal();
+}
+
+static void event_scheduler_thread_events_get(struct events_scheduler *ctxt)
+{
+    pthread_mutex_lock(&ctxt->thread_event_lock);
+    ns_list_foreach_safe(struct event_storage, event, &ctxt->thread_event_queue) {
+        ns_list_remove(&ctxt->thread_event_queue, event);
+        event_core_insert(event);
+    }
+    pthread_mutex_unlock(&ctxt->thread_event_lock);
+}
+
 void event_cancel(struct event_storage *event)
 {
     struct events_scheduler *ctxt = g_event_scheduler;
@@ -147,10 +177,12 @@ void event_scheduler_set_active_tasklet(int8_t tasklet)
 bool event_scheduler_dispatch_event(void)
 {
     struct events_scheduler *ctxt = g_event_scheduler;
-    struct event_storage *event = ns_list_get_first(&ctxt->event_queue);
+    struct event_storage *event;
     struct event_tasklet *tasklet;
 
     BUG_ON(!ctxt);
+    event_scheduler_thread_events_get(ctxt);
+    event = ns_list_get_first(&ctxt->event_queue);
     ctxt->curr_tasklet = 0;
     if (!event)
         return false;
@@ -193,4 +225,6 @@ void event_scheduler_init(struct events_scheduler *ctxt)
 
     ns_list_init(&ctxt->event_queue);
     ns_list_init(&ctxt->event_tasklet_list);
+    ns_list_init(&ctxt->thread_event_queue);
+    pthread_mutex_init(&ctxt->thread_event_lock, NULL);
 }
@@ -14,6 +14,7 @@
 #define EVENTS_SCHEDULER_H
 #include <stdbool.h>
 #include <stdint.h>
+#include <pthread.h>
 #include "common/ns_list.h"
 
 enum event_priority {
@@ -58,6 +59,8 @@ struct events_scheduler {
     int8_t curr_tasklet;
     NS_LIST_HEAD(struct event_tasklet, link) event_tasklet_list;
     NS_LIST_HEAD(struct event_storage, link) event_queue;
+    pthread_mutex_t thread_event_lock;
+    NS_LIST_HEAD(struct event_storage, link) thread_event_queue;
 };
 
 /**
@@ -140,6 +143,17 @@ int8_t event_send(const struct event_payload *event);
  */
 void event_send_user_allocated(struct event_storage *event);
 
+/**
+ * \brief Send event to event scheduler from another thread.
+ *
+ * \param event pointer to pushed event.
+ *
+ * Same as event_send() but can be called from any thread. The event is
+ * inserted in the event queue by the next event_scheduler_dispatch_event()
+ * of the main thread. The receiver is not checked.
+ */
+void event_send_from_thread(const struct event_payload *event);
+
 /**
  * \brief Event handler callback register
  *
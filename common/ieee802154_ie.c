@@ -11,6 +11,8 @@
  * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
  */
 #include <errno.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "common/bits.h"
 #include "common/endian.h"
@@ -165,3 +167,143 @@ int ieee802154_ie_find_nested(const uint8_t *data, size_t len, uint8_t id, struc
     }
     return -ENOENT;
 }
+
+static bool ieee802154_ie_index_decode(uint8_t type, uint16_t ie_hdr, uint8_t *key, uint16_t *ie_len)
+{
+    switch (type) {
+    case IEEE802154_IE_INDEX_HEADER:
+        if (FIELD_GET(IEEE802154_IE_TYPE_MASK, ie_hdr) != IEEE802154_IE_TYPE_HEADER)
+            return false;
+        *key    = FIELD_GET(IEEE802154_IE_HEADER_ID_MASK, ie_hdr);
+        *ie_len = FIELD_GET(IEEE802154_IE_HEADER_LEN_MASK, ie_hdr);
+        return true;
+    case IEEE802154_IE_INDEX_PAYLOAD:
+        if (FIELD_GET(IEEE802154_IE_TYPE_MASK, ie_hdr) != IEEE802154_IE_TYPE_PAYLOAD)
+            return false;
+        *key    = FIELD_GET(IEEE802154_IE_PAYLOAD_ID_MASK, ie_hdr);
+        *ie_len = FIELD_GET(IEEE802154_IE_PAYLOAD_LEN_MASK, ie_hdr);
+        return true;
+    case IEEE802154_IE_INDEX_NESTED:
+        // Long and short nested IDs share the key space, long IDs are 4-bit
+        if (FIELD_GET(IEEE802154_IE_TYPE_MASK, ie_hdr) == IEEE802154_IE_TYPE_NESTED_LONG) {
+            *key    = 0x80 | FIELD_GET(IEEE802154_IE_NESTED_LONG_ID_MASK, ie_hdr);
+            *ie_len = FIELD_GET(IEEE802154_IE_NESTED_LONG_LEN_MASK, ie_hdr);
+        } else {
+            *key    = FIELD_GET(IEEE802154_IE_NESTED_SHORT_ID_MASK, ie_hdr);
+            *ie_len = FIELD_GET(IEEE802154_IE_NESTED_SHORT_LEN_MASK, ie_hdr);
+        }
+        return true;
+    default:
+        BUG();
+    }
+}
+
+static void ieee802154_ie_index_build(struct ieee802154_ie_index *index, const uint8_t *data, size_t len, uint8_t type)
+{
+    uint8_t last[256] = { };
+    size_t offset = 0;
+    uint16_t ie_len;
+    uint8_t key;
+    int i;
+
+    memset(index, 0, offsetof(struct ieee802154_ie_index, ie));
+    index->data = data;
+    index->len = len;
+    index->type = type;
+    // Offsets are stored on 16 bits, longer lists are never indexed
+    while (len <= UINT16_MAX && len - offset >= 2 && index->count < IEEE802154_IE_INDEX_SIZE) {
+        if (!ieee802154_ie_index_decode(type, read_le16(data + offset), &key, &ie_len))
+            break;
+        if (len - offset - 2 < ie_len)
+            break;
+        i = index->count++;
+        index->ie[i].offset = offset + 2;
+        index->ie[i].len    = ie_len;
+        index->ie[i].key    = key;
+        index->ie[i].next   = 0;
+        if (last[key])
+            index->ie[last[key] - 1].next = i + 1;
+        else
+            index->first[key] = i + 1;
+        last[key] = i + 1;
+        offset += 2 + ie_len;
+    }
+    index->end = offset;
+}
+
+void ieee802154_ie_index_header(struct ieee802154_ie_index *index, const uint8_t *data, size_t len)
+{
+    ieee802154_ie_index_build(index, data, len, IEEE802154_IE_INDEX_HEADER);
+}
+
+void ieee802154_ie_index_payload(struct ieee802154_ie_index *index, const uint8_t *data, size_t len)
+{
+    ieee802154_ie_index_build(index, data, len, IEEE802154_IE_INDEX_PAYLOAD);
+}
+
+void ieee802154_ie_index_nested(struct ieee802154_ie_index *index, const uint8_t *data, size_t len)
+{
+    ieee802154_ie_index_build(index, data, len, IEEE802154_IE_INDEX_NESTED);
+}
+
+// pos is the position + 1 of the IE in index->ie[], 0 to search linearly
+// from offset
+static int ieee802154_ie_index_get(const struct ieee802154_ie_index *index, uint8_t pos, size_t offset,
+                                   uint8_t id, bool is_long, struct iobuf_read *ie_content)
+{
+    if (!pos) {
+        switch (index->type) {
+        case IEEE802154_IE_INDEX_HEADER:
+            return ieee802154_ie_find_header(index->data + offset, index->len - offset, id, ie_content);
+        case IEEE802154_IE_INDEX_PAYLOAD:
+            return ieee802154_ie_find_payload(index->data + offset, index->len - offset, id, ie_content);
+        default:
+            return ieee802154_ie_find_nested(index->data + offset, index->len - offset, id, ie_content, is_long);
+        }
+    }
+    memset(ie_content, 0, sizeof(struct iobuf_read));
+    ie_content->data      = index->data + index->ie[pos - 1].offset;
+    ie_content->data_size = index->ie[pos - 1].len;
+    return ie_content->data_size;
+}
+
+int ieee802154_ie_index_find(const struct ieee802154_ie_index *index, uint8_t id, struct iobuf_read *ie_content)
+{
+    BUG_ON(index->type == IEEE802154_IE_INDEX_NESTED);
+    return ieee802154_ie_index_get(index, index->first[id], index->end, id, false, ie_content);
+}
+
+int ieee802154_ie_index_find_nested(const struct ieee802154_ie_index *index, uint8_t id, struct iobuf_read *ie_content, bool is_long)
+{
+    BUG_ON(index->type != IEEE802154_IE_INDEX_NESTED);
+    // IDs too large for their format never match
+    if (id > (is_long ? 0x0f : 0x7f))
+        return ieee802154_ie_index_get(index, 0, index->end, id, is_long, ie_content);
+    return ieee802154_ie_index_get(index, index->first[is_long ? 0x80 | id : id], index->end, id, is_long, ie_content);
+}
+
+int ieee802154_ie_index_find_next(const struct ieee802154_ie_index *index, struct iobuf_read *ie_content)
+{
+    size_t offset = ie_content->data - index->data;
+    int lo = 0, hi = index->count, mid;
+    uint16_t ie_len;
+    bool is_long;
+    uint8_t key;
+
+    BUG_ON(ie_content->err || !ie_content->data);
+    ieee802154_ie_index_decode(index->type, read_le16(ie_content->data - 2), &key, &ie_len);
+    is_long = index->type == IEEE802154_IE_INDEX_NESTED && (key & 0x80);
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (index->ie[mid].offset < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < index->count && index->ie[lo].offset == offset)
+        return ieee802154_ie_index_get(index, index->ie[lo].next, index->end,
+                                       is_long ? key & 0x7f : key, is_long, ie_content);
+    // IE found by a linear search past the indexed part
+    return ieee802154_ie_index_get(index, 0, offset + ie_content->data_size,
+                                   is_long ? key & 0x7f : key, is_long, ie_content);
+}
@@ -72,4 +72,44 @@ int ieee802154_ie_find_header(const uint8_t *data, size_t len, uint8_t id, struc
 int ieee802154_ie_find_payload(const uint8_t *data, size_t len, uint8_t id, struct iobuf_read *ie_content);
 int ieee802154_ie_find_nested(const uint8_t *data, size_t len, uint8_t id, struct iobuf_read *ie_content, bool is_long);
 
+/*
+ * An index is built in a single pass over an IE list and then answers the
+ * same queries as ieee802154_ie_find_*() in constant time. Lookups return
+ * exactly what the matching ieee802154_ie_find_*() call would return on the
+ * same list, including for malformed lists: parsing stops at the first
+ * malformed IE (or when the index is full) and lookups for IEs not found
+ * before that point fall back to a linear search from there.
+ *
+ * ieee802154_ie_index_find_next() returns the next IE with the same ID as the
+ * IE previously returned in ie_content, which is equivalent to calling
+ * ieee802154_ie_find_*() again right after the end of that IE.
+ */
+#define IEEE802154_IE_INDEX_SIZE 32
+
+struct ieee802154_ie_index {
+    const uint8_t *data;
+    size_t len;
+    size_t end;         // Offset of the first IE not indexed
+    uint8_t type;       // IEEE802154_IE_INDEX_*
+    uint8_t count;
+    uint8_t first[256]; // Position + 1 in ie[] of the first IE of each key
+    struct {
+        uint16_t offset; // Offset of the IE content
+        uint16_t len;
+        uint8_t key;
+        uint8_t next;    // Position + 1 in ie[] of the next IE with the same key
+    } ie[IEEE802154_IE_INDEX_SIZE];
+};
+
+#define IEEE802154_IE_INDEX_HEADER  0
+#define IEEE802154_IE_INDEX_PAYLOAD 1
+#define IEEE802154_IE_INDEX_NESTED  2
+
+void ieee802154_ie_index_header(struct ieee802154_ie_index *index, const uint8_t *data, size_t len);
+void ieee802154_ie_index_payload(struct ieee802154_ie_index *index, const uint8_t *data, size_t len);
+void ieee802154_ie_index_nested(struct ieee802154_ie_index *index, const uint8_t *data, size_t len);
+int ieee802154_ie_index_find(const struct ieee802154_ie_index *index, uint8_t id, struct iobuf_read *ie_content);
+int ieee802154_ie_index_find_nested(const struct ieee802154_ie_index *index, uint8_t id, struct iobuf_read *ie_content, bool is_long);
+int ieee802154_ie_index_find_next(const struct ieee802154_ie_index *index, struct iobuf_read *ie_content);
+
 #endif
@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glob.h>
 #include "common/log.h"
 
@@ -44,7 +45,12 @@ struct storage_parse_info *storage_open(const char *filename, const char *mode)
     info = malloc(sizeof(struct storage_parse_info));
     memset(info, 0, sizeof(struct storage_parse_info));
     snprintf(info->filename, sizeof(info->filename), "%s", filename);
-    info->file = fopen(info->filename, mode);
+    if (mode[0] == 'w') {
+        snprintf(info->tmp_filename, sizeof(info->tmp_filename), "%s.tmp", filename);
+        info->file = fopen(info->tmp_filename, mode);
+    } else {
+        info->file = fopen(info->filename, mode);
+    }
     if (!info->file) {
         free(info);
         return NULL;
@@ -65,15 +71,58 @@ struct storage_parse_info *storage_open_prefix(const char *filename, const char
     return info;
 }
 
+static int storage_sync_dir(const char *filename)
+{
+    char *tmp = strdupa(filename);
+    int ret, fd;
+
+    fd = open(dirname(tmp), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return -1;
+    ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+// Data is written to a temporary file, flushed to the disk then renamed over
+// the destination. So, a reader (or a restart after a power loss) always sees
+// either the previous or the new content, never a truncated file.
+static int storage_commit(struct storage_parse_info *info)
+{
+    int ret;
+
+    ret = fflush(info->file);
+    if (!ret)
+        ret = fsync(fileno(info->file));
+    ret |= fclose(info->file);
+    if (ret) {
+        WARN("%s: %m", info->tmp_filename);
+        unlink(info->tmp_filename);
+        return ret;
+    }
+    ret = rename(info->tmp_filename, info->filename);
+    if (ret) {
+        WARN("rename %s: %m", info->filename);
+        unlink(info->tmp_filename);
+        return ret;
+    }
+    ret = storage_sync_dir(info->filename);
+    WARN_ON(ret, "fsync %s: %m", info->filename);
+    return ret;
+}
+
 int storage_close(struct storage_parse_info *info)
 {
-    FILE *file;
+    int ret;
 
     BUG_ON(!info);
     BUG_ON(!info->file);
-    file = info->file;
+    if (info->tmp_filename[0])
+        ret = storage_commit(info);
+    else
+        ret = fclose(info->file);
     free(info);
-    return fclose(file);
+    return ret;
 }
 
 static char *storage_get_line(struct storage_parse_info *info)
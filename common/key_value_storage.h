@@ -30,6 +30,9 @@
  * In addition, if storage_parse_line() detects a number under brackets (like in
  * "gtk[0]"), the value under bracket is placed in key_array_index (otherwise,
  * key_array_index value is UINT_MAX)
+ *
+ * Files opened for writing are written to "<filename>.tmp". storage_close()
+ * syncs this file to the disk and atomically renames it to filename.
  */
 
 #include <stdio.h>
@@ -38,6 +41,7 @@
 struct storage_parse_info {
     FILE *file;
     char filename[PATH_MAX];
+    char tmp_filename[PATH_MAX];
     int linenr;
     char line[256];
     char key[256], value[256];
@@ -10,18 +10,50 @@
  *
  * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
  */
+#include <stdatomic.h>
+#include <semaphore.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <sched.h>
 #include <ctype.h>
 
 #include "bits.h"
+#include "utils.h"
 #include "log.h"
 
 FILE *g_trace_stream = NULL;
 unsigned int g_enabled_traces = 0;
 bool g_enable_color_traces = true;
+int g_log_level = LOG_LEVEL_DEBUG;
+uintmax_t init_sec;
+
+// Provided by the linker, weak in case no TRACE_RING() is linked in
+extern const char __start_trace_ring_fmt[] __attribute__((weak));
+extern const char __stop_trace_ring_fmt[] __attribute__((weak));
+
+static struct trace_ring_entry trace_ring[TRACE_RING_SIZE];
+static atomic_uint trace_ring_idx;
+
+/*
+ * Single producer, single consumer byte ring. head is only written by the
+ * producer and tail by the writer thread. The producer publishes whole lines,
+ * so the writer never has to care about line boundaries.
+ */
+static struct {
+    char *buf;
+    size_t size; // Power of 2
+    atomic_size_t head;
+    atomic_size_t tail;
+    unsigned int dropped; // Only accessed by the producer
+    atomic_bool stop;
+    sem_t sem;
+    pthread_t producer;
+    pthread_t thread;
+    bool running;
+} log_ring;
 
 char *str_bytes(const void *in_start, size_t in_len, const void **in_done, char *out_start, size_t out_len, int opt)
 {
@@ -206,22 +238,157 @@ void __tr_exit()
         trace_idx = 0;
 }
 
-void __tr_vprintf(const char *color, const char *fmt, va_list ap)
+static void tr_stream_init()
 {
     if (!g_trace_stream) {
         g_trace_stream = stdout;
         setlinebuf(stdout);
         g_enable_color_traces = isatty(fileno(g_trace_stream));
     }
+}
+
+static bool log_ring_push(const char *data, size_t len)
+{
+    size_t head = atomic_load_explicit(&log_ring.head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&log_ring.tail, memory_order_acquire);
+    size_t off, chunk;
+
+    if (log_ring.size - (head - tail) < len)
+        return false;
+    off = head & (log_ring.size - 1);
+    chunk = MIN(len, log_ring.size - off);
+    memcpy(log_ring.buf + off, data, chunk);
+    memcpy(log_ring.buf, data + chunk, len - chunk);
+    atomic_store_explicit(&log_ring.head, head + len, memory_order_release);
+    return true;
+}
+
+static void log_ring_write(const char *line, size_t len)
+{
+    char notice[64];
+    int ret;
+
+    if (log_ring.dropped) {
+        ret = snprintf(notice, sizeof(notice), "[%u trace lines dropped]\n", log_ring.dropped);
+        if (!log_ring_push(notice, ret)) {
+            log_ring.dropped++;
+            return;
+        }
+        log_ring.dropped = 0;
+    }
+    if (!log_ring_push(line, len))
+        log_ring.dropped++;
+    sem_post(&log_ring.sem);
+}
+
+static void *log_ring_thread(void *arg)
+{
+    size_t head, tail, off, chunk;
+    bool stop;
+
+    tail = atomic_load_explicit(&log_ring.tail, memory_order_relaxed);
+    do {
+        while (sem_wait(&log_ring.sem) < 0)
+            ;
+        // Read stop first, so the final pass sees every published line
+        stop = atomic_load(&log_ring.stop);
+        head = atomic_load_explicit(&log_ring.head, memory_order_acquire);
+        while (tail != head) {
+            off = tail & (log_ring.size - 1);
+            chunk = MIN(head - tail, log_ring.size - off);
+            fwrite(log_ring.buf + off, 1, chunk, g_trace_stream);
+            tail += chunk;
+            atomic_store_explicit(&log_ring.tail, tail, memory_order_release);
+        }
+        fflush(g_trace_stream);
+    } while (!stop);
+    return NULL;
+}
+
+void log_async_start(size_t size)
+{
+    sigset_t set, oldset;
+    int ret;
+
+    BUG_ON(log_ring.running);
+    BUG_ON(size & (size - 1), "size must be a power of 2");
+    if (!size)
+        return;
+    tr_stream_init();
+    log_ring.buf = malloc(size);
+    FATAL_ON(!log_ring.buf, 2, "%s: %m", __func__);
+    log_ring.size = size;
+    sem_init(&log_ring.sem, 0, 0);
+    log_ring.producer = pthread_self();
+    // Signals must be handled by the main thread
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &oldset);
+    ret = pthread_create(&log_ring.thread, NULL, log_ring_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    FATAL_ON(ret, 2, "pthread_create: %s", strerror(ret));
+    log_ring.running = true;
+    atexit(log_async_stop);
+}
+
+void log_async_stop()
+{
+    if (!log_ring.running || !pthread_equal(pthread_self(), log_ring.producer))
+        return;
+    log_ring.running = false;
+    atomic_store(&log_ring.stop, true);
+    sem_post(&log_ring.sem);
+    pthread_join(log_ring.thread, NULL);
+    if (log_ring.dropped)
+        fprintf(g_trace_stream, "[%u trace lines dropped]\n", log_ring.dropped);
+    log_ring.dropped = 0;
+    fflush(g_trace_stream);
+}
+
+// Wait for the writer thread, typically before the process dies
+void __tr_flush()
+{
+    if (log_ring.running && pthread_equal(pthread_self(), log_ring.producer))
+        while (atomic_load_explicit(&log_ring.tail, memory_order_acquire) !=
+               atomic_load_explicit(&log_ring.head, memory_order_relaxed))
+            sched_yield();
+    if (g_trace_stream)
+        fflush(g_trace_stream);
+}
+
+void __tr_vprintf(const char *color, const char *fmt, va_list ap)
+{
+    char line[1024];
+    bool use_color;
+    size_t len = 0;
+    int ret;
+
+    tr_stream_init();
+    use_color = color && strcmp(color, "0") && g_enable_color_traces;
+
+    if (!log_ring.running || !pthread_equal(pthread_self(), log_ring.producer)) {
+        if (use_color) {
+            fprintf(g_trace_stream, "\x1B[%sm", color);
+            vfprintf(g_trace_stream, fmt, ap);
+            fprintf(g_trace_stream, "\x1B[0m\n");
+        } else {
+            vfprintf(g_trace_stream, fmt, ap);
+            fprintf(g_trace_stream, "\n");
+        }
+        return;
+    }
 
-    if (color && strcmp(color, "0") && g_enable_color_traces) {
-        fprintf(g_trace_stream, "\x1B[%sm", color);
-        vfprintf(g_trace_stream, fmt, ap);
-        fprintf(g_trace_stream, "\x1B[0m\n");
-    } else {
-        vfprintf(g_trace_stream, fmt, ap);
-        fprintf(g_trace_stream, "\n");
+    // Keep room for the color reset and the newline
+    if (use_color)
+        len += snprintf(line, sizeof(line), "\x1B[%sm", color);
+    ret = vsnprintf(line + len, sizeof(line) - len - 5, fmt, ap);
+    if (ret > 0)
+        len += MIN((size_t)ret, sizeof(line) - len - 6);
+    if (use_color) {
+        memcpy(line + len, "\x1B[0m", 4);
+        len += 4;
     }
+    line[len++] = '\n';
+    log_ring_write(line, len);
 }
 
 void __tr_printf(const char *color, const char *fmt, ...)
@@ -233,6 +400,130 @@ void __tr_printf(const char *color, const char *fmt, ...)
     va_end(ap);
 }
 
+int trace_ring_format(char *out, size_t size, const char *fmt, const uint64_t *args, int argc)
+{
+    size_t len = 0;
+    const char *start;
+    uint64_t arg;
+    char spec[32];
+    bool wide;
+    int i = 0;
+    int ret;
+    int n;
+
+    BUG_ON(!size);
+    while (*fmt) {
+        if (*fmt != '%' || fmt[1] == '%') {
+            if (len < size - 1)
+                out[len] = *fmt;
+            len++;
+            fmt += *fmt == '%' ? 2 : 1;
+            continue;
+        }
+        start = fmt++;
+        fmt += strspn(fmt, "-+ #0");
+        fmt += strspn(fmt, "0123456789");
+        if (*fmt == '.') {
+            fmt++;
+            fmt += strspn(fmt, "0123456789");
+        }
+        n = MIN((size_t)(fmt - start), sizeof(spec) - 4);
+        memcpy(spec, start, n);
+        wide = false;
+        for (; *fmt && strchr("hljzt", *fmt); fmt++)
+            if (*fmt != 'h')
+                wide = true;
+        arg = i < argc ? args[i++] : 0;
+        switch (*fmt) {
+        case 'd':
+        case 'i':
+            strcpy(spec + n, "lld");
+            ret = snprintf(len < size ? out + len : NULL, len < size ? size - len : 0, spec,
+                           wide ? (long long)(int64_t)arg : (long long)(int32_t)arg);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            sprintf(spec + n, "ll%c", *fmt);
+            ret = snprintf(len < size ? out + len : NULL, len < size ? size - len : 0, spec,
+                           wide ? (unsigned long long)arg : (unsigned long long)(uint32_t)arg);
+            break;
+        case 'c':
+            strcpy(spec + n, "c");
+            ret = snprintf(len < size ? out + len : NULL, len < size ? size - len : 0, spec, (int)arg);
+            break;
+        default:
+            // Not an integer conversion, the argument can't be rendered
+            ret = snprintf(len < size ? out + len : NULL, len < size ? size - len : 0, "<?>");
+            break;
+        }
+        if (*fmt)
+            fmt++;
+        len += MAX(ret, 0);
+    }
+    out[MIN(len, size - 1)] = '\0';
+    return len;
+}
+
+void __trace_ring(unsigned int category, bool print, const char *fmt, const uint64_t *args, int argc)
+{
+    struct trace_ring_entry *entry;
+    struct timespec tp;
+    char buf[256];
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    entry = &trace_ring[atomic_fetch_add_explicit(&trace_ring_idx, 1, memory_order_relaxed) % TRACE_RING_SIZE];
+    entry->time_s = tp.tv_sec - init_sec;
+    entry->time_ns = tp.tv_nsec;
+    entry->fmt = fmt - __start_trace_ring_fmt;
+    entry->category = category;
+    entry->argc = argc;
+    memcpy(entry->args, args, argc * sizeof(uint64_t));
+    if (print && (g_enabled_traces & category)) {
+        trace_ring_format(buf, sizeof(buf), fmt, args, argc);
+        __PRINT(90, "%6ju.%03ju: %s", (uintmax_t)entry->time_s, (uintmax_t)entry->time_ns / 1000000, buf);
+    }
+}
+
+static int trace_ring_write(int fd, const void *data, size_t len)
+{
+    const uint8_t *ptr = data;
+    ssize_t ret;
+
+    while (len) {
+        ret = write(fd, ptr, len);
+        if (ret < 0)
+            return -1;
+        ptr += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+int trace_ring_dump(int fd)
+{
+    unsigned int idx = atomic_load_explicit(&trace_ring_idx, memory_order_relaxed);
+    unsigned int count = MIN(idx, (unsigned int)TRACE_RING_SIZE);
+    unsigned int start = (idx - count) % TRACE_RING_SIZE;
+    unsigned int chunk = MIN(count, TRACE_RING_SIZE - start);
+    struct trace_ring_header hdr = {
+        .magic       = TRACE_RING_MAGIC,
+        .version     = TRACE_RING_VERSION,
+        .entry_size  = sizeof(struct trace_ring_entry),
+        .entry_count = count,
+        .fmt_size    = __stop_trace_ring_fmt - __start_trace_ring_fmt,
+        .init_sec    = init_sec,
+    };
+
+    if (trace_ring_write(fd, &hdr, sizeof(hdr)) ||
+        trace_ring_write(fd, __start_trace_ring_fmt, hdr.fmt_size) ||
+        trace_ring_write(fd, trace_ring + start, chunk * sizeof(struct trace_ring_entry)) ||
+        trace_ring_write(fd, trace_ring, (count - chunk) * sizeof(struct trace_ring_entry)))
+        return -1;
+    return 0;
+}
+
 const char *tr_bytes(const void *in, int len, const void **in_done, int max_out, int opt)
 {
     char *out = trace_buffer + trace_idx;
@@ -56,6 +56,16 @@
  * conditional. The user have to set g_enabled_traces to make some traces
  * appear.
  *
+ * The legacy tr_debug() family is filtered by g_log_level. The check is done
+ * before the arguments are evaluated, so a disabled trace costs a comparison.
+ *
+ * Use TRACE_RING() for frequent events worth keeping for post-mortem analysis.
+ * The event is always stored in a binary ring (timestamp, category and up to
+ * 4 integer arguments) and printed like TRACE() if the category is enabled.
+ * The message only accepts integer conversions. TRACE_RECORD() only stores
+ * the event. The ring is saved with trace_ring_dump() and rendered by
+ * wsbrd-trace-decode.
+ *
  * BUG_ON(), FATAL_ON(), ERROR_ON() and WARN_ON(), allow to keep error handling
  * small enough. However, as soon as you add a description of the error, the
  * code will be probably clearer if you use the unconditional versions of these
@@ -70,8 +80,16 @@
 extern FILE *g_trace_stream;
 extern unsigned int g_enabled_traces;
 extern bool g_enable_color_traces;
+extern int g_log_level;
 extern uintmax_t init_sec; 
 
+enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+};
+
 enum {
     TR_RF        = 0x0001,
     TR_CHAN      = 0x0002,
@@ -92,6 +110,8 @@ enum {
 };
 #define CLOCK_MONOTONIC		1
 #define TRACE(COND, ...)          __TRACE(COND, "" __VA_ARGS__)
+#define TRACE_RING(COND, MSG, ...)   __TRACE_RING(COND, true, MSG, ##__VA_ARGS__)
+#define TRACE_RECORD(COND, MSG, ...) __TRACE_RING(COND, false, MSG, ##__VA_ARGS__)
 #define DEBUG(...)                __DEBUG("" __VA_ARGS__)
 #define WARN(...)                 __WARN("" __VA_ARGS__)
 #define WARN_ON(COND, ...)        __WARN_ON(COND, "" __VA_ARGS__)
@@ -148,6 +168,54 @@ __attribute__ ((format(printf, 2, 3)))
 void __tr_printf(const char *color, const char *fmt, ...);
 __attribute__ ((format(printf, 2, 0)))
 void __tr_vprintf(const char *color, const char *fmt, va_list ap);
+void __tr_flush();
+
+/*
+ * Once started, traces emitted by the calling thread are copied into a ring
+ * buffer of size bytes and written by a background thread, so a slow
+ * g_trace_stream never blocks the caller. Lines that do not fit in the ring
+ * are dropped and counted. Traces from other threads are still written
+ * directly. log_async_stop() drains the ring and is registered with atexit().
+ */
+void log_async_start(size_t size);
+void log_async_stop();
+
+#define TRACE_RING_SIZE    4096 // Power of 2
+#define TRACE_RING_ARGS    4
+#define TRACE_RING_MAGIC   "WSTR"
+#define TRACE_RING_VERSION 1
+#define TRACE_RING_SECTION "trace_ring_fmt"
+
+/*
+ * Layout of a dump: the header, then the content of the TRACE_RING_SECTION
+ * section (the messages of every TRACE_RING() call site, referenced by offset)
+ * and the entries from the oldest to the newest. Fields use the byte order of
+ * the host.
+ */
+struct trace_ring_header {
+    char     magic[4];
+    uint16_t version;
+    uint16_t entry_size;
+    uint32_t entry_count;
+    uint32_t fmt_size;
+    uint64_t init_sec;
+};
+
+struct trace_ring_entry {
+    uint32_t time_s;   // Relative to init_sec
+    uint32_t time_ns;
+    uint32_t fmt;      // Offset in TRACE_RING_SECTION
+    uint16_t category; // TR_* flags
+    uint8_t  argc;
+    uint8_t  reserved;
+    uint64_t args[TRACE_RING_ARGS];
+};
+
+void __trace_ring(unsigned int category, bool print, const char *fmt, const uint64_t *args, int argc);
+// Async-signal-safe
+int trace_ring_dump(int fd);
+// Render fmt with integer arguments, as done by TRACE_RING()
+int trace_ring_format(char *out, size_t size, const char *fmt, const uint64_t *args, int argc);
 
 #define __TRACE(COND, MSG, ...) \
     do {                                                             \
@@ -159,6 +227,18 @@ void __tr_vprintf(const char *color, const char *fmt, va_list ap);
         }                                                            \
     } while (0)
 
+#define __TRACE_RING(COND, PRINT, MSG, ...) \
+    do {                                                             \
+        static const char __fmt[]                                    \
+            __attribute__((section(TRACE_RING_SECTION), used)) = MSG; \
+        const uint64_t __args[] = { __VA_ARGS__ };                   \
+                                                                     \
+        _Static_assert(sizeof(__args) <= TRACE_RING_ARGS * sizeof(uint64_t), \
+                       "too many arguments");                        \
+        __trace_ring(COND, PRINT, __fmt, __args,                     \
+                     sizeof(__args) / sizeof(uint64_t));             \
+    } while (0)
+
 #define __DEBUG(MSG, ...) \
     do {                                                             \
         if (MSG[0] != '\0')                                          \
@@ -250,6 +330,7 @@ void __tr_vprintf(const char *color, const char *fmt, va_list ap);
                 __PRINT_WITH_LINE(91, "bug: " MSG, ##__VA_ARGS__);   \
             else                                                     \
                 __PRINT_WITH_LINE(91, "bug: \"%s\"", #COND);         \
+            __tr_flush();                                            \
             backtrace_show();                                        \
             raise(SIGTRAP);                                          \
             __builtin_unreachable();                                 \
@@ -272,6 +353,12 @@ void __tr_vprintf(const char *color, const char *fmt, va_list ap);
                 ##__VA_ARGS__);                                      \
     } while (0)
 
+#define __PRINT_WITH_LEVEL(LEVEL, COLOR, MSG, ...) \
+    do {                                                             \
+        if ((LEVEL) >= g_log_level)                                  \
+            __PRINT_WITH_TIME(COLOR, MSG, ##__VA_ARGS__);            \
+    } while (0)
+
 #define __PRINT_WITH_LINE(COLOR, MSG, ...) \
     __PRINT(COLOR, "%s():%d: " MSG, __func__, __LINE__, ##__VA_ARGS__)
 
@@ -23,6 +23,9 @@
 
 #define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
 
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_EPB_FLAGS 2
+
 void pcapng_write_shb(struct iobuf_write *buf, const struct pcapng_shb *shb)
 {
     const uint32_t len = PCAPNG_SHB_SIZE_MIN;
@@ -53,7 +56,8 @@ void pcapng_write_idb(struct iobuf_write *buf, const struct pcapng_idb *idb)
 void pcapng_write_epb(struct iobuf_write *buf, const struct pcapng_epb *epb)
 {
     const uint8_t pkt_len_pad = (4 - (epb->pkt_len & 0b11)) & 0b11; // pad to 32 bits
-    const uint32_t len = PCAPNG_EPB_SIZE_MIN + epb->pkt_len + pkt_len_pad;
+    const uint32_t len = PCAPNG_EPB_SIZE_MIN + epb->pkt_len + pkt_len_pad +
+                         (epb->flags ? PCAPNG_EPB_FLAGS_SIZE : 0);
 
     iobuf_push_le32(buf, PCAPNG_BLOCK_TYPE_EPB);
     iobuf_push_le32(buf, len);
@@ -65,6 +69,13 @@ void pcapng_write_epb(struct iobuf_write *buf, const struct pcapng_epb *epb)
     iobuf_push_data(buf, epb->pkt, epb->pkt_len);
     for (int i = 0; i < pkt_len_pad; i++)
         iobuf_push_u8(buf, 0); // pad to 32 bits
-    // options not supported
+    if (epb->flags) {
+        iobuf_push_le16(buf, PCAPNG_OPT_EPB_FLAGS);
+        iobuf_push_le16(buf, 4);
+        iobuf_push_le32(buf, epb->flags);
+        iobuf_push_le16(buf, PCAPNG_OPT_ENDOFOPT);
+        iobuf_push_le16(buf, 0);
+    }
+    // other options not supported
     iobuf_push_le32(buf, len);
 }
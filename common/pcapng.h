@@ -56,6 +56,17 @@
     0 + /* Options                */ \
     4   /* Block Total Length     */ \
 )
+#define PCAPNG_EPB_FLAGS_SIZE (      \
+    2 + /* epb_flags Code         */ \
+    2 + /* epb_flags Length       */ \
+    4 + /* epb_flags Value        */ \
+    2 + /* opt_endofopt Code      */ \
+    2   /* opt_endofopt Length    */ \
+)
+
+// Direction bits of the epb_flags option
+#define PCAPNG_EPB_FLAGS_INBOUND  0x00000001
+#define PCAPNG_EPB_FLAGS_OUTBOUND 0x00000002
 
 struct iobuf_write;
 
@@ -78,7 +89,8 @@ struct pcapng_epb {
     uint32_t pkt_len;
     uint32_t pkt_len_og;
     const uint8_t *pkt;
-    // options not supported
+    uint32_t flags; // epb_flags option, omitted if 0
+    // other options not supported
 };
 
 void pcapng_write_shb(struct iobuf_write *buf, const struct pcapng_shb *shb);
@@ -423,14 +423,12 @@ bool spinel_prop_is_valid(struct iobuf_read *buf, int prop)
     return true;
 }
 
-static void spinel_trace(struct iobuf_read *buf, const char *prefix)
+static void spinel_trace(struct iobuf_read *buf, bool tx)
 {
+    const char *prefix = tx ? "hif tx: " : "hif rx: ";
     unsigned int cmd, prop = -1;
     const char *cmd_str, *prop_str;
 
-    if (!(g_enabled_traces & TR_HIF))
-        return;
-
     iobuf_pop_u8(buf); // ignore header
     cmd = __spinel_pop_uint(buf);
     switch (cmd) {
@@ -440,6 +438,14 @@ static void spinel_trace(struct iobuf_read *buf, const char *prefix)
             prop = __spinel_pop_uint(buf);
             break;
     }
+    // The text trace below is more verbose, only keep the binary record
+    if (tx)
+        TRACE_RECORD(TR_HIF, "hif tx: cmd=0x%02x prop=0x%04x (%d bytes)", cmd, prop, buf->data_size);
+    else
+        TRACE_RECORD(TR_HIF, "hif rx: cmd=0x%02x prop=0x%04x (%d bytes)", cmd, prop, buf->data_size);
+
+    if (!(g_enabled_traces & TR_HIF))
+        return;
     cmd_str = spinel_cmd_str(cmd);
     prop_str = spinel_prop_str(prop);
     TRACE(TR_HIF, "%s%s/%s %s (%d bytes)", prefix, cmd_str, prop_str,
@@ -455,7 +461,7 @@ void spinel_trace_tx(struct iobuf_write *buf)
         .data = buf->data,
     };
 
-    spinel_trace(&tr_buf, "hif tx: ");
+    spinel_trace(&tr_buf, true);
 }
 
 void spinel_trace_rx(struct iobuf_read *buf)
@@ -465,5 +471,5 @@ void spinel_trace_rx(struct iobuf_read *buf)
         .data = buf->data,
     };
 
-    spinel_trace(&tr_buf, "hif rx: ");
+    spinel_trace(&tr_buf, false);
 }
@@ -442,7 +442,7 @@ int8_t protocol_6lowpan_neighbor_address_state_synch(struct net_if *cur, const u
     if (memcmp(iid, ADDR_SHORT_ADR_SUFFIC, 6) == 0) {
         iid += 6;
         //Set Short Address to MLE
-        entry->mac16 = read_be16(iid);
+        mac_neighbor_table_mac16_set(cur->mac_parameters.mac_neighbor_table, entry, read_be16(iid));
     }
     return 0;
 }
@@ -22,12 +22,52 @@
 #include "common/log_legacy.h"
 #include "common/ns_list.h"
 
+#include "service_libs/fnv_hash/fnv_hash.h"
 #include "nwk_interface/protocol.h"
 #include "common_protocols/ipv6_constants.h"
 #include "6lowpan/iphc_decode/cipv6.h"
 
 #define TRACE_GROUP "iphc"
 
+#define IPHC_FLOW_CACHE_SIZE 16
+#define IPHC_FLOW_HC_MAX     64
+
+/*
+ * Compressed headers of IPv6 packets directly carrying UDP. The compressed
+ * form only depends on the fields in the key, the hop limit when it is
+ * carried inline and the UDP checksum are patched on every hit. Context based
+ * compression is not implemented in compress_addr(), if it ever is the
+ * context list must become part of the key.
+ */
+struct iphc_flow_key {
+    uint8_t ip_hdr[4];      // Version, traffic class and flow label
+    uint8_t hop_limit;      // 255, 64 or 1 when compressed, 0 when inline
+    bool stable_only;
+    uint8_t src[16];
+    uint8_t dst[16];
+    uint8_t outer_src_iid[8];
+    uint8_t outer_dst_iid[8];
+    uint8_t ports[4];
+};
+
+struct iphc_flow {
+    struct iphc_flow_key key;
+    bool valid;
+    uint8_t hc_len;
+    uint8_t hop_limit_offset; // 0 when the hop limit is compressed
+    uint8_t hc[IPHC_FLOW_HC_MAX];
+};
+
+static struct iphc_flow iphc_flow_cache[IPHC_FLOW_CACHE_SIZE];
+static uint32_t iphc_flow_cache_hits;
+static uint32_t iphc_flow_cache_misses;
+
+void iphc_flow_cache_stats(uint32_t *hits, uint32_t *misses)
+{
+    *hits = iphc_flow_cache_hits;
+    *misses = iphc_flow_cache_misses;
+}
+
 typedef struct iphc_compress_state {
     const lowpan_context_list_t *const context_list;
     const uint8_t *in;
@@ -500,6 +540,55 @@ ext_hdr:
 }
 
 
+static bool iphc_flow_key_get(struct iphc_flow_key *key, const uint8_t *ptr, uint16_t len,
+                              const uint8_t src_iid[8], const uint8_t dst_iid[8], bool stable_only)
+{
+    /* Same conditions as compress_ipv6() and compress_udp() for UDP NHC */
+    if (len < 48 || ptr[6] != IPV6_NH_UDP ||
+        read_be16(ptr + 4) != len - 40 || read_be16(ptr + 44) != len - 40)
+        return false;
+    memset(key, 0, sizeof(*key));
+    memcpy(key->ip_hdr, ptr, 4);
+    if (ptr[7] == 255 || ptr[7] == 64 || ptr[7] == 1)
+        key->hop_limit = ptr[7];
+    key->stable_only = stable_only;
+    memcpy(key->src, ptr + 8, 16);
+    memcpy(key->dst, ptr + 24, 16);
+    memcpy(key->outer_src_iid, src_iid, 8);
+    memcpy(key->outer_dst_iid, dst_iid, 8);
+    memcpy(key->ports, ptr + 40, 4);
+    return true;
+}
+
+static struct iphc_flow *iphc_flow_slot(const struct iphc_flow_key *key)
+{
+    return &iphc_flow_cache[fnv_hash_1a_32_reverse_block((const uint8_t *)key, sizeof(*key)) % IPHC_FLOW_CACHE_SIZE];
+}
+
+static void iphc_flow_store(struct iphc_flow *flow, const struct iphc_flow_key *key, const uint8_t *hc, uint16_t hc_len)
+{
+    static const uint8_t tf_len[] = {
+        [HC_TF_ECN_DSCP_FLOW_LABEL >> 3] = 4,
+        [HC_TF_ECN_FLOW_LABEL >> 3]      = 3,
+        [HC_TF_ECN_DSCP >> 3]            = 1,
+        [HC_TF_ELIDED >> 3]              = 0,
+    };
+    uint8_t offset;
+
+    /* Only plain IPHC followed by UDP NHC, which ends with the checksum */
+    if (hc_len > IPHC_FLOW_HC_MAX || !(hc[0] & HC_NEXT_HEADER_MASK))
+        return;
+    offset = 2;
+    if (hc[1] & HC_CIDE_COMP)
+        offset++;
+    offset += tf_len[(hc[0] & HC_TF_MASK) >> 3];
+    flow->key = *key;
+    flow->valid = true;
+    flow->hc_len = hc_len;
+    flow->hop_limit_offset = key->hop_limit ? 0 : offset;
+    memcpy(flow->hc, hc, hc_len);
+}
+
 /* Input: An IPv6 frame, with outer layer 802.15.4 MAC (or IP) addresses in src+dst */
 /* Output: 6LoWPAN frame - usually compressed. */
 buffer_t *iphc_compress(const lowpan_context_list_t *context_list, buffer_t *buf, uint16_t hc_space, bool stable_only)
@@ -518,6 +607,33 @@ buffer_t *iphc_compress(const lowpan_context_list_t *context_list, buffer_t *buf
         hc_space = len;
     }
 
+    if (!addr_iid_from_outer(src_iid, &buf->src_sa) || !addr_iid_from_outer(dst_iid, &buf->dst_sa)) {
+        tr_debug("Bad outer addr");
+        return buffer_free(buf);
+    }
+
+    struct iphc_flow_key flow_key;
+    struct iphc_flow *flow = NULL;
+
+    if (iphc_flow_key_get(&flow_key, ptr, len, src_iid, dst_iid, stable_only)) {
+        flow = iphc_flow_slot(&flow_key);
+        if (flow->valid && flow->hc_len <= hc_space &&
+            !memcmp(&flow->key, &flow_key, sizeof(flow_key))) {
+            uint8_t hop_limit = ptr[7];
+            uint16_t checksum = read_be16(ptr + 46);
+
+            iphc_flow_cache_hits++;
+            buffer_data_strip_header(buf, 48);
+            ptr = buffer_data_reserve_header(buf, flow->hc_len);
+            memcpy(ptr, flow->hc, flow->hc_len);
+            if (flow->hop_limit_offset)
+                ptr[flow->hop_limit_offset] = hop_limit;
+            write_be16(ptr + flow->hc_len - 2, checksum);
+            return buf;
+        }
+        iphc_flow_cache_misses++;
+    }
+
     /* TODO: Could actually do it in-place with more care, working backwards
      * in each header.
      */
@@ -527,12 +643,6 @@ buffer_t *iphc_compress(const lowpan_context_list_t *context_list, buffer_t *buf
         return buffer_free(buf);
     }
 
-    if (!addr_iid_from_outer(src_iid, &buf->src_sa) || !addr_iid_from_outer(dst_iid, &buf->dst_sa)) {
-        tr_debug("Bad outer addr");
-        free(hc_out);
-        return buffer_free(buf);
-    }
-
     iphc_compress_state_t cs = {
         .context_list = context_list,
         .in = ptr,
@@ -558,6 +668,9 @@ buffer_t *iphc_compress(const lowpan_context_list_t *context_list, buffer_t *buf
         return buf;
     }
 
+    if (flow && cs.consumed == 48)
+        iphc_flow_store(flow, &flow_key, hc_out, cs.produced);
+
     buffer_data_strip_header(buf, cs.consumed);
     buffer_data_reserve_header(buf, cs.produced);
     /* XXX see note above - should be able to improve this to avoid the temp buffer */
@@ -25,5 +25,7 @@
 typedef struct buffer buffer_t;
 
 buffer_t *iphc_compress(const lowpan_context_list_t *context_list, buffer_t *buf, uint16_t hc_space, bool stable_only);
+// Compressions of cacheable flows served from the flow cache, and not found in it
+void iphc_flow_cache_stats(uint32_t *hits, uint32_t *misses);
 
 #endif
@@ -78,6 +78,7 @@ static uint8_t current_dodag_id[16] = {0};
 static uint8_t current_local_prefix[8] = {0};
 static uint8_t current_global_prefix[16] = {0}; // DHCP requires 16 bytes prefix
 static uint32_t bbr_delay_timer = 0; // initial delay.
+static ws_bbr_nodes_changed_cb *nodes_changed_cb = NULL;
 static uint32_t global_prefix_unavailable_timer = 0; // initial delay.
 
 static rpl_dodag_conf_t rpl_conf = {
@@ -913,6 +914,11 @@ int ws_bbr_eapol_node_limit_set(int8_t interface_id, uint16_t limit)
     return ws_pae_controller_node_limit_set(interface_id, limit);
 }
 
+int ws_bbr_eapol_auth_limit_set(int8_t interface_id, uint16_t full_auth_max, uint16_t key_auth_max)
+{
+    return ws_pae_controller_auth_limit_set(interface_id, full_auth_max, key_auth_max);
+}
+
 int ws_bbr_ext_certificate_validation_set(int8_t interface_id, uint8_t validation)
 {
     bool enabled = false;
@@ -1098,6 +1104,11 @@ int ws_bbr_radius_timing_validate(int8_t interface_id, bbr_radius_timing_t *timi
     return ws_pae_controller_radius_timing_validate(interface_id, timing);
 }
 
+int ws_bbr_radius_window_set(int8_t interface_id, uint8_t window)
+{
+    return ws_pae_controller_radius_window_set(interface_id, window);
+}
+
 int ws_bbr_set_mode_switch(int8_t interface_id, int mode, uint8_t phy_mode_id, uint8_t *neighbor_mac_address)
 {
     struct net_if *interface = protocol_stack_interface_info_get_by_id(interface_id);
@@ -1111,3 +1122,14 @@ int ws_bbr_set_mode_switch(int8_t interface_id, int mode, uint8_t phy_mode_id, u
     return ws_llc_set_mode_switch(interface, mode, phy_mode_id, all_nodes);
 
 }
+
+void ws_bbr_nodes_changed_cb_set(ws_bbr_nodes_changed_cb *cb)
+{
+    nodes_changed_cb = cb;
+}
+
+void ws_bbr_nodes_changed(void)
+{
+    if (nodes_changed_cb)
+        nodes_changed_cb();
+}
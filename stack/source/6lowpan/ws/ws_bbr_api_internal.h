@@ -49,6 +49,8 @@ uint16_t ws_bbr_bsi_generate(struct net_if *interface);
 uint16_t ws_bbr_pan_id_get(struct net_if *interface);
 void ws_bbr_init(struct net_if *interface);
 
+void ws_bbr_nodes_changed(void);
+
 #else
 
 #define ws_bbr_seconds_timer( cur, seconds)
@@ -62,6 +64,7 @@ void ws_bbr_init(struct net_if *interface);
 #define ws_bbr_bsi_generate(interface) 0
 #define ws_bbr_pan_id_get(interface) 0
 #define ws_bbr_init(interface) (void) 0
+#define ws_bbr_nodes_changed() (void) 0
 
 #endif //HAVE_WS_BORDER_ROUTER
 
@@ -116,10 +116,10 @@ static mac_neighbor_table_entry_t *ws_bootstrap_mac_neighbor_allocate(struct net
     if (!neighbor)
         return NULL;
     neighbor->node_role = role;
-    neighbor->lifetime = ws_cfg_neighbour_temporary_lifetime_get(role);
     neighbor->link_lifetime = ws_cfg_neighbour_temporary_lifetime_get(role);
+    mac_neighbor_table_lifetime_set(interface->mac_parameters.mac_neighbor_table, neighbor, neighbor->link_lifetime);
     rcp_set_neighbor(neighbor->index, mac_helper_panid_get(interface), neighbor->mac16, neighbor->mac64, 0);
-    tr_debug("neighbor[%d] = %s, lifetime=%d (new)", neighbor->index, tr_eui64(neighbor->mac64), neighbor->lifetime);
+    tr_debug("neighbor[%d] = %s, lifetime=%d (new)", neighbor->index, tr_eui64(neighbor->mac64), neighbor->link_lifetime);
     return neighbor;
 }
 
@@ -138,9 +138,9 @@ void ws_bootstrap_neighbor_set_stable(struct net_if *interface, const uint8_t *s
     mac_neighbor_table_entry_t *neighbor = mac_neighbor_table_address_discover(interface->mac_parameters.mac_neighbor_table, src64, MAC_ADDR_MODE_64_BIT);
 
     if (neighbor && neighbor->link_lifetime != WS_NEIGHBOR_LINK_TIMEOUT) {
-        neighbor->lifetime = WS_NEIGHBOR_LINK_TIMEOUT;
         neighbor->link_lifetime = WS_NEIGHBOR_LINK_TIMEOUT;
-        tr_debug("neighbor[%d] = %s, lifetime=%d", neighbor->index, tr_eui64(neighbor->mac64), neighbor->lifetime);
+        mac_neighbor_table_lifetime_set(interface->mac_parameters.mac_neighbor_table, neighbor, WS_NEIGHBOR_LINK_TIMEOUT);
+        tr_debug("neighbor[%d] = %s, lifetime=%d", neighbor->index, tr_eui64(neighbor->mac64), neighbor->link_lifetime);
     }
 }
 
@@ -150,9 +150,9 @@ void ws_bootstrap_mac_neighbor_short_time_set(struct net_if *interface, const ui
 
     if (neighbor && neighbor->link_lifetime <= valid_time) {
         //mlme_device_descriptor_t device_desc;
-        neighbor->lifetime = valid_time;
         neighbor->link_lifetime = valid_time;
-        tr_debug("neighbor[%d] = %s, lifetime=%d", neighbor->index, tr_eui64(neighbor->mac64), neighbor->lifetime);
+        mac_neighbor_table_lifetime_set(interface->mac_parameters.mac_neighbor_table, neighbor, valid_time);
+        tr_debug("neighbor[%d] = %s, lifetime=%d", neighbor->index, tr_eui64(neighbor->mac64), neighbor->link_lifetime);
     }
 }
 
@@ -659,7 +659,7 @@ uint16_t ws_local_etx_read(struct net_if *interface, addrtype_e addr_type, const
         return 0;
     }
 
-    uint8_t attribute_index;
+    uint16_t attribute_index;
 
     mac_neighbor_table_entry_t *mac_neighbor = mac_neighbor_table_address_discover(interface->mac_parameters.mac_neighbor_table, mac_adddress, addr_type);
     if (!mac_neighbor) {
@@ -890,7 +890,9 @@ static void ws_bootstrap_neighbor_table_clean(struct net_if *interface)
             continue;
         }
 
-        if (neighbor_entry_ptr && neighbor_entry_ptr->lifetime < cur->lifetime) {
+        if (neighbor_entry_ptr &&
+            mac_neighbor_table_lifetime_get(interface->mac_parameters.mac_neighbor_table, neighbor_entry_ptr) <
+            mac_neighbor_table_lifetime_get(interface->mac_parameters.mac_neighbor_table, cur)) {
             // We have already shorter link entry found this cannot replace it
             continue;
         }
@@ -1008,13 +1010,13 @@ static uint32_t ws_probe_init_time_get(struct net_if *cur)
 
 static bool ws_neighbor_entry_nud_notify(mac_neighbor_table_entry_t *entry_ptr, void *user_data)
 {
-    uint32_t time_from_start = entry_ptr->link_lifetime - entry_ptr->lifetime;
+    struct net_if *cur = user_data;
+    uint32_t time_from_start = entry_ptr->link_lifetime - mac_neighbor_table_lifetime_get(cur->mac_parameters.mac_neighbor_table, entry_ptr);
     uint8_t ll_address[16];
     bool nud_proces = false;
     bool activate_nud = false;
     bool child;
     bool candidate_parent;
-    struct net_if *cur = user_data;
 
     ws_neighbor_class_entry_t *ws_neighbor = ws_neighbor_class_entry_get(&cur->ws_info.neighbor_storage, entry_ptr->index);
     etx_storage_t *etx_entry = etx_storage_entry_get(cur->id, entry_ptr->index);
@@ -1179,6 +1181,10 @@ int ws_bootstrap_init(int8_t interface_id, net_6lowpan_mode_e bootstrap_mode)
         ret_val = -1;
         goto init_fail;
     }
+    // The border router has no RPL parent candidates to probe so
+    // ws_neighbor_entry_nud_notify() is a no-op before WS_NEIGHBOR_NUD_TIMEOUT.
+    if (cur->bootstrap_mode == ARM_NWK_BOOTSTRAP_MODE_6LoWPAN_BORDER_ROUTER)
+        cur->mac_parameters.mac_neighbor_table->nud_threshold = WS_NEIGHBOR_NUD_TIMEOUT;
 
     if (cur->bootstrap_mode == ARM_NWK_BOOTSTRAP_MODE_6LoWPAN_HOST) {
         // Configure for LFN device
@@ -2427,12 +2433,13 @@ int ws_bootstrap_stack_info_get(struct net_if *cur, struct ws_stack_info *info_p
 }
 int ws_bootstrap_neighbor_info_get(struct net_if *cur, ws_neighbour_info_t *neighbor_ptr, uint16_t table_max)
 {
-    uint8_t count = 0;
+    uint16_t count = 0;
     if (!neighbor_ptr) {
         // Return the aount of neighbors.
         for (int n = 0; n < cur->mac_parameters.mac_neighbor_table->list_total_size; n++) {
             mac_neighbor_table_entry_t *mac_entry = mac_neighbor_table_attribute_discover(cur->mac_parameters.mac_neighbor_table, n);
-            if (mac_entry && mac_entry->lifetime && mac_entry->lifetime != 0xffffffff) {
+            uint32_t lifetime = mac_entry ? mac_neighbor_table_lifetime_get(cur->mac_parameters.mac_neighbor_table, mac_entry) : 0;
+            if (lifetime && lifetime != 0xffffffff) {
                 count++;
             }
         }
@@ -2450,11 +2457,12 @@ int ws_bootstrap_neighbor_info_get(struct net_if *cur, ws_neighbour_info_t *neig
 
         mac_neighbor_table_entry_t *mac_entry = mac_neighbor_table_attribute_discover(cur->mac_parameters.mac_neighbor_table, n);
         ws_neighbor_class_entry_t *ws_neighbor =  ws_neighbor_class_entry_get(&cur->ws_info.neighbor_storage, n);
-        if (mac_entry && ws_neighbor && mac_entry->lifetime && mac_entry->lifetime != 0xffffffff) {
+        uint32_t lifetime = mac_entry ? mac_neighbor_table_lifetime_get(cur->mac_parameters.mac_neighbor_table, mac_entry) : 0;
+        if (ws_neighbor && lifetime && lifetime != 0xffffffff) {
             // Active neighbor entry
             uint8_t ll_address[16];
             memset(neighbor_ptr + count, 0, sizeof(ws_neighbour_info_t));
-            neighbor_ptr[count].lifetime = mac_entry->lifetime;
+            neighbor_ptr[count].lifetime = lifetime;
 
             neighbor_ptr[count].rsl_in = ws_neighbor_class_rsl_in_get(ws_neighbor);
             neighbor_ptr[count].rsl_out = ws_neighbor_class_rsl_out_get(ws_neighbor);
@@ -256,7 +256,7 @@ void ws_common_neighbor_remove(struct net_if *cur, const uint8_t *ll_address)
     ws_bootstrap_neighbor_remove(cur, ll_address);
 }
 
-uint8_t ws_common_temporary_entry_size(uint8_t mac_table_size)
+uint8_t ws_common_temporary_entry_size(uint16_t mac_table_size)
 {
     if (mac_table_size >= 128) {
         return (WS_LARGE_TEMPORARY_NEIGHBOUR_ENTRIES);
@@ -289,14 +289,14 @@ static void ws_common_neighbour_address_reg_link_update(struct net_if *interface
 
         }
         //Refresh
-        mac_neighbor->lifetime = mac_neighbor->link_lifetime;
+        mac_neighbor_table_lifetime_set(interface->mac_parameters.mac_neighbor_table, mac_neighbor, mac_neighbor->link_lifetime);
     }
 }
 
 uint8_t ws_common_allow_child_registration(struct net_if *interface, const uint8_t *eui64, uint16_t aro_timeout)
 {
-    uint8_t child_count = 0;
-    uint8_t max_child_count = interface->mac_parameters.mac_neighbor_table->list_total_size - ws_common_temporary_entry_size(interface->mac_parameters.mac_neighbor_table->list_total_size);
+    uint16_t child_count = 0;
+    uint16_t max_child_count = interface->mac_parameters.mac_neighbor_table->list_total_size - ws_common_temporary_entry_size(interface->mac_parameters.mac_neighbor_table->list_total_size);
 
     if (aro_timeout == 0) {
         //DeRegister Address Reg
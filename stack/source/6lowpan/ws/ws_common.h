@@ -165,7 +165,7 @@ void ws_common_primary_parent_update(struct net_if *interface, mac_neighbor_tabl
 
 void ws_common_secondary_parent_update(struct net_if *interface);
 
-uint8_t ws_common_temporary_entry_size(uint8_t mac_table_size);
+uint8_t ws_common_temporary_entry_size(uint16_t mac_table_size);
 
 void ws_common_border_router_alive_update(struct net_if *interface);
 
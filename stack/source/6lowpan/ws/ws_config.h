@@ -203,8 +203,10 @@ extern uint8_t DEVICE_MIN_SENS;
 #define FRAME_COUNTER_STORE_INTERVAL        60          // Time interval (on seconds) between checking if frame counter storing is needed
 #define FRAME_COUNTER_STORE_FORCE_INTERVAL  (3600 * 20) // Time interval (on seconds) before frame counter storing is forced (if no other storing operations triggered)
 #define FRAME_COUNTER_STORE_TRIGGER         5           // Delay (on seconds) before storing, when storing of frame counters is triggered
-#define FRAME_COUNTER_INCREMENT             1000000     // How much frame counter is incremented on start up
-#define FRAME_COUNTER_STORE_THRESHOLD       994999      // How much frame counter must increment before it is stored
+#define FRAME_COUNTER_INCREMENT             1000000     // How much frame counter is incremented on start up (if no store threshold was stored)
+#define FRAME_COUNTER_STORE_PERIOD          600         // Time (on seconds) of traffic between two frame counter stores, used to adapt the store threshold
+#define FRAME_COUNTER_STORE_THRESHOLD_MIN   50000       // Minimum frame counter increment before it is stored
+#define FRAME_COUNTER_STORE_THRESHOLD_MAX   (FRAME_COUNTER_INCREMENT / 2) // Maximum frame counter increment before it is stored
 
 
 /*
@@ -328,6 +330,8 @@ extern uint8_t DEVICE_MIN_SENS;
 #define RADIUS_CLIENT_RETRY_IMIN           20       // First retry minimum 1 seconds
 #define RADIUS_CLIENT_RETRY_IMAX           30       // First retry maximum 3 seconds
 #define RADIUS_CLIENT_TIMER_EXPIRATIONS    3        // Number of retries is three
+#define RADIUS_CLIENT_RTO_MAX              160      // Retry timeout maximum 16 seconds
+#define RADIUS_CLIENT_WINDOW               32       // Access-Requests waiting for a response
 
 /*
  *  EAP-TLS fragment length
@@ -65,6 +65,48 @@
 #define WS_WPIE_JM_METRIC_ID_MASK  0b11111100
 #define WS_WPIE_JM_METRIC_LEN_MASK 0b00000011
 
+// Indexes of the frame being processed, see ws_ie_index_frame()
+static struct {
+    struct ieee802154_ie_index wh;
+    struct ieee802154_ie_index wp;
+} ws_ie_frame;
+
+void ws_ie_index_frame(const uint8_t *header_ies, uint16_t header_ies_len,
+                       const uint8_t *payload_ies, uint16_t payload_ies_len)
+{
+    struct iobuf_read ie_wp;
+
+    ieee802154_ie_index_header(&ws_ie_frame.wh, header_ies, header_ies_len);
+    ieee802154_ie_find_payload(payload_ies, payload_ies_len, IEEE802154_IE_ID_WP, &ie_wp);
+    if (ie_wp.err)
+        ws_ie_frame.wp.data = NULL;
+    else
+        ieee802154_ie_index_nested(&ws_ie_frame.wp, ie_wp.data, ie_wp.data_size);
+}
+
+void ws_ie_index_frame_clear(void)
+{
+    ws_ie_frame.wh.data = NULL;
+    ws_ie_frame.wp.data = NULL;
+}
+
+static const struct ieee802154_ie_index *ws_ie_index_get(const struct ieee802154_ie_index *index,
+                                                         const uint8_t *data, uint16_t length)
+{
+    if (!data || index->data != data || index->len != length)
+        return NULL;
+    return index;
+}
+
+static int ws_wp_nested_find(const uint8_t *data, uint16_t length, uint8_t id, struct iobuf_read *ie_content, bool is_long)
+{
+    const struct ieee802154_ie_index *index = ws_ie_index_get(&ws_ie_frame.wp, data, length);
+
+    if (index)
+        return ieee802154_ie_index_find_nested(index, id, ie_content, is_long);
+    return ieee802154_ie_find_nested(data, length, id, ie_content, is_long);
+}
+
 static int ws_wh_header_base_write(struct iobuf_write *buf, uint8_t type)
 {
     int offset;
@@ -532,8 +574,18 @@ void ws_wp_nested_jm_plf_write(struct iobuf_write *buf, uint8_t version, uint8_t
 
 static void ws_wh_find_subid(const uint8_t *data, uint16_t length, uint8_t subid, struct iobuf_read *wh_content)
 {
+    const struct ieee802154_ie_index *index = ws_ie_index_get(&ws_ie_frame.wh, data, length);
     const uint8_t *end = data + length;
 
+    if (index) {
+        ieee802154_ie_index_find(index, IEEE802154_IE_ID_WH, wh_content);
+        while (iobuf_pop_u8(wh_content) != subid) {
+            if (wh_content->err)
+                return;
+            ieee802154_ie_index_find_next(index, wh_content);
+        }
+        return;
+    }
     do {
         ieee802154_ie_find_header(data, length, IEEE802154_IE_ID_WH, wh_content);
         if (iobuf_pop_u8(wh_content) == subid)
@@ -546,6 +598,14 @@ static void ws_wh_find_subid(const uint8_t *data, uint16_t length, uint8_t subid
     wh_content->err = true;
 }
 
+bool ws_wh_subid_is_present(const uint8_t *data, uint16_t length, uint8_t subid)
+{
+    struct iobuf_read ie_buf;
+
+    ws_wh_find_subid(data, length, subid, &ie_buf);
+    return !ie_buf.err;
+}
+
 bool ws_wh_utt_read(const uint8_t *data, uint16_t length, struct ws_utt_ie *utt_ie)
 {
     struct iobuf_read ie_buf;
@@ -771,12 +831,20 @@ static void ws_channel_excluded_read(struct iobuf_read *ie_buf, ws_generic_chann
     }
 }
 
+bool ws_wp_nested_is_present(const uint8_t *data, uint16_t length, uint8_t id, bool is_long)
+{
+    struct iobuf_read ie_buf;
+
+    ws_wp_nested_find(data, length, id, &ie_buf, is_long);
+    return !ie_buf.err;
+}
+
 bool ws_wp_nested_us_read(const uint8_t *data, uint16_t length, struct ws_us_ie *us_ie)
 {
     struct iobuf_read ie_buf;
     uint8_t tmp8;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_US, &ie_buf, true);
+    ws_wp_nested_find(data, length, WS_WPIE_US, &ie_buf, true);
     us_ie->dwell_interval  = iobuf_pop_u8(&ie_buf);
     us_ie->clock_drift     = iobuf_pop_u8(&ie_buf);
     us_ie->timing_accuracy = iobuf_pop_u8(&ie_buf);
@@ -795,7 +863,7 @@ bool ws_wp_nested_bs_read(const uint8_t *data, uint16_t length, struct ws_bs_ie
     struct iobuf_read ie_buf;
     uint8_t tmp8;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_BS, &ie_buf, true);
+    ws_wp_nested_find(data, length, WS_WPIE_BS, &ie_buf, true);
     bs_ie->broadcast_interval            = iobuf_pop_le32(&ie_buf);
     bs_ie->broadcast_schedule_identifier = iobuf_pop_le16(&ie_buf);
     bs_ie->dwell_interval                = iobuf_pop_u8(&ie_buf);
@@ -816,7 +884,7 @@ bool ws_wp_nested_pan_read(const uint8_t *data, uint16_t length, struct ws_pan_i
     struct iobuf_read ie_buf;
     uint8_t tmp8;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_PAN, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_PAN, &ie_buf, false);
     pan_configuration->pan_size     = iobuf_pop_le16(&ie_buf);
     pan_configuration->routing_cost = iobuf_pop_le16(&ie_buf);
     tmp8 = iobuf_pop_u8(&ie_buf);
@@ -834,7 +902,7 @@ bool ws_wp_nested_panver_read(const uint8_t *data, uint16_t length, uint16_t *pa
 {
     struct iobuf_read ie_buf;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_PANVER, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_PANVER, &ie_buf, false);
     *pan_version = iobuf_pop_le16(&ie_buf);
     return !ie_buf.err;
 }
@@ -843,7 +911,7 @@ bool ws_wp_nested_gtkhash_read(const uint8_t *data, uint16_t length, gtkhash_t g
 {
     struct iobuf_read ie_buf;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_GTKHASH, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_GTKHASH, &ie_buf, false);
     iobuf_pop_data(&ie_buf, (uint8_t *)gtkhash, 4 * 8);
     return !ie_buf.err;
 }
@@ -852,7 +920,7 @@ bool ws_wp_nested_netname_read(const uint8_t *data, uint16_t length, ws_wp_netna
 {
     struct iobuf_read ie_buf;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_NETNAME, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_NETNAME, &ie_buf, false);
     network_name->network_name_length = iobuf_remaining_size(&ie_buf);
     network_name->network_name = iobuf_ptr(&ie_buf);
     if (network_name->network_name_length > 32)
@@ -865,7 +933,7 @@ bool ws_wp_nested_pom_read(const uint8_t *data, uint16_t length, struct ws_pom_i
     struct iobuf_read ie_buf;
     uint8_t tmp8;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_POM, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_POM, &ie_buf, false);
     tmp8 = iobuf_pop_u8(&ie_buf);
     pom_ie->phy_op_mode_number  = FIELD_GET(WS_WPIE_POM_PHY_OP_MODE_NUMBER_MASK, tmp8);
     pom_ie->mdr_command_capable = FIELD_GET(WS_WPIE_POM_MDR_CAPABLE_MASK,        tmp8);
@@ -880,7 +948,7 @@ bool ws_wp_nested_lfnver_read(const uint8_t *data, uint16_t length, struct ws_lf
 {
     struct iobuf_read ie_buf;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_LFNVER, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_LFNVER, &ie_buf, false);
     ws_lfnver->lfn_version = iobuf_pop_le16(&ie_buf);
     return !ie_buf.err;
 }
@@ -890,7 +958,7 @@ bool ws_wp_nested_lgtkhash_read(const uint8_t *data, uint16_t length, gtkhash_t
     struct iobuf_read ie_buf;
     unsigned valid_hashs;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_LGTKHASH, &ie_buf, false);
+    ws_wp_nested_find(data, length, WS_WPIE_LGTKHASH, &ie_buf, false);
     valid_hashs = FIELD_GET(WS_WPIE_LGTKHASH_INCLUDE_LGTK0_MASK |
                             WS_WPIE_LGTKHASH_INCLUDE_LGTK1_MASK |
                             WS_WPIE_LGTKHASH_INCLUDE_LGTK2_MASK, *data);
@@ -908,7 +976,7 @@ bool ws_wp_nested_lbats_read(const uint8_t *data, uint16_t length, struct ws_lba
 {
     struct iobuf_read ie_buf;
 
-    ieee802154_ie_find_nested(data, length, WS_WPIE_LBATS, &ie_buf, true);
+    ws_wp_nested_find(data, length, WS_WPIE_LBATS, &ie_buf, true);
     lbats_ie->additional_transmissions = iobuf_pop_u8(&ie_buf);
     lbats_ie->next_transmit_delay      = iobuf_pop_le16(&ie_buf);
     return !ie_buf.err;
@@ -917,8 +985,19 @@ bool ws_wp_nested_lbats_read(const uint8_t *data, uint16_t length, struct ws_lba
 // LCP-IE can appear several times with different tag values
 static void ws_wp_nested_lcp_find_tag(const uint8_t *data, uint16_t length, uint8_t tag, struct iobuf_read *ie_content)
 {
+    const struct ieee802154_ie_index *index = ws_ie_index_get(&ws_ie_frame.wp, data, length);
     const uint8_t *end = data + length;
 
+    if (index) {
+        ieee802154_ie_index_find_nested(index, WS_WPIE_LCP, ie_content, true);
+        while (iobuf_pop_u8(ie_content) != tag) {
+            if (ie_content->err)
+                return;
+            ieee802154_ie_index_find_next(index, ie_content);
+        }
+        ie_content->cnt = 0;
+        return;
+    }
     do {
         ieee802154_ie_find_nested(data, length, WS_WPIE_LCP, ie_content, true);
         if (iobuf_pop_u8(ie_content) == tag) {
@@ -87,6 +87,16 @@ typedef struct ws_wp_netname {
     const uint8_t *network_name;
 } ws_wp_netname_t;
 
+/*
+ * Index the header IEs and the WP-IE content of a received frame so the
+ * ws_wh_*_read() and ws_wp_nested_*_read() calls made on these buffers while
+ * processing the frame do not parse them again. Calls with other buffers
+ * still parse linearly. ws_ie_index_frame_clear() must be called before the
+ * frame buffers are released.
+ */
+void ws_ie_index_frame(const uint8_t *header_ies, uint16_t header_ies_len,
+                       const uint8_t *payload_ies, uint16_t payload_ies_len);
+void ws_ie_index_frame_clear(void);
 
 /* WS_WH HEADER IE */
 void   ws_wh_utt_write(struct iobuf_write *buf, uint8_t message_type);
@@ -109,6 +119,7 @@ void ws_wh_panid_write(struct iobuf_write *buf, uint16_t panid);
 void   ws_wh_lbc_write(struct iobuf_write *buf, uint24_t interval, uint8_t sync_period);
 
 
+bool ws_wh_subid_is_present(const uint8_t *data, uint16_t length, uint8_t subid);
 bool ws_wh_utt_read(const uint8_t *data, uint16_t length, struct ws_utt_ie *utt_ie);
 bool ws_wh_bt_read(const uint8_t *data, uint16_t length, struct ws_bt_ie *bt_ie);
 bool ws_wh_fc_read(const uint8_t *data, uint16_t length, struct ws_fc_ie *fc_ie);
@@ -142,6 +153,7 @@ void ws_wp_nested_lgtkhash_write(struct iobuf_write *buf, const gtkhash_t lgtkha
 void      ws_wp_nested_lcp_write(struct iobuf_write *buf, uint8_t tag, struct ws_hopping_schedule *hopping_schedule);
 void   ws_wp_nested_jm_plf_write(struct iobuf_write *buf, uint8_t version, uint8_t pan_load_factor);
 
+bool ws_wp_nested_is_present(const uint8_t *data, uint16_t length, uint8_t id, bool is_long);
 bool ws_wp_nested_us_read(const uint8_t *data, uint16_t length, struct ws_us_ie *us_ie);
 bool ws_wp_nested_bs_read(const uint8_t *data, uint16_t length, struct ws_bs_ie *bs_ie);
 bool ws_wp_nested_pan_read(const uint8_t *data, uint16_t length, struct ws_pan_information *pan_configuration);
@@ -453,14 +453,16 @@ static void ws_llc_data_confirm(struct llc_data_base *base, struct llc_message *
                                            neighbor_llc->neighbor->index, neighbor_llc->neighbor->mac64);
             if (ws_wh_utt_read(confirm_data->headerIeList, confirm_data->headerIeListLength, &ie_utt)) {
                 if (success)
-                    neighbor_llc->neighbor->lifetime = neighbor_llc->neighbor->link_lifetime;
+                    mac_neighbor_table_lifetime_set(base->interface_ptr->mac_parameters.mac_neighbor_table,
+                                                    neighbor_llc->neighbor, neighbor_llc->neighbor->link_lifetime);
                 ////////tr_debug("----update neighbor ut form: ws_llc_data_confirm");
                 ws_neighbor_class_ut_update(neighbor_llc->ws_neighbor, ie_utt.ufsi, confirm->timestamp,
                                             neighbor_llc->neighbor->mac64);
             }
             if (ws_wh_lutt_read(confirm_data->headerIeList, confirm_data->headerIeListLength, &ie_lutt)) {
                 if (success)
-                    neighbor_llc->neighbor->lifetime = neighbor_llc->neighbor->link_lifetime;
+                    mac_neighbor_table_lifetime_set(base->interface_ptr->mac_parameters.mac_neighbor_table,
+                                                    neighbor_llc->neighbor, neighbor_llc->neighbor->link_lifetime);
                 ws_neighbor_class_lut_update(neighbor_llc->ws_neighbor, ie_lutt.slot_number, ie_lutt.interval_offset,
                                              confirm->timestamp, neighbor_llc->neighbor->mac64);
             }
@@ -1018,7 +1020,7 @@ static inline bool ws_is_frame_mngt(uint8_t frame_type)
 }
 
 /** WS LLC MAC data extension indication  */
-void ws_llc_mac_indication_cb(int8_t net_if_id, const mcps_data_ind_t *data, const mcps_data_ie_list_t *ie_ext)
+static void ws_llc_frame_ind(int8_t net_if_id, const mcps_data_ind_t *data, const mcps_data_ie_list_t *ie_ext)
 {
     struct net_if *net_if = protocol_stack_interface_info_get_by_id(net_if_id);
     bool has_utt, has_lutt;
@@ -1061,6 +1063,14 @@ void ws_llc_mac_indication_cb(int8_t net_if_id, const mcps_data_ind_t *data, con
     }
 }
 
+void ws_llc_mac_indication_cb(int8_t net_if_id, const mcps_data_ind_t *data, const mcps_data_ie_list_t *ie_ext)
+{
+    ws_ie_index_frame(ie_ext->headerIeList, ie_ext->headerIeListLength,
+                      ie_ext->payloadIeList, ie_ext->payloadIeListLength);
+    ws_llc_frame_ind(net_if_id, data, ie_ext);
+    ws_ie_index_frame_clear();
+}
+
 static uint16_t ws_mpx_header_size_get(llc_data_base_t *base, uint16_t user_id)
 {
     //TODO add IEEE802154_IE_ID_WP support
@@ -42,7 +42,7 @@
 
 #define TRACE_GROUP "wsne"
 
-bool ws_neighbor_class_alloc(ws_neighbor_class_t *class_data, uint8_t list_size)
+bool ws_neighbor_class_alloc(ws_neighbor_class_t *class_data, uint16_t list_size)
 {
 
     class_data->neigh_info_list = malloc(sizeof(ws_neighbor_class_entry_t) * list_size);
@@ -52,7 +52,7 @@ bool ws_neighbor_class_alloc(ws_neighbor_class_t *class_data, uint8_t list_size)
 
     class_data->list_size = list_size;
     ws_neighbor_class_entry_t *list_ptr = class_data->neigh_info_list;
-    for (uint8_t i = 0; i < list_size; i++) {
+    for (uint16_t i = 0; i < list_size; i++) {
         memset(list_ptr, 0, sizeof(ws_neighbor_class_entry_t));
         list_ptr->rsl_in = RSL_UNITITIALIZED;
         list_ptr->rsl_out = RSL_UNITITIALIZED;
@@ -69,7 +69,7 @@ void ws_neighbor_class_dealloc(ws_neighbor_class_t *class_data)
     class_data->list_size = 0;
 }
 
-ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *class_data, uint8_t attribute_index)
+ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *class_data, uint16_t attribute_index)
 {
     if (!class_data->neigh_info_list || attribute_index >= class_data->list_size) {
         return NULL;
@@ -79,15 +79,15 @@ ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *clas
     return entry;
 }
 
-uint8_t ws_neighbor_class_entry_index_get(ws_neighbor_class_t *class_data, ws_neighbor_class_entry_t *entry)
+uint16_t ws_neighbor_class_entry_index_get(ws_neighbor_class_t *class_data, ws_neighbor_class_entry_t *entry)
 {
     if (!class_data->neigh_info_list) {
-        return 0xff;
+        return 0xffff;
     }
     return entry - class_data->neigh_info_list;
 }
 
-void ws_neighbor_class_entry_remove(ws_neighbor_class_t *class_data, uint8_t attribute_index)
+void ws_neighbor_class_entry_remove(ws_neighbor_class_t *class_data, uint16_t attribute_index)
 {
     ws_neighbor_class_entry_t *entry = ws_neighbor_class_entry_get(class_data, attribute_index);
     if (entry) {
@@ -48,7 +48,7 @@ typedef struct ws_neighbor_class_entry {
  */
 typedef struct ws_neighbor_class {
     ws_neighbor_class_entry_t *neigh_info_list;           /*!< Allocated hopping info array*/
-    uint8_t list_size;                                    /*!< List size*/
+    uint16_t list_size;                                   /*!< List size*/
 } ws_neighbor_class_t;
 
 
@@ -62,7 +62,7 @@ typedef struct ws_neighbor_class {
  * \return false Allocate Fail
  *
  */
-bool ws_neighbor_class_alloc(ws_neighbor_class_t *class_data, uint8_t list_size);
+bool ws_neighbor_class_alloc(ws_neighbor_class_t *class_data, uint16_t list_size);
 
 /**
  * ws_neighbor_class_dealloc a function for free allocated neighbor hopping info
@@ -82,7 +82,7 @@ void ws_neighbor_class_dealloc(ws_neighbor_class_t *class_data);
  * \return Pointer to neighbor hopping info
  *
  */
-ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *class_data, uint8_t attribute_index);
+ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *class_data, uint16_t attribute_index);
 
 /**
  * ws_neighbor_class_entry_t a function for search hopping info for giving neighbor attribute index
@@ -93,7 +93,7 @@ ws_neighbor_class_entry_t *ws_neighbor_class_entry_get(ws_neighbor_class_t *clas
  * \return Attribute index of entry
  *
  */
-uint8_t ws_neighbor_class_entry_index_get(ws_neighbor_class_t *class_data, ws_neighbor_class_entry_t *entry);
+uint16_t ws_neighbor_class_entry_index_get(ws_neighbor_class_t *class_data, ws_neighbor_class_entry_t *entry);
 
 /**
  * ws_neighbor_class_entry_remove a function for clean information should be call when neighbor is removed
@@ -102,7 +102,7 @@ uint8_t ws_neighbor_class_entry_index_get(ws_neighbor_class_t *class_data, ws_ne
  * \param attribute_index define pointer to storage info
  *
  */
-void ws_neighbor_class_entry_remove(ws_neighbor_class_t *class_data, uint8_t attribute_index);
+void ws_neighbor_class_entry_remove(ws_neighbor_class_t *class_data, uint16_t attribute_index);
 
 // Unicast Timing update
 void ws_neighbor_class_ut_update(ws_neighbor_class_entry_t *neighbor, uint24_t ufsi,
@@ -42,6 +42,7 @@
 #include "security/protocols/eap_tls_sec_prot/auth_eap_tls_sec_prot.h"
 #include "security/protocols/eap_tls_sec_prot/radius_eap_tls_sec_prot.h"
 #include "security/protocols/tls_sec_prot/tls_sec_prot.h"
+#include "security/protocols/tls_sec_prot/tls_sec_prot_lib.h"
 #include "security/protocols/fwh_sec_prot/auth_fwh_sec_prot.h"
 #include "security/protocols/gkh_sec_prot/auth_gkh_sec_prot.h"
 #include "security/protocols/radius_sec_prot/radius_client_sec_prot.h"
@@ -56,6 +57,7 @@
 #include "6lowpan/ws/ws_pae_lib.h"
 #include "6lowpan/ws/ws_pae_time.h"
 #include "6lowpan/ws/ws_pae_key_storage.h"
+#include "6lowpan/ws/ws_bbr_api_internal.h"
 
 #include "6lowpan/ws/ws_pae_auth.h"
 
@@ -118,6 +120,7 @@ typedef struct pae_auth {
     supp_list_t active_supp_list;                            /**< List of active supplicants */
     supp_list_t waiting_supp_list;                           /**< List of waiting supplicants */
     shared_comp_list_t shared_comp_list;                     /**< Shared component list */
+    supp_timer_wheel_t timer_wheel;                          /**< Supplicant timers */
     struct event_storage *timer;                              /**< Timer */
     pae_auth_gtk_t gtks;                                     /**< Material for GTKs */
     pae_auth_gtk_t lgtks;                                    /**< Material for LGTKs */
@@ -125,7 +128,11 @@ typedef struct pae_auth {
     sec_prot_keys_nw_info_t *sec_keys_nw_info;               /**< Security keys network information */
     sec_cfg_t *sec_cfg;                                      /**< Security configuration */
     uint16_t supp_max_number;                                /**< Max number of stored supplicants */
+    uint16_t full_auth_max;                                  /**< Max number of ongoing full authentications, 0 no limit */
+    uint16_t key_auth_max;                                   /**< Max number of ongoing key handshakes with existing PMK, 0 no limit */
     uint16_t waiting_supp_list_size;                         /**< Waiting supplicants list size */
+    uint32_t full_handshake_count;                           /**< Authentications which required EAP-TLS */
+    uint32_t pmk_reuse_count;                                /**< Authentications which went straight to the 4WH */
     uint8_t relay_socked_msg_if_instance_id;                 /**< Relay socket message interface instance identifier */
     uint8_t radius_socked_msg_if_instance_id;                /**< Radius socket message interface instance identifier */
     bool timer_running : 1;                                  /**< Timer is running */
@@ -145,6 +152,7 @@ static void ws_pae_auth_gtk_key_insert(sec_prot_gtk_keys_t *gtks, sec_prot_gtk_k
 static int8_t ws_pae_auth_new_gtk_activate(sec_prot_gtk_keys_t *gtks);
 static int8_t ws_pae_auth_timer_if_start(kmp_service_t *service, kmp_api_t *kmp);
 static int8_t ws_pae_auth_timer_if_stop(kmp_service_t *service, kmp_api_t *kmp);
+static int8_t ws_pae_auth_receive_id_if_set(kmp_service_t *service, kmp_api_t *kmp, uint8_t id);
 static int8_t ws_pae_auth_timer_start(pae_auth_t *pae_auth);
 static int8_t ws_pae_auth_timer_stop(pae_auth_t *pae_auth);
 static int8_t ws_pae_auth_shared_comp_add(kmp_service_t *service, kmp_shared_comp_t *data);
@@ -154,6 +162,9 @@ static void ws_pae_auth_kmp_service_addr_get(kmp_service_t *service, kmp_api_t *
 static void ws_pae_auth_kmp_service_ip_addr_get(kmp_service_t *service, kmp_api_t *kmp, uint8_t *address);
 static kmp_api_t *ws_pae_auth_kmp_service_api_get(kmp_service_t *service, kmp_api_t *kmp, kmp_type_e type);
 static bool ws_pae_auth_active_limit_reached(uint16_t active_supp, pae_auth_t *pae_auth);
+static bool ws_pae_auth_auth_limit_reached(pae_auth_t *pae_auth, bool full_auth);
+static bool ws_pae_auth_supp_full_auth(supp_entry_t *supp_entry);
+static void ws_pae_auth_waiting_supp_admit(pae_auth_t *pae_auth);
 static kmp_api_t *ws_pae_auth_kmp_incoming_ind(kmp_service_t *service, uint8_t msg_if_instance_id, kmp_type_e type, const kmp_addr_t *addr, const void *pdu, uint16_t size);
 static void ws_pae_auth_kmp_api_create_confirm(kmp_api_t *kmp, kmp_result_e result);
 static void ws_pae_auth_kmp_api_create_indication(kmp_api_t *kmp, kmp_type_e type, kmp_addr_t *addr);
@@ -164,6 +175,7 @@ static kmp_api_t *ws_pae_auth_kmp_create_and_start(kmp_service_t *service, kmp_t
 static void ws_pae_auth_kmp_api_finished(kmp_api_t *kmp);
 static void ws_pae_auth_active_supp_deleted(void *pae_auth);
 static void ws_pae_auth_waiting_supp_deleted(void *pae_auth);
+static void ws_pae_auth_supp_expired(void *pae_auth, supp_entry_t *supp_entry);
 
 static int8_t tasklet_id = -1;
 static NS_LIST_DEFINE(pae_auth_list, pae_auth_t, link);
@@ -195,6 +207,7 @@ int8_t ws_pae_auth_init(struct net_if *interface_ptr,
     pae_auth->interface_ptr = interface_ptr;
     ws_pae_lib_supp_list_init(&pae_auth->active_supp_list);
     ws_pae_lib_supp_list_init(&pae_auth->waiting_supp_list);
+    ws_pae_lib_supp_timer_wheel_init(&pae_auth->timer_wheel, pae_auth);
     ws_pae_lib_shared_comp_list_init(&pae_auth->shared_comp_list);
     pae_auth->timer = NULL;
 
@@ -211,6 +224,8 @@ int8_t ws_pae_auth_init(struct net_if *interface_ptr,
     pae_auth->sec_keys_nw_info = sec_keys_nw_info;
     pae_auth->sec_cfg = sec_cfg;
     pae_auth->supp_max_number = SUPPLICANT_MAX_NUMBER;
+    pae_auth->full_auth_max = 0;
+    pae_auth->key_auth_max = 0;
     pae_auth->waiting_supp_list_size = 0;
 
     pae_auth->gtks.next_gtks = next_gtks;
@@ -257,6 +272,11 @@ int8_t ws_pae_auth_init(struct net_if *interface_ptr,
         goto error;
     }
 
+    if (kmp_service_receive_id_if_register(pae_auth->kmp_service,
+                                           ws_pae_auth_receive_id_if_set)) {
+        goto error;
+    }
+
     if (kmp_service_shared_comp_if_register(pae_auth->kmp_service,
                                             ws_pae_auth_shared_comp_add,
                                             ws_pae_auth_shared_comp_remove)) {
@@ -308,6 +328,9 @@ int8_t ws_pae_auth_init(struct net_if *interface_ptr,
 
     ns_list_add_to_end(&pae_auth_list, pae_auth);
 
+    // Load stored keys now rather than on the first EAPOL frame
+    ws_pae_key_storage_preload();
+
     return 0;
 
 error:
@@ -505,6 +528,10 @@ int8_t ws_pae_auth_node_keys_remove(struct net_if *interface_ptr, uint8_t *eui_6
         ret_value = 0;
     }
 
+    // Sessions are not indexed by EUI-64, forget all of them
+    tls_sec_prot_lib_sessions_flush();
+    ws_bbr_nodes_changed();
+
     return ret_value;
 }
 
@@ -601,6 +628,23 @@ int8_t ws_pae_auth_node_limit_set(struct net_if *interface_ptr, uint16_t limit)
     return 0;
 }
 
+int8_t ws_pae_auth_auth_limit_set(struct net_if *interface_ptr, uint16_t full_auth_max, uint16_t key_auth_max)
+{
+    if (!interface_ptr) {
+        return -1;
+    }
+
+    pae_auth_t *pae_auth = ws_pae_auth_get(interface_ptr);
+    if (!pae_auth) {
+        return -1;
+    }
+
+    pae_auth->full_auth_max = full_auth_max;
+    pae_auth->key_auth_max = key_auth_max;
+
+    return 0;
+}
+
 int8_t ws_pae_auth_nw_info_set(struct net_if *interface_ptr, uint16_t pan_id, char *network_name, bool updated)
 {
     (void) updated;
@@ -789,9 +833,7 @@ void ws_pae_auth_fast_timer(uint16_t ticks)
         }
 
         // Updates KMP timers
-        bool active_running = ws_pae_lib_supp_list_timer_update(pae_auth, &pae_auth->active_supp_list, ticks, kmp_service_timer_if_timeout, ws_pae_auth_active_supp_deleted);
-        bool wait_running = ws_pae_lib_supp_list_timer_update(pae_auth, &pae_auth->waiting_supp_list, ticks, kmp_service_timer_if_timeout, ws_pae_auth_waiting_supp_deleted);
-        if (!active_running && !wait_running) {
+        if (!ws_pae_lib_supp_timer_wheel_update(&pae_auth->timer_wheel, ticks, kmp_service_timer_if_timeout, ws_pae_auth_supp_expired)) {
             ws_pae_auth_timer_stop(pae_auth);
         }
     }
@@ -1076,6 +1118,9 @@ static int8_t ws_pae_auth_timer_if_start(kmp_service_t *service, kmp_api_t *kmp)
     }
 
     ws_pae_lib_kmp_timer_start(&supp_entry->kmp_list, entry);
+    if (supp_entry->timer_wheel) {
+        ws_pae_lib_supp_timer_schedule(supp_entry->timer_wheel, supp_entry);
+    }
     return 0;
 }
 
@@ -1091,6 +1136,27 @@ static int8_t ws_pae_auth_timer_if_stop(kmp_service_t *service, kmp_api_t *kmp)
     }
 
     ws_pae_lib_kmp_timer_stop(&supp_entry->kmp_list, entry);
+    if (supp_entry->timer_wheel) {
+        ws_pae_lib_supp_timer_schedule(supp_entry->timer_wheel, supp_entry);
+    }
+    return 0;
+}
+
+static int8_t ws_pae_auth_receive_id_if_set(kmp_service_t *service, kmp_api_t *kmp, uint8_t id)
+{
+    (void) service;
+
+    supp_entry_t *supp_entry = kmp_api_data_get(kmp);
+    if (!supp_entry) {
+        return -1;
+    }
+
+    kmp_entry_t *entry = ws_pae_lib_kmp_list_entry_get(&supp_entry->kmp_list, kmp);
+    if (!entry) {
+        return -1;
+    }
+
+    ws_pae_lib_kmp_receive_id_set(supp_entry, entry, id);
     return 0;
 }
 
@@ -1180,6 +1246,31 @@ static bool ws_pae_auth_active_limit_reached(uint16_t active_supp, pae_auth_t *p
     return pae_auth->congestion_get(pae_auth->interface_ptr, active_supp);
 }
 
+static bool ws_pae_auth_supp_full_auth(supp_entry_t *supp_entry)
+{
+    // Supplicants without PMK need EAP-TLS, others only need a 4WH/GKH
+    return supp_entry->eap_tls_started || !sec_prot_keys_pmk_get(&supp_entry->sec_keys);
+}
+
+static bool ws_pae_auth_auth_limit_reached(pae_auth_t *pae_auth, bool full_auth)
+{
+    uint16_t max = full_auth ? pae_auth->full_auth_max : pae_auth->key_auth_max;
+    uint16_t ongoing = 0;
+
+    if (!max) {
+        return false;
+    }
+
+    // Active supplicants without KMP have completed their negotiation
+    ns_list_foreach(supp_entry_t, entry, &pae_auth->active_supp_list) {
+        if (!ns_list_is_empty(&entry->kmp_list) && ws_pae_auth_supp_full_auth(entry) == full_auth) {
+            ongoing++;
+        }
+    }
+
+    return ongoing >= max;
+}
+
 static void ws_pae_auth_waiting_supp_remove_oldest(pae_auth_t *pae_auth, const kmp_addr_t *addr)
 {
     supp_entry_t *delete_supp = ns_list_get_last(&pae_auth->waiting_supp_list);
@@ -1204,7 +1295,7 @@ static supp_entry_t *ws_pae_auth_waiting_supp_list_add(pae_auth_t *pae_auth, sup
         if (pae_auth->waiting_supp_list_size >= WAITING_SUPPLICANT_LIST_MAX_SIZE) {
             ws_pae_auth_waiting_supp_remove_oldest(pae_auth, addr);
         }
-        ns_list_add_to_start(&pae_auth->waiting_supp_list, supp_entry);
+        ws_pae_lib_supp_list_insert(&pae_auth->waiting_supp_list, supp_entry);
         pae_auth->waiting_supp_list_size++;
     } else {
         // If the waiting list if full removes the oldest entry from the list
@@ -1222,6 +1313,7 @@ static supp_entry_t *ws_pae_auth_waiting_supp_list_add(pae_auth_t *pae_auth, sup
 
     // 90 percent of the EAPOL temporary entry lifetime (10 ticks per second)
     supp_entry->waiting_ticks = pae_auth->sec_cfg->timing_cfg.temp_eapol_min_timeout * 900 / 100;
+    ws_pae_lib_supp_timer_schedule(&pae_auth->timer_wheel, supp_entry);
 
     tr_info("PAE: to waiting, list size %i, retry %i, eui-64: %s", pae_auth->waiting_supp_list_size, supp_entry->waiting_ticks, tr_eui64(supp_entry->addr.eui_64));
 
@@ -1254,7 +1346,7 @@ static kmp_api_t *ws_pae_auth_kmp_incoming_ind(kmp_service_t *service, uint8_t m
             /* Remove from waiting list (supplicant is later added to active list, or if no room back to the start of the
              * waiting list with updated timer)
              */
-            ns_list_remove(&pae_auth->waiting_supp_list, supp_entry);
+            ws_pae_lib_supp_list_detach(&pae_auth->waiting_supp_list, supp_entry);
             pae_auth->waiting_supp_list_size--;
             supp_entry->waiting_ticks = 0;
         } else {
@@ -1262,9 +1354,12 @@ static kmp_api_t *ws_pae_auth_kmp_incoming_ind(kmp_service_t *service, uint8_t m
             supp_entry = ws_pae_key_storage_supp_read(pae_auth, kmp_address_eui_64_get(addr), pae_auth->sec_keys_nw_info->gtks, pae_auth->sec_keys_nw_info->lgtks, pae_auth->certs);
         }
 
+        // Supplicants with a PMK do not need EAP-TLS, their number is limited separately
+        bool full_auth = !supp_entry || ws_pae_auth_supp_full_auth(supp_entry);
+
         // Checks if active supplicant list has space for new supplicants
-        if (ws_pae_auth_active_limit_reached(active_supp, pae_auth)) {
-            tr_debug("PAE: active limit reached, eui-64: %s", tr_eui64(kmp_address_eui_64_get(addr)));
+        if (ws_pae_auth_active_limit_reached(active_supp, pae_auth) || ws_pae_auth_auth_limit_reached(pae_auth, full_auth)) {
+            tr_debug("PAE: active limit reached, %s, eui-64: %s", full_auth ? "full auth" : "key auth", tr_eui64(kmp_address_eui_64_get(addr)));
             // If there is no space, add supplicant entry to the start of the waiting supplicant list
             supp_entry = ws_pae_auth_waiting_supp_list_add(pae_auth, supp_entry, addr);
             if (!supp_entry) {
@@ -1277,7 +1372,8 @@ static kmp_api_t *ws_pae_auth_kmp_incoming_ind(kmp_service_t *service, uint8_t m
                  * start/continue authentication
                  */
                 tr_debug("PAE: to active, eui-64: %s", tr_eui64(supp_entry->addr.eui_64));
-                ns_list_add_to_start(&pae_auth->active_supp_list, supp_entry);
+                ws_pae_lib_supp_list_insert(&pae_auth->active_supp_list, supp_entry);
+                ws_pae_lib_supp_timer_schedule(&pae_auth->timer_wheel, supp_entry);
             }
         }
     }
@@ -1288,6 +1384,7 @@ static kmp_api_t *ws_pae_auth_kmp_incoming_ind(kmp_service_t *service, uint8_t m
         if (!supp_entry) {
             return 0;
         }
+        ws_pae_lib_supp_timer_schedule(&pae_auth->timer_wheel, supp_entry);
         sec_prot_keys_init(&supp_entry->sec_keys, pae_auth->sec_keys_nw_info->gtks, pae_auth->sec_keys_nw_info->lgtks, pae_auth->certs);
     } else {
         // Updates relay address
@@ -1482,6 +1579,9 @@ static kmp_type_e ws_pae_auth_next_protocol_get(pae_auth_t *pae_auth, supp_entry
             next_type = IEEE_802_1X_MKA;
         }
         tr_info("PAE: start EAP-TLS, eui-64: %s", tr_eui64(supp_entry->addr.eui_64));
+        if (!supp_entry->eap_tls_started)
+            pae_auth->full_handshake_count++;
+        supp_entry->eap_tls_started = true;
         return next_type;
     }
     if (sec_keys->ptk_mismatch) {
@@ -1502,6 +1602,9 @@ static kmp_type_e ws_pae_auth_next_protocol_get(pae_auth_t *pae_auth, supp_entry
         // start 4WH towards supplicant
         next_type = IEEE_802_11_4WH;
         tr_info("PAE: start 4WH, eui-64: %s", tr_eui64(supp_entry->addr.eui_64));
+        if (!supp_entry->eap_tls_started)
+            pae_auth->pmk_reuse_count++;
+        supp_entry->eap_tls_started = false;
     }
 
     int8_t gtk_index = -1;
@@ -1617,8 +1720,19 @@ static void ws_pae_auth_kmp_api_finished(kmp_api_t *kmp)
         return;
     }
 
+    pae_auth_t *pae_auth = ws_pae_auth_by_kmp_service_get(kmp_api_service_get(kmp));
+    kmp_type_e type = kmp_api_type_get(kmp);
+
     // Delete KMP
     ws_pae_lib_kmp_list_delete(&supp_entry->kmp_list, kmp);
+    // The keys of the supplicant may have been stored
+    ws_bbr_nodes_changed();
+
+    // Negotiation or EAP-TLS has ended, there may be room for a waiting supplicant
+    if (pae_auth && supp_entry->list == &pae_auth->active_supp_list &&
+        (ns_list_is_empty(&supp_entry->kmp_list) || type == IEEE_802_1X_MKA || type == RADIUS_IEEE_802_1X_MKA)) {
+        ws_pae_auth_waiting_supp_admit(pae_auth);
+    }
 }
 
 static void ws_pae_auth_active_supp_deleted(void *pae_auth_ptr)
@@ -1627,18 +1741,47 @@ static void ws_pae_auth_active_supp_deleted(void *pae_auth_ptr)
 
     tr_info("Supplicant deleted");
 
+    ws_pae_auth_waiting_supp_admit(pae_auth);
+}
+
+static void ws_pae_auth_waiting_supp_admit(pae_auth_t *pae_auth)
+{
+    supp_entry_t *retry_supp = NULL;
+
+    if (ns_list_is_empty(&pae_auth->waiting_supp_list)) {
+        return;
+    }
+
     uint16_t active_supp = ns_list_count(&pae_auth->active_supp_list);
     if (ws_pae_auth_active_limit_reached(active_supp, pae_auth)) {
         return;
     }
 
-    supp_entry_t *retry_supp = ns_list_get_first(&pae_auth->waiting_supp_list);
+    // Supplicants with a PMK are cheap to admit, they go first
+    if (!ws_pae_auth_auth_limit_reached(pae_auth, false)) {
+        ns_list_foreach(supp_entry_t, entry, &pae_auth->waiting_supp_list) {
+            if (!ws_pae_auth_supp_full_auth(entry)) {
+                retry_supp = entry;
+                break;
+            }
+        }
+    }
+    if (!retry_supp && !ws_pae_auth_auth_limit_reached(pae_auth, true)) {
+        ns_list_foreach(supp_entry_t, entry, &pae_auth->waiting_supp_list) {
+            if (ws_pae_auth_supp_full_auth(entry)) {
+                retry_supp = entry;
+                break;
+            }
+        }
+    }
+
     if (retry_supp != NULL) {
-        ns_list_remove(&pae_auth->waiting_supp_list, retry_supp);
+        ws_pae_lib_supp_list_detach(&pae_auth->waiting_supp_list, retry_supp);
         pae_auth->waiting_supp_list_size--;
-        ns_list_add_to_start(&pae_auth->active_supp_list, retry_supp);
+        ws_pae_lib_supp_list_insert(&pae_auth->active_supp_list, retry_supp);
         tr_info("PAE: waiting supplicant to active, eui-64: %s", tr_eui64(retry_supp->addr.eui_64));
         retry_supp->waiting_ticks = 0;
+        ws_pae_lib_supp_timer_schedule(&pae_auth->timer_wheel, retry_supp);
         ws_pae_auth_next_kmp_trigger(pae_auth, retry_supp);
     }
 }
@@ -1649,12 +1792,33 @@ static void ws_pae_auth_waiting_supp_deleted(void *pae_auth_ptr)
     pae_auth->waiting_supp_list_size--;
 }
 
+static void ws_pae_auth_supp_expired(void *pae_auth_ptr, supp_entry_t *supp_entry)
+{
+    pae_auth_t *pae_auth = pae_auth_ptr;
+
+    if (supp_entry->list == &pae_auth->waiting_supp_list) {
+        ws_pae_lib_supp_list_to_inactive(pae_auth, &pae_auth->waiting_supp_list, supp_entry, ws_pae_auth_waiting_supp_deleted);
+    } else {
+        ws_pae_lib_supp_list_to_inactive(pae_auth, &pae_auth->active_supp_list, supp_entry, ws_pae_auth_active_supp_deleted);
+    }
+    ws_bbr_nodes_changed();
+}
+
+void ws_pae_auth_stats(int8_t interface_id, uint32_t *full_handshake, uint32_t *pmk_reuse)
+{
+    struct net_if *interface_ptr = protocol_stack_interface_info_get_by_id(interface_id);
+    pae_auth_t *pae_auth = interface_ptr ? ws_pae_auth_get(interface_ptr) : NULL;
+
+    *full_handshake = pae_auth ? pae_auth->full_handshake_count : 0;
+    *pmk_reuse = pae_auth ? pae_auth->pmk_reuse_count : 0;
+}
+
 int ws_pae_auth_supp_list(int8_t interface_id, uint8_t eui64[][8], int len)
 {
     struct net_if *interface_ptr;
     supp_list_t *supp_lists[2];
     pae_auth_t *pae_auth;
-    int len_ret, j;
+    int len_ret;
 
     interface_ptr = protocol_stack_interface_info_get_by_id(interface_id);
     if (!interface_ptr)
@@ -1672,10 +1836,8 @@ int ws_pae_auth_supp_list(int8_t interface_id, uint8_t eui64[][8], int len)
 
     for (int i = 0; i < ARRAY_SIZE(supp_lists); i++) {
         ns_list_foreach(supp_entry_t, cur, supp_lists[i]) {
-            for (j = 0; j < len_ret; j++)
-                if (!memcmp(cur->addr.eui_64, eui64[j], 8))
-                    break;
-            if (j != len_ret)
+            // Already listed from the key storage
+            if (ws_pae_key_storage_supp_exists(cur->addr.eui_64))
                 continue;
             memcpy(eui64[len_ret++], cur->addr.eui_64, 8);
             if (len_ret == len)
@@ -191,6 +191,19 @@ int8_t ws_pae_auth_node_access_revoke_start(struct net_if *interface_ptr, bool i
  */
 int8_t ws_pae_auth_node_limit_set(struct net_if *interface_ptr, uint16_t limit);
 
+/**
+ * ws_pae_auth_auth_limit_set set limits of ongoing authentications
+ *
+ * \param interface_ptr interface
+ * \param full_auth_max max number of ongoing full authentications (EAP-TLS), 0 no limit
+ * \param key_auth_max max number of ongoing key handshakes of supplicants with a PMK, 0 no limit
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+int8_t ws_pae_auth_auth_limit_set(struct net_if *interface_ptr, uint16_t full_auth_max, uint16_t key_auth_max);
+
 /**
  * ws_pae_auth_nw_info_set set network information
  *
@@ -308,6 +321,9 @@ void ws_pae_auth_cb_register(struct net_if *interface_ptr,
                              ws_pae_auth_nw_frame_counter_read *nw_frame_cnt_read);
 
 int ws_pae_auth_supp_list(int8_t interface_id, uint8_t eui64[][8], int len);
+// Number of authentications which required EAP-TLS, and of those which reused
+// a known PMK to go straight to the 4WH
+void ws_pae_auth_stats(int8_t interface_id, uint32_t *full_handshake, uint32_t *pmk_reuse);
 void ws_pae_auth_gtk_install(int8_t interface_id, const uint8_t key[GTK_LEN], bool is_lgtk);
 
 #else
@@ -324,6 +340,7 @@ void ws_pae_auth_gtk_install(int8_t interface_id, const uint8_t key[GTK_LEN], bo
 #define ws_pae_auth_node_keys_remove(interface_ptr, eui64) -1
 #define ws_pae_auth_node_access_revoke_start(interface_ptr, is_lgtk, new_gtk) -1
 #define ws_pae_auth_node_limit_set(interface_ptr, limit)
+#define ws_pae_auth_auth_limit_set(interface_ptr, full_auth_max, key_auth_max)
 #define ws_pae_auth_fast_timer NULL
 #define ws_pae_auth_slow_timer NULL
 #define ws_pae_auth_radius_address_set(interface_ptr, remote_addr) -1
@@ -18,6 +18,7 @@
 #define _GNU_SOURCE
 #include <string.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -27,6 +28,7 @@
 #if MBEDTLS_VERSION_MAJOR > 2
 #include <mbedtls/compat-2.x.h>
 #endif
+#include "common/crc.h"
 #include "common/log.h"
 #include "common/named_values.h"
 #include "common/key_value_storage.h"
@@ -125,7 +127,10 @@ typedef struct pae_controller {
 typedef struct pae_controller_config {
     sec_radius_cfg_t *radius_cfg;                                    /**< Radius configuration settings */
     uint16_t node_limit;                                             /**< Max number of stored supplicants */
+    uint16_t full_auth_max;                                          /**< Max number of ongoing full authentications */
+    uint16_t key_auth_max;                                           /**< Max number of ongoing key handshakes */
     bool node_limit_set : 1;                                         /**< Node limit set */
+    bool auth_limit_set : 1;                                         /**< Authentication limits set */
     bool ext_cert_valid_enabled : 1;                                 /**< Extended certificate validation enabled */
 } pae_controller_config_t;
 
@@ -138,7 +143,9 @@ static int8_t  ws_pae_controller_auth_nw_frame_counter_read(struct net_if *inter
 #endif
 static pae_controller_t *ws_pae_controller_get(struct net_if *interface_ptr);
 static void ws_pae_controller_frame_counter_timer(uint16_t seconds, pae_controller_t *entry);
+static void ws_pae_controller_frame_counter_threshold_update(pae_controller_t *entry, bool is_lgtk);
 static void ws_pae_controller_frame_counter_store(pae_controller_t *entry, bool use_threshold, bool is_lgtk);
+static void ws_pae_controller_nvm_frame_counter_write(pae_controller_t *entry);
 static int8_t ws_pae_controller_nvm_frame_counter_read(uint64_t *stored_time,
                                                        uint16_t *pan_version, uint16_t *lpan_version,
                                                        frame_counters_t *gtk_counters,
@@ -152,6 +159,7 @@ static void ws_pae_controller_nw_key_index_check_and_set(struct net_if *interfac
 #endif
 static void ws_pae_controller_data_init(pae_controller_t *controller);
 static int8_t ws_pae_controller_frame_counter_read(pae_controller_t *controller);
+static void ws_pae_controller_frame_counter_restore(frame_counters_t *frame_counters, int count);
 static void ws_pae_controller_frame_counter_reset(frame_counters_t *frame_counters);
 static void ws_pae_controller_frame_counter_index_reset(frame_counters_t *frame_counters, uint8_t index);
 static int8_t ws_pae_controller_nw_info_read(pae_controller_t *controller,
@@ -171,6 +179,9 @@ pae_controller_config_t pae_controller_config = {
     .radius_cfg = NULL,
     .node_limit = 0,
     .node_limit_set = false,
+    .full_auth_max = 0,
+    .key_auth_max = 0,
+    .auth_limit_set = false,
     .ext_cert_valid_enabled = false
 };
 
@@ -265,6 +276,10 @@ int8_t ws_pae_controller_authenticator_start(struct net_if *interface_ptr, uint1
         ws_pae_auth_node_limit_set(controller->interface_ptr, pae_controller_config.node_limit);
     }
 
+    if (pae_controller_config.auth_limit_set) {
+        ws_pae_auth_auth_limit_set(controller->interface_ptr, pae_controller_config.full_auth_max, pae_controller_config.key_auth_max);
+    }
+
     ws_pae_auth_cb_register(interface_ptr,
                             ws_pae_controller_gtk_hash_set,
                             ws_pae_controller_nw_key_check_and_insert,
@@ -900,28 +915,45 @@ static int8_t ws_pae_controller_frame_counter_read(pae_controller_t *controller)
         // Increments PAN version to ensure that it is fresh
         controller->sec_keys_nw_info.pan_version += PAN_VERSION_STORAGE_READ_INCREMENT;
 
-        // Checks frame counters
-        for (uint8_t index = 0; index < GTK_NUM; index++) {
-            if (controller->gtks.frame_counters.counter[index].set) {
-                // If there is room on frame counter space
-                if (controller->gtks.frame_counters.counter[index].frame_counter < (UINT32_MAX - FRAME_COUNTER_INCREMENT * 2)) {
-                    // Increments frame counters
-                    controller->gtks.frame_counters.counter[index].frame_counter += FRAME_COUNTER_INCREMENT;
-                } else {
-                    tr_error("Frame counter space exhausted");
-                    controller->gtks.frame_counters.counter[index].frame_counter = UINT32_MAX;
-                }
-                controller->gtks.frame_counters.counter[index].stored_frame_counter =
-                    controller->gtks.frame_counters.counter[index].frame_counter;
-
-                tr_info("Read frame counter: index %i value %"PRIu32"", index, controller->gtks.frame_counters.counter[index].frame_counter);
-            }
-        }
+        ws_pae_controller_frame_counter_restore(&controller->gtks.frame_counters, GTK_NUM);
+        ws_pae_controller_frame_counter_restore(&controller->lgtks.frame_counters, LGTK_NUM);
     }
 
     return 0;
 }
 
+static void ws_pae_controller_frame_counter_restore(frame_counters_t *frame_counters, int count)
+{
+    frame_counter_t *counter;
+    uint32_t increment;
+
+    for (uint8_t index = 0; index < count; index++) {
+        counter = &frame_counters->counter[index];
+        if (!counter->set)
+            continue;
+        /* Frame counter is stored when it has advanced for the store threshold. Threshold covers
+           at least FRAME_COUNTER_STORE_PERIOD of traffic and is checked every FRAME_COUNTER_STORE_INTERVAL,
+           so twice the threshold is enough even if traffic has suddenly increased. */
+        if (counter->stored_threshold)
+            increment = counter->stored_threshold * 2;
+        else
+            increment = FRAME_COUNTER_INCREMENT;
+        // If there is room on frame counter space
+        if (counter->frame_counter < (UINT32_MAX - increment * 2)) {
+            // Increments frame counters
+            counter->frame_counter += increment;
+        } else {
+            tr_error("Frame counter space exhausted");
+            counter->frame_counter = UINT32_MAX;
+        }
+        counter->stored_frame_counter = counter->frame_counter;
+        counter->checked_frame_counter = counter->frame_counter;
+        counter->store_threshold = increment / 2;
+
+        tr_info("Read frame counter: index %i value %"PRIu32" increment %"PRIu32"", index, counter->frame_counter, increment);
+    }
+}
+
 static void ws_pae_controller_frame_counter_reset(frame_counters_t *frame_counters)
 {
     for (uint8_t index = 0; index < GTK_NUM; index++) {
@@ -1460,6 +1492,7 @@ sec_radius_cfg_t *ws_pae_controller_radius_config_get(void)
     pae_controller_config.radius_cfg->radius_retry_trickle_params.Imax = RADIUS_CLIENT_RETRY_IMAX;
     pae_controller_config.radius_cfg->radius_retry_trickle_params.k = 0;
     pae_controller_config.radius_cfg->radius_retry_trickle_params.TimerExpirations = RADIUS_CLIENT_TIMER_EXPIRATIONS;
+    pae_controller_config.radius_cfg->radius_window = RADIUS_CLIENT_WINDOW;
 
     pae_controller_config.radius_cfg->radius_addr_set = false;
     pae_controller_config.radius_cfg->radius_shared_secret_len = 0;
@@ -1623,6 +1656,24 @@ int8_t ws_pae_controller_radius_timing_get(int8_t interface_id, bbr_radius_timin
     return 0;
 }
 
+int8_t ws_pae_controller_radius_window_set(int8_t interface_id, uint8_t window)
+{
+    (void) interface_id;
+
+    if (window == 0) {
+        return -1;
+    }
+
+    sec_radius_cfg_t *radius_cfg = ws_pae_controller_radius_config_get();
+    if (radius_cfg == NULL) {
+        return -1;
+    }
+
+    radius_cfg->radius_window = window;
+
+    return 0;
+}
+
 int8_t ws_pae_controller_radius_timing_validate(int8_t interface_id, bbr_radius_timing_t *timing)
 {
     (void) interface_id;
@@ -1878,6 +1929,29 @@ int8_t ws_pae_controller_node_limit_set(int8_t interface_id, uint16_t limit)
 #endif
 }
 
+int8_t ws_pae_controller_auth_limit_set(int8_t interface_id, uint16_t full_auth_max, uint16_t key_auth_max)
+{
+#ifdef HAVE_PAE_AUTH
+    pae_controller_config.full_auth_max = full_auth_max;
+    pae_controller_config.key_auth_max = key_auth_max;
+    pae_controller_config.auth_limit_set = true;
+
+    pae_controller_t *controller = ws_pae_controller_get_or_create(interface_id);
+    if (!controller) {
+        return -1;
+    }
+
+    ws_pae_auth_auth_limit_set(controller->interface_ptr, full_auth_max, key_auth_max);
+
+    return 0;
+#else
+    (void) interface_id;
+    (void) full_auth_max;
+    (void) key_auth_max;
+    return -1;
+#endif
+}
+
 int8_t ws_pae_controller_ext_certificate_validation_set(int8_t interface_id, bool enabled)
 {
 #ifdef HAVE_PAE_AUTH
@@ -2027,6 +2101,8 @@ static void ws_pae_controller_frame_counter_timer(uint16_t seconds, pae_controll
         entry->frame_cnt_store_timer -= seconds;
     } else {
         entry->frame_cnt_store_timer = FRAME_COUNTER_STORE_INTERVAL;
+        ws_pae_controller_frame_counter_threshold_update(entry, false);
+        ws_pae_controller_frame_counter_threshold_update(entry, true);
         ws_pae_controller_frame_counter_store(entry, true, false);
         ws_pae_controller_frame_counter_store(entry, true, true);
     }
@@ -2040,6 +2116,48 @@ static void ws_pae_controller_frame_counter_timer(uint16_t seconds, pae_controll
     }
 }
 
+/* Adapts the store threshold to the rate at which the frame counter advances, so that storing
+   happens about once per FRAME_COUNTER_STORE_PERIOD. Slow traffic gives a small threshold, so
+   less frame counter space is skipped on start up. The threshold is lowered slowly to avoid
+   storing again each time bursty traffic increases the threshold. */
+static void ws_pae_controller_frame_counter_threshold_update(pae_controller_t *entry, bool is_lgtk)
+{
+    pae_controller_gtk_t *gtks;
+    frame_counter_t *counter;
+    uint32_t curr_frame_counter;
+    uint64_t threshold;
+    int key_offset;
+
+    if (is_lgtk) {
+        gtks = &entry->lgtks;
+        key_offset = GTK_NUM;
+    } else {
+        gtks = &entry->gtks;
+        key_offset = 0;
+    }
+
+    for (int i = 0; i < GTK_NUM; i++) {
+        counter = &gtks->frame_counters.counter[i];
+        if (!gtks->nw_key[i].installed || !counter->set ||
+            memcmp(gtks->nw_key[i].gtk, counter->gtk, GTK_LEN) != 0)
+            continue;
+        entry->nw_frame_counter_read(entry->interface_ptr, &curr_frame_counter, i + key_offset);
+        if (curr_frame_counter <= counter->checked_frame_counter)
+            threshold = 0;
+        else
+            threshold = (uint64_t)(curr_frame_counter - counter->checked_frame_counter) *
+                        FRAME_COUNTER_STORE_PERIOD / FRAME_COUNTER_STORE_INTERVAL;
+        counter->checked_frame_counter = curr_frame_counter;
+        if (threshold < counter->store_threshold)
+            threshold = counter->store_threshold - (counter->store_threshold - threshold) / 4;
+        if (threshold < FRAME_COUNTER_STORE_THRESHOLD_MIN)
+            threshold = FRAME_COUNTER_STORE_THRESHOLD_MIN;
+        if (threshold > FRAME_COUNTER_STORE_THRESHOLD_MAX)
+            threshold = FRAME_COUNTER_STORE_THRESHOLD_MAX;
+        counter->store_threshold = threshold;
+    }
+}
+
 static void ws_pae_controller_frame_counter_store(pae_controller_t *entry, bool use_threshold, bool is_lgtk)
 {
     bool update_needed = false;
@@ -2074,13 +2192,16 @@ static void ws_pae_controller_frame_counter_store(pae_controller_t *entry, bool
                     gtks->frame_counters.counter[i].frame_counter = curr_frame_counter;
                 }
                 uint32_t frame_counter = gtks->frame_counters.counter[i].frame_counter;
+                uint32_t threshold = gtks->frame_counters.counter[i].store_threshold;
 
                 /* If threshold check is disabled or frame counter has advanced for the threshold value, stores the new value.
-                   If frame counter is at maximum at storage, do not initiate storing */
-                if (!use_threshold || (
-                            (frame_counter > gtks->frame_counters.counter[i].stored_frame_counter + FRAME_COUNTER_STORE_THRESHOLD) &&
+                   If frame counter is at maximum at storage, do not initiate storing. If threshold has increased, stores
+                   it so that start up increments the frame counter enough. */
+                if (!use_threshold ||
+                    threshold > gtks->frame_counters.counter[i].stored_threshold || (
+                            (frame_counter > gtks->frame_counters.counter[i].stored_frame_counter + threshold) &&
                             !(gtks->frame_counters.counter[i].stored_frame_counter == UINT32_MAX &&
-                              frame_counter >= UINT32_MAX - FRAME_COUNTER_STORE_THRESHOLD))) {
+                              frame_counter >= UINT32_MAX - threshold))) {
                     gtks->frame_counters.counter[i].stored_frame_counter = frame_counter;
                     update_needed = true;
                     tr_debug("Stored updated frame counter: index %i value %"PRIu32"", i, frame_counter);
@@ -2091,6 +2212,9 @@ static void ws_pae_controller_frame_counter_store(pae_controller_t *entry, bool
                 memcpy(gtks->frame_counters.counter[i].gtk, gtks->nw_key[i].gtk, GTK_LEN);
                 gtks->frame_counters.counter[i].frame_counter = curr_frame_counter;
                 gtks->frame_counters.counter[i].stored_frame_counter = curr_frame_counter;
+                gtks->frame_counters.counter[i].checked_frame_counter = curr_frame_counter;
+                gtks->frame_counters.counter[i].store_threshold = FRAME_COUNTER_STORE_THRESHOLD_MIN;
+                gtks->frame_counters.counter[i].stored_threshold = FRAME_COUNTER_STORE_THRESHOLD_MIN;
                 tr_debug("Pending to store new frame counter: index %i value %"PRIu32"", i, curr_frame_counter);
             }
 
@@ -2106,55 +2230,141 @@ static void ws_pae_controller_frame_counter_store(pae_controller_t *entry, bool
         }
     }
 
-    if (update_needed || entry->frame_cnt_store_force_timer == 0) {
-        struct storage_parse_info *info = storage_open_prefix("counters", "w");
-        char str_buf[256];
-        int i;
-
-        if (!info)
-            return;
-        fprintf(info->file, "# stored time: %" PRIu64 "\n", ws_pae_current_time_get());
-        // FIXME: It seems harmless, but entry->sec_keys_nw_info.pan_version and
-        //        entry->sec_keys_nw_info.lpan_version are not set on wsnode.
-        //        They could be replaced by ws_info.pan_information.pan_version
-        //        and ws_info.pan_information.lpan_version
-        fprintf(info->file, "pan_version = %d\n", entry->sec_keys_nw_info.pan_version);
-        fprintf(info->file, "lpan_version = %d\n", entry->sec_keys_nw_info.lpan_version);
-        for (i = 0; i < GTK_NUM; i++) {
-            if (entry->gtks.frame_counters.counter[i].set) {
-                str_key(entry->gtks.frame_counters.counter[i].gtk, GTK_LEN, str_buf, sizeof(str_buf));
-                fprintf(info->file, "gtk[%d] = %s\n", i, str_buf);
-                fprintf(info->file, "gtk[%d].frame_counter = %d\n", i,
-                        entry->gtks.frame_counters.counter[i].frame_counter);
-                fprintf(info->file, "gtk[%d].max_frame_counter = %d\n", i,
-                        entry->gtks.frame_counters.counter[i].max_frame_counter_chg);
-            }
-        }
-        for (i = 0; i < LGTK_NUM; i++) {
-            if (entry->lgtks.frame_counters.counter[i].set) {
-                str_key(entry->lgtks.frame_counters.counter[i].gtk, GTK_LEN, str_buf, sizeof(str_buf));
-                fprintf(info->file, "lgtk[%d] = %s\n", i, str_buf);
-                fprintf(info->file, "lgtk[%d].frame_counter = %d\n", i,
-                        entry->lgtks.frame_counters.counter[i].frame_counter);
-                fprintf(info->file, "lgtk[%d].max_frame_counter = %d\n", i,
-                        entry->lgtks.frame_counters.counter[i].max_frame_counter_chg);
-            }
-        }
-        storage_close(info);
+    if (update_needed || entry->frame_cnt_store_force_timer == 0)
+        ws_pae_controller_nvm_frame_counter_write(entry);
+}
+
+#define FRAME_COUNTER_RECORD_MAGIC   0x544e4346 // "FCNT"
+#define FRAME_COUNTER_RECORD_VERSION 1
+
+// Content of the "counters" file. Integers are in host byte order.
+struct frame_counter_record {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t pan_version;
+    uint16_t lpan_version;
+    uint16_t set;           // Bit i for gtk[i], bit GTK_NUM + i for lgtk[i]
+    uint32_t reserved;
+    uint64_t stored_time;
+    struct {
+        uint8_t gtk[GTK_LEN];
+        uint32_t frame_counter;
+        uint32_t max_frame_counter_chg;
+        uint32_t store_threshold;
+        uint32_t reserved;
+    } counter[GTK_NUM + LGTK_NUM];
+    uint32_t reserved2;
+    uint32_t crc;
+};
+
+static void ws_pae_controller_nvm_frame_counter_to_record(struct frame_counter_record *record, int offset,
+                                                          frame_counters_t *frame_counters, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (!frame_counters->counter[i].set)
+            continue;
+        // Threshold is now stored, start up will increment frame counter accordingly
+        frame_counters->counter[i].stored_threshold = frame_counters->counter[i].store_threshold;
+        record->set |= 1u << (offset + i);
+        memcpy(record->counter[offset + i].gtk, frame_counters->counter[i].gtk, GTK_LEN);
+        record->counter[offset + i].frame_counter = frame_counters->counter[i].frame_counter;
+        record->counter[offset + i].max_frame_counter_chg = frame_counters->counter[i].max_frame_counter_chg;
+        record->counter[offset + i].store_threshold = frame_counters->counter[i].store_threshold;
     }
 }
 
+static void ws_pae_controller_nvm_frame_counter_from_record(const struct frame_counter_record *record, int offset,
+                                                            frame_counters_t *frame_counters, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (!(record->set & (1u << (offset + i))))
+            continue;
+        frame_counters->counter[i].set = true;
+        memcpy(frame_counters->counter[i].gtk, record->counter[offset + i].gtk, GTK_LEN);
+        frame_counters->counter[i].frame_counter = record->counter[offset + i].frame_counter;
+        frame_counters->counter[i].max_frame_counter_chg = record->counter[offset + i].max_frame_counter_chg;
+        frame_counters->counter[i].stored_threshold = record->counter[offset + i].store_threshold;
+        if (frame_counters->counter[i].stored_threshold > FRAME_COUNTER_STORE_THRESHOLD_MAX)
+            frame_counters->counter[i].stored_threshold = FRAME_COUNTER_STORE_THRESHOLD_MAX;
+    }
+}
+
+static void ws_pae_controller_nvm_frame_counter_write(pae_controller_t *entry)
+{
+    struct frame_counter_record record;
+    struct storage_parse_info *info;
+
+    memset(&record, 0, sizeof(record));
+    record.magic = FRAME_COUNTER_RECORD_MAGIC;
+    record.version = FRAME_COUNTER_RECORD_VERSION;
+    // FIXME: It seems harmless, but entry->sec_keys_nw_info.pan_version and
+    //        entry->sec_keys_nw_info.lpan_version are not set on wsnode.
+    //        They could be replaced by ws_info.pan_information.pan_version
+    //        and ws_info.pan_information.lpan_version
+    record.pan_version = entry->sec_keys_nw_info.pan_version;
+    record.lpan_version = entry->sec_keys_nw_info.lpan_version;
+    record.stored_time = ws_pae_current_time_get();
+    ws_pae_controller_nvm_frame_counter_to_record(&record, 0, &entry->gtks.frame_counters, GTK_NUM);
+    ws_pae_controller_nvm_frame_counter_to_record(&record, GTK_NUM, &entry->lgtks.frame_counters, LGTK_NUM);
+    record.crc = block_crc32(0, (uint8_t *)&record, offsetof(struct frame_counter_record, crc));
+
+    info = storage_open_prefix("counters", "wb");
+    if (!info)
+        return;
+    if (fwrite(&record, sizeof(record), 1, info->file) != 1)
+        WARN("%s: %m", info->filename);
+    storage_close(info);
+}
+
+// Returns 0 if the file is a valid binary record, 1 if it should be parsed as a text file
+static int ws_pae_controller_nvm_frame_counter_read_record(struct storage_parse_info *info,
+                                                           uint64_t *stored_time,
+                                                           uint16_t *pan_version, uint16_t *lpan_version,
+                                                           frame_counters_t *gtk_counters,
+                                                           frame_counters_t *lgtk_counters)
+{
+    struct frame_counter_record record;
+
+    if (fread(&record, 1, sizeof(record), info->file) != sizeof(record) ||
+        record.magic != FRAME_COUNTER_RECORD_MAGIC) {
+        rewind(info->file);
+        return 1;
+    }
+    if (record.version != FRAME_COUNTER_RECORD_VERSION) {
+        WARN("%s: unsupported version %u", info->filename, record.version);
+        return -1;
+    }
+    if (record.crc != block_crc32(0, (uint8_t *)&record, offsetof(struct frame_counter_record, crc))) {
+        WARN("%s: bad CRC", info->filename);
+        return -1;
+    }
+    *stored_time = record.stored_time;
+    *pan_version = record.pan_version;
+    *lpan_version = record.lpan_version;
+    ws_pae_controller_nvm_frame_counter_from_record(&record, 0, gtk_counters, GTK_NUM);
+    ws_pae_controller_nvm_frame_counter_from_record(&record, GTK_NUM, lgtk_counters, LGTK_NUM);
+    return 0;
+}
+
 static int8_t ws_pae_controller_nvm_frame_counter_read(uint64_t *stored_time,
                                                        uint16_t *pan_version, uint16_t *lpan_version,
                                                        frame_counters_t *gtk_counters,
                                                        frame_counters_t *lgtk_counters)
 {
-    struct storage_parse_info *info = storage_open_prefix("counters", "r");
+    struct storage_parse_info *info = storage_open_prefix("counters", "rb");
     int ret;
 
     if (!info)
         return -1;
 
+    ret = ws_pae_controller_nvm_frame_counter_read_record(info, stored_time, pan_version, lpan_version,
+                                                          gtk_counters, lgtk_counters);
+    if (ret <= 0) {
+        storage_close(info);
+        return ret;
+    }
+
+    // Previous versions stored the frame counters as text
     // Wednesday, January 1, 2020 0:00:00 GMT
     *stored_time = 1577836800;
     for (;;) {
@@ -316,6 +316,18 @@ int8_t ws_pae_controller_radius_timing_set(int8_t interface_id, struct bbr_radiu
  */
 int8_t ws_pae_controller_radius_timing_get(int8_t interface_id, struct bbr_radius_timing *timing);
 
+/**
+ * ws_pae_controller_radius_window_set set maximum number of radius requests waiting for a response
+ *
+ * \param interface_id interface identifier
+ * \param window number of requests
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+int8_t ws_pae_controller_radius_window_set(int8_t interface_id, uint8_t window);
+
 /**
  * ws_pae_controller_radius_timing_validate validate radius timing information
  *
@@ -468,6 +480,19 @@ int8_t ws_pae_controller_node_access_revoke_start(int8_t interface_id, bool is_l
  */
 int8_t ws_pae_controller_node_limit_set(int8_t interface_id, uint16_t limit);
 
+/**
+ * ws_pae_controller_auth_limit_set set limits of ongoing authentications
+ *
+ * \param interface_id interface identifier
+ * \param full_auth_max max number of ongoing full authentications, 0 no limit
+ * \param key_auth_max max number of ongoing key handshakes, 0 no limit
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+int8_t ws_pae_controller_auth_limit_set(int8_t interface_id, uint16_t full_auth_max, uint16_t key_auth_max);
+
 /**
  * ws_pae_controller_ext_certificate_validation_set enable or disable extended certificate validation
  *
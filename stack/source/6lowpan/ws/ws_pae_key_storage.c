@@ -21,14 +21,25 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <glob.h>
 #include <fnmatch.h>
+#include <libgen.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
 #include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common/crc.h"
 #include "common/log.h"
 #include "common/rand.h"
+#include "common/utils.h"
 #include "common/parsers.h"
 #include "common/named_values.h"
 #include "common/key_value_storage.h"
+#include "service_libs/fnv_hash/fnv_hash.h"
 
 #include "security/protocols/sec_prot_keys.h"
 #include "6lowpan/ws/ws_common_defines.h"
@@ -37,6 +48,88 @@
 
 #include "6lowpan/ws/ws_pae_key_storage.h"
 
+/*
+ * All the supplicant keys are stored in a single file made of a header
+ * followed by fixed size records. The file is only appended to: a new record
+ * supersedes the previous record of the same EUI-64, and deleting a supplicant
+ * appends a tombstone. Each record carries a CRC, so a record torn by a crash
+ * marks the end of the log and is overwritten by the next append. When the
+ * file is full and less than half of the records are live, the live records
+ * are copied to a temporary file which is then renamed over the store.
+ *
+ * The main loop never touches the file: writes and deletes are put in a dirty
+ * set keyed by EUI-64, so a supplicant updated several times is written once.
+ * A writer thread appends the dirty set to the file every
+ * KEY_STORAGE_FLUSH_INTERVAL seconds and syncs it. Reads look in the dirty
+ * set first. The lock protects the dirty set, the mapping and the index. Only
+ * the writer thread modifies them, so it reads them unlocked, does the file
+ * I/O unlocked, and only takes the lock to publish its changes. A record
+ * stays in the dirty set until it is indexed.
+ */
+#define KEY_STORAGE_FILENAME    "keys.bin"
+#define KEY_STORAGE_MAGIC       0x5359454b // "KEYS"
+#define KEY_STORAGE_VERSION     1
+#define KEY_STORAGE_MIN_RECORDS 256
+#define KEY_STORAGE_HASH_SIZE   1024
+#define KEY_STORAGE_FLUSH_INTERVAL 1 // seconds
+
+#define KEY_STORAGE_PMK_SET        0x01
+#define KEY_STORAGE_PMK_REPLAY_SET 0x02
+#define KEY_STORAGE_PTK_SET        0x04
+#define KEY_STORAGE_DELETED        0x80
+
+struct key_storage_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint8_t  reserved[56];
+};
+
+struct key_storage_record {
+    uint32_t crc;                                  // CRC-32 of the rest of the record
+    uint8_t  eui64[8];
+    uint8_t  flags;
+    uint8_t  node_role;
+    uint8_t  ins_gtk_hash_set;
+    uint8_t  ins_lgtk_hash_set;
+    uint64_t pmk_lifetime;                         // Absolute, in ws_pae_current_time_get() unit
+    uint64_t ptk_lifetime;
+    uint64_t pmk_key_replay_cnt;
+    uint8_t  pmk[PMK_LEN];
+    uint8_t  ptk[PTK_LEN];
+    sec_prot_gtk_hash_t ins_gtk_hash[GTK_NUM];
+    sec_prot_gtk_hash_t ins_lgtk_hash[LGTK_NUM];
+    uint8_t  reserved[2];
+};
+
+struct key_storage_dirty {
+    struct key_storage_record rec;
+    struct key_storage_dirty *next;
+};
+
+static struct {
+    bool opened;
+    bool running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct key_storage_dirty *dirty[KEY_STORAGE_HASH_SIZE];
+    uint32_t dirty_count;
+    uint32_t flush_req;                            // Incremented by ws_pae_key_storage_flush()
+    uint32_t flush_done;                           // Last request served by the writer thread
+    int fd;
+    struct key_storage_header *hdr;
+    struct key_storage_record *rec;                // Records follow the header
+    uint32_t capacity;                             // Number of records the file can hold
+    uint32_t tail;                                 // Next record to append
+    uint32_t live;                                 // Number of records in the index
+    int32_t bucket[KEY_STORAGE_HASH_SIZE];
+    int32_t *next;                                 // Hash chain, one entry per record
+} key_storage = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .fd = -1,
+};
+
 static const struct name_value nr_values[] = {
     { "br",        WS_NR_ROLE_BR      }, // should not happen
     { "lfn",       WS_NR_ROLE_LFN     },
@@ -47,86 +140,352 @@ static const struct name_value nr_values[] = {
     { NULL, 0 }
 };
 
-bool ws_pae_key_storage_supp_delete(const void *instance, const uint8_t *eui64)
+static uint32_t key_storage_record_crc(const struct key_storage_record *rec)
 {
-    char filename[256];
-    char str_buf[24];
-    int ret;
+    return block_crc32(0, (uint8_t *)rec + sizeof(rec->crc), sizeof(*rec) - sizeof(rec->crc));
+}
 
-    if (!g_storage_prefix)
-        return true;
-    str_key(eui64, 8, str_buf, sizeof(str_buf));
-    snprintf(filename, sizeof(filename), "%skeys-%s", g_storage_prefix, str_buf);
-    ret = unlink(filename);
+static size_t key_storage_size(uint32_t capacity)
+{
+    return sizeof(struct key_storage_header) + (size_t)capacity * sizeof(struct key_storage_record);
+}
 
-    return !ret;
+static int key_storage_hash(const uint8_t eui64[8])
+{
+    return fnv_hash_1a_32_reverse_block(eui64, 8) % KEY_STORAGE_HASH_SIZE;
 }
 
-int8_t ws_pae_key_storage_supp_write(const void *instance, supp_entry_t *pae_supp)
+static int32_t *key_storage_bucket(const uint8_t eui64[8])
 {
-    uint64_t current_time = ws_pae_current_time_get();
-    struct storage_parse_info *info;
-    char str_buf[256];
-    int i;
+    return &key_storage.bucket[key_storage_hash(eui64)];
+}
 
-    WARN_ON(!pae_supp->sec_keys.ptk_eui_64_set);
-    strcpy(str_buf, "keys-");
-    str_key(pae_supp->addr.eui_64, 8, str_buf + strlen(str_buf), sizeof(str_buf) - strlen(str_buf));
-    info = storage_open_prefix(str_buf, "w");
-    if (!info)
+static int32_t *key_storage_find(const uint8_t eui64[8])
+{
+    int32_t *link;
+
+    for (link = key_storage_bucket(eui64); *link >= 0; link = &key_storage.next[*link])
+        if (!memcmp(key_storage.rec[*link].eui64, eui64, 8))
+            return link;
+    return NULL;
+}
+
+static void key_storage_index(uint32_t slot)
+{
+    const struct key_storage_record *rec = &key_storage.rec[slot];
+    int32_t *link = key_storage_find(rec->eui64);
+
+    if (link) {
+        *link = key_storage.next[*link];
+        key_storage.live--;
+    }
+    if (rec->flags & KEY_STORAGE_DELETED)
+        return;
+    link = key_storage_bucket(rec->eui64);
+    key_storage.next[slot] = *link;
+    *link = slot;
+    key_storage.live++;
+}
+
+static void key_storage_index_rebuild(void)
+{
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++)
+        key_storage.bucket[i] = -1;
+    key_storage.live = 0;
+    for (key_storage.tail = 0; key_storage.tail < key_storage.capacity; key_storage.tail++) {
+        if (key_storage.rec[key_storage.tail].crc != key_storage_record_crc(&key_storage.rec[key_storage.tail]))
+            break;
+        key_storage_index(key_storage.tail);
+    }
+}
+
+/*
+ * A crash may tear a record in the middle of a batch while the next records of
+ * the batch made it to the disk. The replay stops at the torn record and the
+ * next appends overwrite it, so the stale records after it would be replayed
+ * on top of the new ones on the next start. They are cleared before anything
+ * is appended.
+ */
+static void key_storage_tail_clear(void)
+{
+    static const struct key_storage_record zero = { };
+    uint32_t end = key_storage.capacity;
+
+    // Slots never written are already zero, do not rewrite the whole file
+    while (end > key_storage.tail && !memcmp(&key_storage.rec[end - 1], &zero, sizeof(zero)))
+        end--;
+    if (end == key_storage.tail)
+        return;
+    WARN("%s: %"PRIu32" records after a torn record discarded", KEY_STORAGE_FILENAME, end - key_storage.tail);
+    memset(&key_storage.rec[key_storage.tail], 0, (size_t)(end - key_storage.tail) * sizeof(struct key_storage_record));
+    if (msync(key_storage.hdr, key_storage_size(end), MS_SYNC) < 0)
+        WARN("%s: msync: %m", KEY_STORAGE_FILENAME);
+}
+
+// The file is extended to hold capacity records
+static void *key_storage_mmap(int fd, uint32_t capacity)
+{
+    void *map;
+
+    if (ftruncate(fd, key_storage_size(capacity)) < 0) {
+        WARN("%s: ftruncate: %m", KEY_STORAGE_FILENAME);
+        return NULL;
+    }
+    map = mmap(NULL, key_storage_size(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        WARN("%s: mmap: %m", KEY_STORAGE_FILENAME);
+        return NULL;
+    }
+    return map;
+}
+
+// Publish a new mapping and its hash chains, and the buckets if not NULL. The
+// previous mapping is released once no reader can access it anymore.
+static void key_storage_swap(int fd, void *map, uint32_t capacity, int32_t *next, const int32_t *bucket)
+{
+    struct key_storage_header *old_hdr = key_storage.hdr;
+    size_t old_size = key_storage_size(key_storage.capacity);
+    int32_t *old_next = key_storage.next;
+    int old_fd = key_storage.fd;
+
+    pthread_mutex_lock(&key_storage.lock);
+    key_storage.fd = fd;
+    key_storage.hdr = map;
+    key_storage.rec = (struct key_storage_record *)(key_storage.hdr + 1);
+    key_storage.capacity = capacity;
+    key_storage.next = next;
+    if (bucket)
+        memcpy(key_storage.bucket, bucket, sizeof(key_storage.bucket));
+    pthread_mutex_unlock(&key_storage.lock);
+    if (old_hdr)
+        munmap(old_hdr, old_size);
+    if (old_fd >= 0 && old_fd != fd)
+        close(old_fd);
+    free(old_next);
+}
+
+static int key_storage_map(int fd, uint32_t capacity)
+{
+    int32_t *next;
+    void *map;
+
+    map = key_storage_mmap(fd, capacity);
+    if (!map)
+        return -1;
+    next = reallocarray(NULL, capacity, sizeof(*next));
+    FATAL_ON(!next, 2, "%s: %m", __func__);
+    if (key_storage.next && fd == key_storage.fd)
+        memcpy(next, key_storage.next, key_storage.capacity * sizeof(*next));
+    key_storage_swap(fd, map, capacity, next, NULL);
+    return 0;
+}
+
+static int key_storage_compact(uint32_t capacity)
+{
+    struct key_storage_header hdr = *key_storage.hdr;
+    char filename[PATH_MAX], tmpname[PATH_MAX];
+    int32_t bucket[KEY_STORAGE_HASH_SIZE];
+    uint32_t live = 0;
+    int32_t *next;
+    int fd, dirfd, h;
+    void *map;
+
+    snprintf(filename, sizeof(filename), "%s%s", g_storage_prefix, KEY_STORAGE_FILENAME);
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+    fd = open(tmpname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        WARN("open %s: %m", tmpname);
         return -1;
-    if (pae_supp->sec_keys.pmk_set) {
-        str_key(pae_supp->sec_keys.pmk, sizeof(pae_supp->sec_keys.pmk), str_buf, sizeof(str_buf));
-        fprintf(info->file, "pmk = %s\n", str_buf);
-        fprintf(info->file, "pmk.lifetime = %" PRIu64 "\n", current_time + pae_supp->sec_keys.pmk_lifetime);
     }
-    if (pae_supp->sec_keys.pmk_key_replay_cnt_set)
-        fprintf(info->file, "pmk.replay_counter = %" PRIu64 "\n", pae_supp->sec_keys.pmk_key_replay_cnt);
-    if (pae_supp->sec_keys.ptk_set) {
-        str_key(pae_supp->sec_keys.ptk, sizeof(pae_supp->sec_keys.ptk), str_buf, sizeof(str_buf));
-        fprintf(info->file, "ptk = %s\n", str_buf);
-        fprintf(info->file, "ptk.lifetime = %" PRIu64 "\n", current_time + pae_supp->sec_keys.ptk_lifetime);
-    }
-    for (i = 0; i < GTK_NUM; i++) {
-        if (pae_supp->sec_keys.gtks.ins_gtk_hash_set & (1 << i)) {
-            str_key(pae_supp->sec_keys.gtks.ins_gtk_hash[i].hash,
-                      sizeof(pae_supp->sec_keys.gtks.ins_gtk_hash[i].hash),
-                      str_buf, sizeof(str_buf));
-            fprintf(info->file, "gtk[%d].installed_hash = %s\n", i, str_buf);
+    next = reallocarray(NULL, capacity, sizeof(*next));
+    FATAL_ON(!next, 2, "%s: %m", __func__);
+    // The index of the compacted file is built along, records keep their order
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++)
+        bucket[i] = -1;
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+        goto error;
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++) {
+        for (int32_t slot = key_storage.bucket[i]; slot >= 0; slot = key_storage.next[slot]) {
+            if (write(fd, &key_storage.rec[slot], sizeof(struct key_storage_record)) != sizeof(struct key_storage_record))
+                goto error;
+            h = key_storage_hash(key_storage.rec[slot].eui64);
+            next[live] = bucket[h];
+            bucket[h] = live++;
         }
     }
-    for (i = 0; i < LGTK_NUM; i++) {
-        if (pae_supp->sec_keys.lgtks.ins_gtk_hash_set & (1 << i)) {
-            str_key(pae_supp->sec_keys.lgtks.ins_gtk_hash[i].hash,
-                      sizeof(pae_supp->sec_keys.lgtks.ins_gtk_hash[i].hash),
-                      str_buf, sizeof(str_buf));
-            fprintf(info->file, "lgtk[%d].installed_hash = %s\n", i, str_buf);
-        }
+    if (ftruncate(fd, key_storage_size(capacity)) < 0 || fsync(fd) < 0)
+        goto error;
+    if (rename(tmpname, filename) < 0)
+        goto error;
+    dirfd = open(dirname(strdupa(filename)), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd >= 0) {
+        fsync(dirfd);
+        close(dirfd);
     }
-    fprintf(info->file, "node_role = %s\n", val_to_str(pae_supp->sec_keys.node_role, nr_values, "unknown"));
-    storage_close(info);
+    map = key_storage_mmap(fd, capacity);
+    if (!map)
+        FATAL(1, "%s: cannot map compacted file", KEY_STORAGE_FILENAME);
+    key_storage_swap(fd, map, capacity, next, bucket);
+    key_storage.tail = live;
+    key_storage.live = live;
+    INFO("compacted %s%s to %"PRIu32" records", g_storage_prefix, KEY_STORAGE_FILENAME, key_storage.live);
     return 0;
+
+error:
+    WARN("%s: %m", tmpname);
+    free(next);
+    close(fd);
+    unlink(tmpname);
+    return -1;
 }
 
-supp_entry_t *ws_pae_key_storage_supp_read(const void *instance, const uint8_t *eui_64, sec_prot_gtk_keys_t *gtks, sec_prot_gtk_keys_t *lgtks, const sec_prot_certs_t *certs)
+static int key_storage_append(struct key_storage_record *rec)
+{
+    if (key_storage.tail == key_storage.capacity) {
+        if (key_storage.live < key_storage.capacity / 2)
+            key_storage_compact(key_storage.capacity);
+        if (key_storage.tail == key_storage.capacity &&
+            key_storage_map(key_storage.fd, key_storage.capacity * 2) < 0)
+            return -1;
+    }
+    rec->crc = key_storage_record_crc(rec);
+    // Readers do not access the slot until it is indexed
+    memcpy(&key_storage.rec[key_storage.tail], rec, sizeof(*rec));
+    pthread_mutex_lock(&key_storage.lock);
+    key_storage_index(key_storage.tail);
+    pthread_mutex_unlock(&key_storage.lock);
+    key_storage.tail++;
+    return 0;
+}
+
+static struct key_storage_dirty **key_storage_dirty_find(const uint8_t eui64[8])
+{
+    struct key_storage_dirty **link;
+
+    link = &key_storage.dirty[key_storage_hash(eui64)];
+    for (; *link; link = &(*link)->next)
+        if (!memcmp((*link)->rec.eui64, eui64, 8))
+            break;
+    return link;
+}
+
+static void key_storage_dirty_set(const struct key_storage_record *rec)
+{
+    struct key_storage_dirty *entry = malloc(sizeof(struct key_storage_dirty));
+    struct key_storage_dirty **link;
+
+    FATAL_ON(!entry, 2, "%s: %m", __func__);
+    pthread_mutex_lock(&key_storage.lock);
+    link = key_storage_dirty_find(rec->eui64);
+    if (!*link) {
+        *link = entry;
+        (*link)->next = NULL;
+        key_storage.dirty_count++;
+        entry = NULL;
+    }
+    memcpy(&(*link)->rec, rec, sizeof(*rec));
+    pthread_mutex_unlock(&key_storage.lock);
+    free(entry);
+}
+
+// Must be called with the lock held
+static uint32_t key_storage_dirty_snapshot(struct key_storage_record *rec, uint32_t len)
+{
+    uint32_t ret = 0;
+
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE && ret < len; i++)
+        for (struct key_storage_dirty *dirty = key_storage.dirty[i]; dirty && ret < len; dirty = dirty->next)
+            rec[ret++] = dirty->rec;
+    return ret;
+}
+
+// Must be called with the lock held. The entry is kept if it was modified
+// since the snapshot.
+static void key_storage_dirty_clear(const struct key_storage_record *rec)
+{
+    struct key_storage_dirty **link = key_storage_dirty_find(rec->eui64);
+    struct key_storage_dirty *dirty = *link;
+
+    if (!dirty || memcmp((uint8_t *)&dirty->rec + sizeof(rec->crc), (uint8_t *)rec + sizeof(rec->crc),
+                         sizeof(*rec) - sizeof(rec->crc)))
+        return;
+    *link = dirty->next;
+    key_storage.dirty_count--;
+    free(dirty);
+}
+
+// Must be called with the lock held
+static const struct key_storage_record *key_storage_lookup(const uint8_t eui64[8])
+{
+    struct key_storage_dirty *dirty = *key_storage_dirty_find(eui64);
+    int32_t *link;
+
+    if (dirty)
+        return dirty->rec.flags & KEY_STORAGE_DELETED ? NULL : &dirty->rec;
+    link = key_storage_find(eui64);
+    return link ? &key_storage.rec[*link] : NULL;
+}
+
+static void *key_storage_thread(void *arg)
+{
+    struct key_storage_record *snapshot = NULL;
+    struct timespec deadline;
+    uint32_t flush_req, len;
+
+    pthread_mutex_lock(&key_storage.lock);
+    for (;;) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += KEY_STORAGE_FLUSH_INTERVAL;
+        while (key_storage.flush_req == key_storage.flush_done &&
+               pthread_cond_timedwait(&key_storage.cond, &key_storage.lock, &deadline) != ETIMEDOUT)
+            ;
+        flush_req = key_storage.flush_req;
+        len = key_storage.dirty_count;
+        pthread_mutex_unlock(&key_storage.lock);
+        if (len) {
+            // Entries may be added meanwhile, they are served by the next round
+            snapshot = reallocarray(snapshot, len, sizeof(*snapshot));
+            FATAL_ON(!snapshot, 2, "%s: %m", __func__);
+            pthread_mutex_lock(&key_storage.lock);
+            len = key_storage_dirty_snapshot(snapshot, len);
+            pthread_mutex_unlock(&key_storage.lock);
+            for (uint32_t i = 0; i < len; i++)
+                key_storage_append(&snapshot[i]);
+            if (msync(key_storage.hdr, key_storage_size(key_storage.capacity), MS_SYNC) < 0)
+                WARN("%s: msync: %m", KEY_STORAGE_FILENAME);
+        }
+        pthread_mutex_lock(&key_storage.lock);
+        for (uint32_t i = 0; i < len; i++)
+            key_storage_dirty_clear(&snapshot[i]);
+        key_storage.flush_done = flush_req;
+        pthread_cond_broadcast(&key_storage.cond);
+    }
+    return NULL;
+}
+
+static void key_storage_thread_start(void)
+{
+    pthread_condattr_t attr;
+    sigset_t set, oldset;
+    int ret;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&key_storage.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    // Signals must be handled by the main thread, which flushes before exiting
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &oldset);
+    ret = pthread_create(&key_storage.thread, NULL, key_storage_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    FATAL_ON(ret, 2, "pthread_create: %s", strerror(ret));
+    key_storage.running = true;
+}
+
+static void key_storage_text_parse(struct storage_parse_info *info, struct key_storage_record *rec)
 {
-    supp_entry_t *pae_supp = malloc(sizeof(supp_entry_t));
-    uint64_t current_time = ws_pae_current_time_get();
-    struct storage_parse_info *info;
-    char str_buf[256];
     int ret;
 
-    ws_pae_lib_supp_init(pae_supp);
-    sec_prot_keys_init(&pae_supp->sec_keys, gtks, lgtks, certs);
-    kmp_address_init(KMP_ADDR_EUI_64_AND_IP, &pae_supp->addr, eui_64);
-    strcpy(str_buf, "keys-");
-    str_key(eui_64, 8, str_buf + strlen(str_buf), sizeof(str_buf) - strlen(str_buf));
-    info = storage_open_prefix(str_buf, "r");
-    if (!info)
-        return pae_supp;
-    // FIXME: the caller already knows the value of eui64
-    memcpy(pae_supp->sec_keys.ptk_eui_64, eui_64, 8);
-    pae_supp->sec_keys.ptk_eui_64_set = true;
     for (;;) {
         ret = storage_parse_line(info);
         if (ret == EOF)
@@ -134,45 +493,269 @@ supp_entry_t *ws_pae_key_storage_supp_read(const void *instance, const uint8_t *
         if (ret) {
             WARN("%s:%d: invalid line: '%s'", info->filename, info->linenr, info->line);
         } else if (!fnmatch("pmk", info->key, 0)) {
-            if (parse_byte_array(pae_supp->sec_keys.pmk, PMK_LEN, info->value))
+            if (parse_byte_array(rec->pmk, PMK_LEN, info->value))
                 WARN("%s:%d: invalid value: %s", info->filename, info->linenr, info->value);
             else
-                pae_supp->sec_keys.pmk_set = true;
+                rec->flags |= KEY_STORAGE_PMK_SET;
         } else if (!fnmatch("pmk.lifetime", info->key, 0)) {
-            if (current_time < strtoull(info->value, NULL, 0))
-                pae_supp->sec_keys.pmk_lifetime = strtoull(info->value, NULL, 0) - current_time;
-            else
-                WARN("%s:%d: expired PMK lifetime: %s", info->filename, info->linenr, info->value);
+            rec->pmk_lifetime = strtoull(info->value, NULL, 0);
         } else if (!fnmatch("pmk.replay_counter", info->key, 0)) {
-            pae_supp->sec_keys.pmk_key_replay_cnt = strtoull(info->value, NULL, 0);
-            pae_supp->sec_keys.pmk_key_replay_cnt_set = true;
+            rec->pmk_key_replay_cnt = strtoull(info->value, NULL, 0);
+            rec->flags |= KEY_STORAGE_PMK_REPLAY_SET;
         } else if (!fnmatch("ptk", info->key, 0)) {
-            if (parse_byte_array(pae_supp->sec_keys.ptk, PTK_LEN, info->value))
+            if (parse_byte_array(rec->ptk, PTK_LEN, info->value))
                 WARN("%s:%d: invalid value: %s", info->filename, info->linenr, info->value);
             else
-                pae_supp->sec_keys.ptk_set = true;
+                rec->flags |= KEY_STORAGE_PTK_SET;
         } else if (!fnmatch("ptk.lifetime", info->key, 0)) {
-            if (current_time < strtoull(info->value, NULL, 0))
-                pae_supp->sec_keys.ptk_lifetime = strtoull(info->value, NULL, 0) - current_time;
-            else
-                WARN("%s:%d: expired PTK lifetime: %s", info->filename, info->linenr, info->value);
-        } else if (!fnmatch("gtk\\[*].installed_hash", info->key, 0) && info->key_array_index < 4) {
-            if (parse_byte_array(pae_supp->sec_keys.gtks.ins_gtk_hash[info->key_array_index].hash, INS_GTK_HASH_LEN, info->value))
+            rec->ptk_lifetime = strtoull(info->value, NULL, 0);
+        } else if (!fnmatch("gtk\\[*].installed_hash", info->key, 0) && info->key_array_index < GTK_NUM) {
+            if (parse_byte_array(rec->ins_gtk_hash[info->key_array_index].hash, INS_GTK_HASH_LEN, info->value))
                 WARN("%s:%d: invalid value: %s", info->filename, info->linenr, info->value);
             else
-                pae_supp->sec_keys.gtks.ins_gtk_hash_set |= 1 << strtoull(info->value, NULL, 0);
-        } else if (!fnmatch("lgtk\\[*].installed_hash", info->key, 0) && info->key_array_index < 3) {
-            if (parse_byte_array(pae_supp->sec_keys.lgtks.ins_gtk_hash[info->key_array_index].hash, INS_GTK_HASH_LEN, info->value))
+                rec->ins_gtk_hash_set |= 1 << info->key_array_index;
+        } else if (!fnmatch("lgtk\\[*].installed_hash", info->key, 0) && info->key_array_index < LGTK_NUM) {
+            if (parse_byte_array(rec->ins_lgtk_hash[info->key_array_index].hash, INS_GTK_HASH_LEN, info->value))
                 WARN("%s:%d: invalid value: %s", info->filename, info->linenr, info->value);
             else
-                pae_supp->sec_keys.lgtks.ins_gtk_hash_set |= 1 << strtoull(info->value, NULL, 0);
+                rec->ins_lgtk_hash_set |= 1 << info->key_array_index;
         } else if (!fnmatch("node_role", info->key, 0)) {
-            pae_supp->sec_keys.node_role = str_to_val(info->value, nr_values);
+            rec->node_role = str_to_val(info->value, nr_values);
         } else {
             WARN("%s:%d: invalid key: '%s'", info->filename, info->linenr, info->line);
         }
     }
-    storage_close(info);
+}
+
+// Import the keys-<eui64> text files used by previous versions
+static void key_storage_text_import(void)
+{
+    struct storage_parse_info *info;
+    struct key_storage_record rec;
+    char pattern[PATH_MAX];
+    glob_t globbuf;
+    int ret, i;
+
+    snprintf(pattern, sizeof(pattern), "%skeys-*:*:*:*:*:*:*:*", g_storage_prefix);
+    ret = glob(pattern, 0, NULL, &globbuf);
+    if (ret) {
+        WARN_ON(ret != GLOB_NOMATCH, "glob %s returned an error", pattern);
+        return;
+    }
+    for (i = 0; globbuf.gl_pathv[i]; i++) {
+        memset(&rec, 0, sizeof(rec));
+        if (parse_byte_array(rec.eui64, 8, strrchr(globbuf.gl_pathv[i], '-') + 1))
+            continue;
+        info = storage_open(globbuf.gl_pathv[i], "r");
+        if (!info)
+            continue;
+        key_storage_text_parse(info, &rec);
+        storage_close(info);
+        if (key_storage_append(&rec) < 0)
+            break;
+        unlink(globbuf.gl_pathv[i]);
+    }
+    INFO("imported %d supplicant key files to %s%s", i, g_storage_prefix, KEY_STORAGE_FILENAME);
+    globfree(&globbuf);
+}
+
+static bool key_storage_open(void)
+{
+    char filename[PATH_MAX];
+    struct stat st;
+    uint32_t capacity;
+    int fd;
+
+    if (key_storage.opened)
+        return key_storage.running;
+    key_storage.opened = true;
+    if (!g_storage_prefix)
+        return false;
+    snprintf(filename, sizeof(filename), "%s%s", g_storage_prefix, KEY_STORAGE_FILENAME);
+    fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        WARN("open %s: %m", filename);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    capacity = st.st_size > sizeof(struct key_storage_header) ?
+               (st.st_size - sizeof(struct key_storage_header)) / sizeof(struct key_storage_record) : 0;
+    if (key_storage_map(fd, MAX(capacity, KEY_STORAGE_MIN_RECORDS)) < 0) {
+        close(fd);
+        return false;
+    }
+    if (key_storage.hdr->magic != KEY_STORAGE_MAGIC ||
+        key_storage.hdr->version != KEY_STORAGE_VERSION ||
+        key_storage.hdr->record_size != sizeof(struct key_storage_record)) {
+        WARN_ON(st.st_size, "%s: unsupported format, discarded", filename);
+        memset(key_storage.hdr, 0, key_storage_size(key_storage.capacity));
+        key_storage.hdr->magic = KEY_STORAGE_MAGIC;
+        key_storage.hdr->version = KEY_STORAGE_VERSION;
+        key_storage.hdr->record_size = sizeof(struct key_storage_record);
+    }
+    key_storage_index_rebuild();
+    key_storage_tail_clear();
+    key_storage_text_import();
+    key_storage_thread_start();
+    return true;
+}
+
+int ws_pae_key_storage_preload(void)
+{
+    uint64_t current_time = ws_pae_current_time_get();
+    const struct key_storage_record *rec;
+    int count = 0, pmk_count = 0;
+
+    if (!key_storage_open())
+        return 0;
+    // Walking the index faults in every live record, so the first
+    // authentications after a restart do not wait for the disk.
+    pthread_mutex_lock(&key_storage.lock);
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++) {
+        for (int32_t slot = key_storage.bucket[i]; slot >= 0; slot = key_storage.next[slot]) {
+            rec = key_storage_lookup(key_storage.rec[slot].eui64);
+            if (!rec)
+                continue;
+            count++;
+            if ((rec->flags & KEY_STORAGE_PMK_SET) && current_time < rec->pmk_lifetime)
+                pmk_count++;
+        }
+    }
+    // Entries not flushed to the file yet
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++) {
+        for (struct key_storage_dirty *dirty = key_storage.dirty[i]; dirty; dirty = dirty->next) {
+            if ((dirty->rec.flags & KEY_STORAGE_DELETED) || key_storage_find(dirty->rec.eui64))
+                continue;
+            count++;
+            if ((dirty->rec.flags & KEY_STORAGE_PMK_SET) && current_time < dirty->rec.pmk_lifetime)
+                pmk_count++;
+        }
+    }
+    INFO("%s%s: %d supplicants, %d with a valid PMK",
+         g_storage_prefix, KEY_STORAGE_FILENAME, count, pmk_count);
+    pthread_mutex_unlock(&key_storage.lock);
+    return pmk_count;
+}
+
+void ws_pae_key_storage_flush(void)
+{
+    uint32_t flush_req;
+
+    if (!key_storage.running)
+        return;
+    pthread_mutex_lock(&key_storage.lock);
+    flush_req = ++key_storage.flush_req;
+    pthread_cond_broadcast(&key_storage.cond);
+    while ((int32_t)(key_storage.flush_done - flush_req) < 0)
+        pthread_cond_wait(&key_storage.cond, &key_storage.lock);
+    pthread_mutex_unlock(&key_storage.lock);
+}
+
+bool ws_pae_key_storage_supp_delete(const void *instance, const uint8_t *eui64)
+{
+    struct key_storage_record rec = { };
+    bool found;
+
+    if (!key_storage_open())
+        return false;
+    pthread_mutex_lock(&key_storage.lock);
+    found = key_storage_lookup(eui64);
+    pthread_mutex_unlock(&key_storage.lock);
+    if (!found)
+        return false;
+    memcpy(rec.eui64, eui64, 8);
+    rec.flags = KEY_STORAGE_DELETED;
+    key_storage_dirty_set(&rec);
+    return true;
+}
+
+int8_t ws_pae_key_storage_supp_write(const void *instance, supp_entry_t *pae_supp)
+{
+    uint64_t current_time = ws_pae_current_time_get();
+    struct key_storage_record rec = { };
+    int i;
+
+    WARN_ON(!pae_supp->sec_keys.ptk_eui_64_set);
+    if (!key_storage_open())
+        return -1;
+    memcpy(rec.eui64, pae_supp->addr.eui_64, 8);
+    if (pae_supp->sec_keys.pmk_set) {
+        memcpy(rec.pmk, pae_supp->sec_keys.pmk, sizeof(rec.pmk));
+        rec.pmk_lifetime = current_time + pae_supp->sec_keys.pmk_lifetime;
+        rec.flags |= KEY_STORAGE_PMK_SET;
+    }
+    if (pae_supp->sec_keys.pmk_key_replay_cnt_set) {
+        rec.pmk_key_replay_cnt = pae_supp->sec_keys.pmk_key_replay_cnt;
+        rec.flags |= KEY_STORAGE_PMK_REPLAY_SET;
+    }
+    if (pae_supp->sec_keys.ptk_set) {
+        memcpy(rec.ptk, pae_supp->sec_keys.ptk, sizeof(rec.ptk));
+        rec.ptk_lifetime = current_time + pae_supp->sec_keys.ptk_lifetime;
+        rec.flags |= KEY_STORAGE_PTK_SET;
+    }
+    for (i = 0; i < GTK_NUM; i++)
+        rec.ins_gtk_hash[i] = pae_supp->sec_keys.gtks.ins_gtk_hash[i];
+    for (i = 0; i < LGTK_NUM; i++)
+        rec.ins_lgtk_hash[i] = pae_supp->sec_keys.lgtks.ins_gtk_hash[i];
+    rec.ins_gtk_hash_set = pae_supp->sec_keys.gtks.ins_gtk_hash_set;
+    rec.ins_lgtk_hash_set = pae_supp->sec_keys.lgtks.ins_gtk_hash_set & ((1 << LGTK_NUM) - 1);
+    rec.node_role = pae_supp->sec_keys.node_role;
+    key_storage_dirty_set(&rec);
+    return 0;
+}
+
+supp_entry_t *ws_pae_key_storage_supp_read(const void *instance, const uint8_t *eui_64, sec_prot_gtk_keys_t *gtks, sec_prot_gtk_keys_t *lgtks, const sec_prot_certs_t *certs)
+{
+    supp_entry_t *pae_supp = malloc(sizeof(supp_entry_t));
+    uint64_t current_time = ws_pae_current_time_get();
+    struct key_storage_record rec_buf;
+    const struct key_storage_record *rec;
+    int i;
+
+    ws_pae_lib_supp_init(pae_supp);
+    sec_prot_keys_init(&pae_supp->sec_keys, gtks, lgtks, certs);
+    kmp_address_init(KMP_ADDR_EUI_64_AND_IP, &pae_supp->addr, eui_64);
+    if (!key_storage_open())
+        return pae_supp;
+    pthread_mutex_lock(&key_storage.lock);
+    rec = key_storage_lookup(eui_64);
+    if (rec)
+        rec_buf = *rec;
+    pthread_mutex_unlock(&key_storage.lock);
+    if (!rec)
+        return pae_supp;
+    rec = &rec_buf;
+    // FIXME: the caller already knows the value of eui64
+    memcpy(pae_supp->sec_keys.ptk_eui_64, eui_64, 8);
+    pae_supp->sec_keys.ptk_eui_64_set = true;
+    if (rec->flags & KEY_STORAGE_PMK_SET) {
+        memcpy(pae_supp->sec_keys.pmk, rec->pmk, PMK_LEN);
+        pae_supp->sec_keys.pmk_set = true;
+        if (current_time < rec->pmk_lifetime)
+            pae_supp->sec_keys.pmk_lifetime = rec->pmk_lifetime - current_time;
+        else
+            WARN("%s: expired PMK lifetime: %"PRIu64, tr_eui64(eui_64), rec->pmk_lifetime);
+    }
+    if (rec->flags & KEY_STORAGE_PMK_REPLAY_SET) {
+        pae_supp->sec_keys.pmk_key_replay_cnt = rec->pmk_key_replay_cnt;
+        pae_supp->sec_keys.pmk_key_replay_cnt_set = true;
+    }
+    if (rec->flags & KEY_STORAGE_PTK_SET) {
+        memcpy(pae_supp->sec_keys.ptk, rec->ptk, PTK_LEN);
+        pae_supp->sec_keys.ptk_set = true;
+        if (current_time < rec->ptk_lifetime)
+            pae_supp->sec_keys.ptk_lifetime = rec->ptk_lifetime - current_time;
+        else
+            WARN("%s: expired PTK lifetime: %"PRIu64, tr_eui64(eui_64), rec->ptk_lifetime);
+    }
+    for (i = 0; i < GTK_NUM; i++)
+        pae_supp->sec_keys.gtks.ins_gtk_hash[i] = rec->ins_gtk_hash[i];
+    for (i = 0; i < LGTK_NUM; i++)
+        pae_supp->sec_keys.lgtks.ins_gtk_hash[i] = rec->ins_lgtk_hash[i];
+    pae_supp->sec_keys.gtks.ins_gtk_hash_set = rec->ins_gtk_hash_set;
+    pae_supp->sec_keys.lgtks.ins_gtk_hash_set = rec->ins_lgtk_hash_set;
+    pae_supp->sec_keys.node_role = rec->node_role;
     if (!pae_supp->sec_keys.pmk_lifetime)
         pae_supp->sec_keys.pmk_set = false;
     if (!pae_supp->sec_keys.ptk_lifetime)
@@ -184,36 +767,37 @@ supp_entry_t *ws_pae_key_storage_supp_read(const void *instance, const uint8_t *
 
 int ws_pae_key_storage_list(uint8_t eui64[][8], int len)
 {
-    char filename[PATH_MAX];
-    glob_t globbuf;
-    int i, ret;
+    int ret = 0;
 
     if (!g_storage_prefix) {
         WARN("storage disabled, cannot retrieve EUI64");
         return 0;
     }
-    snprintf(filename, sizeof(filename), "%skeys-*:*:*:*:*:*:*:*", g_storage_prefix);
-    ret = glob(filename, 0, NULL, &globbuf);
-    if (ret) {
-        WARN_ON(ret != GLOB_NOMATCH, "glob %s returned an error", filename);
+    if (!key_storage_open())
         return 0;
-    }
-    for (i = 0; globbuf.gl_pathv[i] && i < len; i++)
-        parse_byte_array(eui64[i], 8, strrchr(globbuf.gl_pathv[i], '-') + 1);
-    globfree(&globbuf);
-    return i;
+    pthread_mutex_lock(&key_storage.lock);
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++)
+        for (int32_t slot = key_storage.bucket[i]; slot >= 0 && ret < len; slot = key_storage.next[slot])
+            if (key_storage_lookup(key_storage.rec[slot].eui64))
+                memcpy(eui64[ret++], key_storage.rec[slot].eui64, 8);
+    for (int i = 0; i < KEY_STORAGE_HASH_SIZE; i++)
+        for (struct key_storage_dirty *dirty = key_storage.dirty[i]; dirty && ret < len; dirty = dirty->next)
+            if (!(dirty->rec.flags & KEY_STORAGE_DELETED) && !key_storage_find(dirty->rec.eui64))
+                memcpy(eui64[ret++], dirty->rec.eui64, 8);
+    pthread_mutex_unlock(&key_storage.lock);
+    return ret;
 }
 
 bool ws_pae_key_storage_supp_exists(const uint8_t eui64[8])
 {
-    char eui64_str[STR_MAX_LEN_EUI64];
-    char filename[PATH_MAX];
-    int ret;
+    bool ret;
 
-    str_eui64(eui64, eui64_str);
-    ret = snprintf(filename, sizeof(filename), "%skeys-%s", g_storage_prefix, eui64_str);
-    BUG_ON(ret >= sizeof(filename), "g_storage_prefix too big");
-    return !access(filename, F_OK);
+    if (!key_storage_open())
+        return false;
+    pthread_mutex_lock(&key_storage.lock);
+    ret = key_storage_lookup(eui64);
+    pthread_mutex_unlock(&key_storage.lock);
+    return ret;
 }
 
 uint16_t ws_pae_key_storage_storing_interval_get(void)
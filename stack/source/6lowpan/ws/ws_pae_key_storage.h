@@ -78,6 +78,26 @@ bool ws_pae_key_storage_supp_delete(const void *instance, const uint8_t *eui64);
  */
 uint16_t ws_pae_key_storage_storing_interval_get(void);
 
+/**
+ * ws_pae_key_storage_preload opens the key storage and loads its index
+ *
+ * Otherwise the storage is opened on first use. Preloading at startup lets
+ * supplicants which still hold a valid PMK go straight to the 4WH.
+ *
+ * \return number of stored supplicants with an unexpired PMK
+ *
+ */
+int ws_pae_key_storage_preload(void);
+
+/**
+ * ws_pae_key_storage_flush waits until pending supplicant entries are written
+ *
+ * Writes are otherwise done in the background every second. Also called by the
+ * main loop before exiting.
+ *
+ */
+void ws_pae_key_storage_flush(void);
+
 int ws_pae_key_storage_list(uint8_t eui64[][8], int len);
 bool ws_pae_key_storage_supp_exists(const uint8_t eui64[8]);
 
@@ -20,11 +20,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include "common/log.h"
 #include "common/log_legacy.h"
 #include "common/ns_list.h"
+#include "common/utils.h"
 #include "stack/mac/fhss_config.h"
 #include "stack/ws_management_api.h"
 #include "stack/timers.h"
+#include "service_libs/fnv_hash/fnv_hash.h"
 
 #include "nwk_interface/protocol.h"
 #include "security/kmp/kmp_addr.h"
@@ -41,6 +44,45 @@
 
 #define TRACE_GROUP "wspl"
 
+#define WS_PAE_LIB_SUPP_HASH_SIZE 1024
+#define WS_PAE_LIB_KMP_HASH_SIZE 256
+
+enum {
+    SUPP_TIMER_NONE,
+    SUPP_TIMER_SLOT,
+    SUPP_TIMER_RUNNING,
+    SUPP_TIMER_PENDING,
+};
+
+/*
+ * Supplicant entries on a list are also chained by EUI-64, and KMPs that
+ * reported the identifier they are waiting for (RADIUS identifier) are chained
+ * by that identifier. Entries are shared by all lists: lookups check the list
+ * the entry is on.
+ */
+static supp_entry_t *ws_pae_lib_supp_hash[WS_PAE_LIB_SUPP_HASH_SIZE];
+static kmp_entry_t *ws_pae_lib_kmp_hash[WS_PAE_LIB_KMP_HASH_SIZE];
+
+static void ws_pae_lib_supp_timer_cancel(supp_entry_t *entry);
+static bool ws_pae_lib_supp_timer_decrement(void *instance, supp_entry_t *entry, uint32_t ticks, bool keep_timer_running);
+
+static supp_entry_t **ws_pae_lib_supp_hash_bucket(const uint8_t *eui_64)
+{
+    return &ws_pae_lib_supp_hash[fnv_hash_1a_32_reverse_block(eui_64, 8) % WS_PAE_LIB_SUPP_HASH_SIZE];
+}
+
+static void ws_pae_lib_kmp_hash_remove(kmp_entry_t *entry)
+{
+    kmp_entry_t **link;
+
+    if (!entry->receive_id_hashed)
+        return;
+    for (link = &ws_pae_lib_kmp_hash[entry->receive_id]; *link != entry; link = &(*link)->receive_id_next)
+        ;
+    *link = entry->receive_id_next;
+    entry->receive_id_hashed = false;
+}
+
 void ws_pae_lib_kmp_list_init(kmp_list_t *kmp_list)
 {
     ns_list_init(kmp_list);
@@ -59,7 +101,11 @@ kmp_entry_t *ws_pae_lib_kmp_list_add(kmp_list_t *kmp_list, kmp_api_t *kmp)
         return NULL;
     }
     entry->kmp = kmp;
+    entry->supp = NULL;
+    entry->receive_id_next = NULL;
+    entry->receive_id = 0;
     entry->timer_running = false;
+    entry->receive_id_hashed = false;
 
     ns_list_add_to_end(kmp_list, entry);
 
@@ -71,6 +117,7 @@ int8_t ws_pae_lib_kmp_list_delete(kmp_list_t *kmp_list, kmp_api_t *kmp)
     kmp_entry_t *entry = ws_pae_lib_kmp_list_entry_get(kmp_list, kmp);
 
     if (entry) {
+        ws_pae_lib_kmp_hash_remove(entry);
         ns_list_remove(kmp_list, entry);
         kmp_api_delete(entry->kmp);
         free(entry);
@@ -113,6 +160,7 @@ kmp_api_t *ws_pae_lib_kmp_list_instance_id_get(kmp_list_t *kmp_list, uint8_t ins
 void ws_pae_lib_kmp_list_free(kmp_list_t *kmp_list)
 {
     ns_list_foreach_safe(kmp_entry_t, cur, kmp_list) {
+        ws_pae_lib_kmp_hash_remove(cur);
         kmp_api_delete(cur->kmp);
         free(cur);
     }
@@ -129,6 +177,16 @@ kmp_entry_t *ws_pae_lib_kmp_list_entry_get(kmp_list_t *kmp_list, kmp_api_t *kmp)
     return 0;
 }
 
+void ws_pae_lib_kmp_receive_id_set(supp_entry_t *supp, kmp_entry_t *entry, uint8_t id)
+{
+    ws_pae_lib_kmp_hash_remove(entry);
+    entry->supp = supp;
+    entry->receive_id = id;
+    entry->receive_id_next = ws_pae_lib_kmp_hash[id];
+    entry->receive_id_hashed = true;
+    ws_pae_lib_kmp_hash[id] = entry;
+}
+
 bool ws_pae_lib_kmp_list_empty(kmp_list_t *kmp_list)
 {
     return ns_list_is_empty(kmp_list);
@@ -195,14 +253,39 @@ supp_entry_t *ws_pae_lib_supp_list_add(supp_list_t *supp_list, const kmp_addr_t
     entry->addr.type = KMP_ADDR_EUI_64_AND_IP;
     kmp_address_copy(&entry->addr, addr);
 
-    ns_list_add_to_start(supp_list, entry);
+    ws_pae_lib_supp_list_insert(supp_list, entry);
 
     return entry;
 }
 
+void ws_pae_lib_supp_list_insert(supp_list_t *supp_list, supp_entry_t *entry)
+{
+    supp_entry_t **bucket = ws_pae_lib_supp_hash_bucket(entry->addr.eui_64);
+
+    BUG_ON(entry->list);
+    ns_list_add_to_start(supp_list, entry);
+    entry->list = supp_list;
+    entry->eui_64_next = *bucket;
+    *bucket = entry;
+}
+
+void ws_pae_lib_supp_list_detach(supp_list_t *supp_list, supp_entry_t *entry)
+{
+    supp_entry_t **link;
+
+    BUG_ON(entry->list != supp_list);
+    for (link = ws_pae_lib_supp_hash_bucket(entry->addr.eui_64); *link != entry; link = &(*link)->eui_64_next)
+        ;
+    *link = entry->eui_64_next;
+    ns_list_remove(supp_list, entry);
+    entry->list = NULL;
+    entry->eui_64_next = NULL;
+    ws_pae_lib_supp_timer_cancel(entry);
+}
+
 int8_t ws_pae_lib_supp_list_remove(void *instance, supp_list_t *supp_list, supp_entry_t *supp, ws_pae_lib_supp_deleted supp_deleted)
 {
-    ns_list_remove(supp_list, supp);
+    ws_pae_lib_supp_list_detach(supp_list, supp);
 
     ws_pae_lib_supp_delete(supp);
 
@@ -217,8 +300,8 @@ int8_t ws_pae_lib_supp_list_remove(void *instance, supp_list_t *supp_list, supp_
 
 supp_entry_t *ws_pae_lib_supp_list_entry_eui_64_get(const supp_list_t *supp_list, const uint8_t *eui_64)
 {
-    ns_list_foreach(supp_entry_t, cur, supp_list) {
-        if (memcmp(cur->addr.eui_64, eui_64, 8) == 0) {
+    for (supp_entry_t *cur = *ws_pae_lib_supp_hash_bucket(eui_64); cur; cur = cur->eui_64_next) {
+        if (cur->list == supp_list && memcmp(cur->addr.eui_64, eui_64, 8) == 0) {
             return cur;
         }
     }
@@ -233,20 +316,142 @@ void ws_pae_lib_supp_list_delete(supp_list_t *supp_list)
     }
 }
 
-bool ws_pae_lib_supp_list_timer_update(void *instance, supp_list_t *active_supp_list, uint16_t ticks, ws_pae_lib_kmp_timer_timeout timeout, ws_pae_lib_supp_deleted supp_deleted)
+static supp_timer_list_t *ws_pae_lib_supp_timer_list(supp_entry_t *entry)
 {
-    bool timer_running = false;
+    switch (entry->timer_state) {
+    case SUPP_TIMER_SLOT:
+        return &entry->timer_wheel->slot[entry->timer_deadline % SUPP_TIMER_WHEEL_SIZE];
+    case SUPP_TIMER_RUNNING:
+        return &entry->timer_wheel->running;
+    case SUPP_TIMER_PENDING:
+        return &entry->timer_wheel->pending;
+    default:
+        return NULL;
+    }
+}
 
-    ns_list_foreach_safe(supp_entry_t, entry, active_supp_list) {
-        bool running = ws_pae_lib_supp_timer_update(instance, entry, ticks, timeout);
-        if (running) {
-            timer_running = true;
-        } else {
-            ws_pae_lib_supp_list_to_inactive(instance, active_supp_list, entry, supp_deleted);
+static void ws_pae_lib_supp_timer_link(supp_entry_t *entry, uint8_t state)
+{
+    entry->timer_state = state;
+    ns_list_add_to_end(ws_pae_lib_supp_timer_list(entry), entry);
+    entry->timer_wheel->count++;
+}
+
+static void ws_pae_lib_supp_timer_unlink(supp_entry_t *entry)
+{
+    supp_timer_list_t *list = ws_pae_lib_supp_timer_list(entry);
+
+    if (!list)
+        return;
+    ns_list_remove(list, entry);
+    entry->timer_wheel->count--;
+    entry->timer_state = SUPP_TIMER_NONE;
+}
+
+// Entries in a slot have no KMP timer running, only their own timers need an update
+static void ws_pae_lib_supp_timer_sync(supp_entry_t *entry)
+{
+    uint32_t elapsed;
+
+    if (!entry->timer_wheel || entry->timer_state != SUPP_TIMER_SLOT)
+        return;
+    elapsed = entry->timer_wheel->now - entry->timer_sync;
+    entry->timer_sync = entry->timer_wheel->now;
+    if (elapsed)
+        ws_pae_lib_supp_timer_decrement(entry->timer_wheel->instance, entry, elapsed, false);
+}
+
+static void ws_pae_lib_supp_timer_cancel(supp_entry_t *entry)
+{
+    if (!entry->timer_wheel)
+        return;
+    ws_pae_lib_supp_timer_sync(entry);
+    ws_pae_lib_supp_timer_unlink(entry);
+    entry->timer_wheel = NULL;
+}
+
+void ws_pae_lib_supp_timer_wheel_init(supp_timer_wheel_t *wheel, void *instance)
+{
+    wheel->instance = instance;
+    wheel->now = 0;
+    wheel->count = 0;
+    ns_list_init(&wheel->running);
+    ns_list_init(&wheel->pending);
+    for (int i = 0; i < ARRAY_SIZE(wheel->slot); i++)
+        ns_list_init(&wheel->slot[i]);
+}
+
+void ws_pae_lib_supp_timer_schedule(supp_timer_wheel_t *wheel, supp_entry_t *entry)
+{
+    kmp_entry_t *kmp_entry = ns_list_get_first(&entry->kmp_list);
+    uint32_t delay;
+
+    if (entry->timer_wheel) {
+        BUG_ON(entry->timer_wheel != wheel);
+        ws_pae_lib_supp_timer_sync(entry);
+        ws_pae_lib_supp_timer_unlink(entry);
+    } else {
+        entry->timer_wheel = wheel;
+        entry->timer_sync = wheel->now;
+    }
+
+    // KMPs with a running timer are at the start of the list
+    if (kmp_entry && kmp_entry->timer_running) {
+        ws_pae_lib_supp_timer_link(entry, SUPP_TIMER_RUNNING);
+        return;
+    }
+
+    // Entry is due when the waiting timer expires (if running), then when
+    // the supplicant timer expires, or earlier to store the keys
+    delay = entry->waiting_ticks ? entry->waiting_ticks : entry->ticks;
+    if (wheel->instance)
+        delay = MIN(delay, entry->store_ticks);
+    entry->timer_deadline = entry->timer_sync + delay;
+    if (entry->timer_deadline <= wheel->now)
+        entry->timer_deadline = wheel->now + 1;
+    ws_pae_lib_supp_timer_link(entry, SUPP_TIMER_SLOT);
+}
+
+bool ws_pae_lib_supp_timer_wheel_update(supp_timer_wheel_t *wheel, uint16_t ticks, ws_pae_lib_kmp_timer_timeout timeout, ws_pae_lib_supp_expired expired)
+{
+    uint32_t start = wheel->now;
+    supp_timer_list_t *slot;
+    supp_entry_t *entry;
+    uint32_t elapsed;
+    bool running;
+
+    wheel->now += ticks;
+
+    // Callbacks may reschedule or delete any entry, so the due entries are
+    // first moved to the pending list and then updated one by one.
+    ns_list_foreach_safe(supp_entry_t, cur, &wheel->running) {
+        ws_pae_lib_supp_timer_unlink(cur);
+        ws_pae_lib_supp_timer_link(cur, SUPP_TIMER_PENDING);
+    }
+    for (int i = 1; i <= MIN(ticks, SUPP_TIMER_WHEEL_SIZE); i++) {
+        slot = &wheel->slot[(start + i) % SUPP_TIMER_WHEEL_SIZE];
+        ns_list_foreach_safe(supp_entry_t, cur, slot) {
+            if (cur->timer_deadline > wheel->now)
+                continue;
+            ws_pae_lib_supp_timer_unlink(cur);
+            ws_pae_lib_supp_timer_link(cur, SUPP_TIMER_PENDING);
         }
     }
 
-    return timer_running;
+    while ((entry = ns_list_get_first(&wheel->pending))) {
+        ws_pae_lib_supp_timer_unlink(entry);
+        elapsed = wheel->now - entry->timer_sync;
+        entry->timer_sync = wheel->now;
+        // Updates KMP timers and calls timeout callback
+        running = ws_pae_lib_kmp_timer_update(&entry->kmp_list, MIN(elapsed, (uint32_t)UINT16_MAX), timeout);
+        running = ws_pae_lib_supp_timer_decrement(wheel->instance, entry, elapsed, running);
+        if (running)
+            ws_pae_lib_supp_timer_schedule(wheel, entry);
+        else
+            expired(wheel->instance, entry);
+    }
+
+    return wheel->count;
 }
 
 void ws_pae_lib_supp_list_slow_timer_update(supp_list_t *supp_list, uint16_t seconds)
@@ -271,6 +476,13 @@ void ws_pae_lib_supp_init(supp_entry_t *entry)
     entry->store_ticks = ws_pae_key_storage_storing_interval_get() * 1000;
     entry->active = true;
     entry->access_revoked = false;
+    entry->eap_tls_started = false;
+    entry->list = NULL;
+    entry->eui_64_next = NULL;
+    entry->timer_wheel = NULL;
+    entry->timer_sync = 0;
+    entry->timer_deadline = 0;
+    entry->timer_state = SUPP_TIMER_NONE;
 }
 
 void ws_pae_lib_supp_delete(supp_entry_t *entry)
@@ -283,6 +495,11 @@ bool ws_pae_lib_supp_timer_update(void *instance, supp_entry_t *entry, uint16_t
     // Updates KMP timers and calls timeout callback
     bool keep_timer_running = ws_pae_lib_kmp_timer_update(&entry->kmp_list, ticks, timeout);
 
+    return ws_pae_lib_supp_timer_decrement(instance, entry, ticks, keep_timer_running);
+}
+
+static bool ws_pae_lib_supp_timer_decrement(void *instance, supp_entry_t *entry, uint32_t ticks, bool keep_timer_running)
+{
     // If KMPs are not active updates supplicant timer
     if (!keep_timer_running) {
         if (entry->ticks > ticks) {
@@ -322,12 +539,18 @@ bool ws_pae_lib_supp_timer_update(void *instance, supp_entry_t *entry, uint16_t
 
 void ws_pae_lib_supp_timer_ticks_set(supp_entry_t *entry, uint32_t ticks)
 {
+    ws_pae_lib_supp_timer_sync(entry);
     entry->ticks = ticks;
+    if (entry->timer_wheel)
+        ws_pae_lib_supp_timer_schedule(entry->timer_wheel, entry);
 }
 
 void ws_pae_lib_supp_timer_ticks_add(supp_entry_t *entry, uint32_t ticks)
 {
+    ws_pae_lib_supp_timer_sync(entry);
     entry->ticks += ticks;
+    if (entry->timer_wheel)
+        ws_pae_lib_supp_timer_schedule(entry->timer_wheel, entry);
 }
 
 bool ws_pae_lib_supp_timer_is_running(supp_entry_t *entry)
@@ -347,8 +570,8 @@ void ws_pae_lib_supp_list_to_active(supp_list_t *active_supp_list, supp_list_t *
 
     tr_debug("PAE: to active, eui-64: %s", tr_eui64(entry->addr.eui_64));
 
-    ns_list_remove(inactive_supp_list, entry);
-    ns_list_add_to_start(active_supp_list, entry);
+    ws_pae_lib_supp_list_detach(inactive_supp_list, entry);
+    ws_pae_lib_supp_list_insert(active_supp_list, entry);
 
     entry->active = true;
     entry->ticks = 0;
@@ -418,22 +641,21 @@ uint16_t ws_pae_lib_supp_list_kmp_count(supp_list_t *supp_list, kmp_type_e type)
 
 bool ws_pae_lib_supp_list_entry_is_in_list(supp_list_t *supp_list, supp_entry_t *searched_entry)
 {
-    ns_list_foreach(supp_entry_t, entry, supp_list) {
-        if (entry == searched_entry) {
-            return true;
-        }
-    }
-
-    return false;
+    return searched_entry->list == supp_list;
 }
 
 kmp_api_t *ws_pae_lib_supp_list_kmp_receive_check(supp_list_t *supp_list, const void *pdu, uint16_t size)
 {
-    ns_list_foreach(supp_entry_t, entry, supp_list) {
-        ns_list_foreach(kmp_entry_t, kmp_entry, &entry->kmp_list) {
-            if (kmp_api_receive_check(kmp_entry->kmp, pdu, size)) {
-                return kmp_entry->kmp;
-            }
+    const uint8_t *radius_msg = pdu;
+
+    // RADIUS identifier
+    if (size < 2) {
+        return NULL;
+    }
+
+    for (kmp_entry_t *entry = ws_pae_lib_kmp_hash[radius_msg[1]]; entry; entry = entry->receive_id_next) {
+        if (entry->supp->list == supp_list && kmp_api_receive_check(entry->kmp, pdu, size)) {
+            return entry->kmp;
         }
     }
 
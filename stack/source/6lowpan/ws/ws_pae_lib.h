@@ -30,7 +30,11 @@
 
 typedef struct kmp_entry {
     kmp_api_t *kmp;                    /**< KMP API */
+    struct supp_entry *supp;           /**< Supplicant the KMP belongs to, set when receive identifier is known */
+    struct kmp_entry *receive_id_next; /**< Next entry on the receive identifier hash chain */
+    uint8_t receive_id;                /**< Identifier of the messages the KMP waits for */
     bool timer_running;                /**< Timer running inside KMP */
+    bool receive_id_hashed;            /**< Entry is on the receive identifier hash chain */
     ns_list_link_t link;               /**< Link */
 } kmp_entry_t;
 
@@ -45,10 +49,38 @@ typedef struct supp_entry {
     uint16_t store_ticks;              /**< NVM store ticks */
     bool active : 1;                   /**< Is active */
     bool access_revoked : 1;           /**< Nodes access is revoked */
+    bool eap_tls_started : 1;          /**< EAP-TLS started, the next 4WH is not a PMK reuse */
+    const void *list;                  /**< Supplicant list the entry is on, NULL if none */
+    struct supp_entry *eui_64_next;    /**< Next entry on the EUI-64 hash chain */
     ns_list_link_t link;               /**< Link */
+    struct supp_timer_wheel *timer_wheel; /**< Timer wheel the entry is scheduled on, NULL if none */
+    uint32_t timer_sync;               /**< Wheel time up to which the timers have been updated */
+    uint32_t timer_deadline;           /**< Wheel time the entry is due */
+    uint8_t timer_state;               /**< Wheel list the entry is on */
+    ns_list_link_t timer_link;         /**< Link on the timer wheel */
 } supp_entry_t;
 
 typedef NS_LIST_HEAD(supp_entry_t, link) supp_list_t;
+typedef NS_LIST_HEAD(supp_entry_t, timer_link) supp_timer_list_t;
+
+// Slots of one tick, a round lasts 102.4 seconds
+#define SUPP_TIMER_WHEEL_SIZE 1024
+
+/*
+ * Supplicants of the authenticator are kept on a timer wheel. Entries with a
+ * KMP timer running are updated on every tick. Other entries only wait for
+ * their supplicant, waiting or storing timer to expire, and are put in the
+ * slot of the earliest of those deadlines. Their timers are brought up to
+ * date when they are due or when they are rescheduled.
+ */
+typedef struct supp_timer_wheel {
+    void *instance;                    /**< Instance given to the key storage */
+    uint32_t now;                      /**< Ticks elapsed */
+    uint32_t count;                    /**< Number of scheduled entries */
+    supp_timer_list_t running;         /**< Entries with a KMP timer running */
+    supp_timer_list_t pending;         /**< Entries being updated */
+    supp_timer_list_t slot[SUPP_TIMER_WHEEL_SIZE];
+} supp_timer_wheel_t;
 
 typedef struct shared_comp_entry {
     kmp_shared_comp_t *data;           /**< KMP shared component data */
@@ -136,6 +168,19 @@ kmp_api_t *ws_pae_lib_kmp_list_instance_id_get(kmp_list_t *kmp_list, uint8_t ins
  */
 kmp_entry_t *ws_pae_lib_kmp_list_entry_get(kmp_list_t *kmp_list, kmp_api_t *kmp);
 
+/**
+ * ws_pae_lib_kmp_receive_id_set sets the identifier of the messages the KMP waits for
+ *
+ * The entry is then found by ws_pae_lib_supp_list_kmp_receive_check() without
+ * walking the supplicant lists.
+ *
+ * \param supp supplicant entry
+ * \param entry KMP list entry of the supplicant
+ * \param id identifier
+ *
+ */
+void ws_pae_lib_kmp_receive_id_set(supp_entry_t *supp, kmp_entry_t *entry, uint8_t id);
+
 /**
  * ws_pae_lib_kmp_list_empty checks whether KMP list is empty
  *
@@ -216,6 +261,24 @@ void ws_pae_lib_supp_list_init(supp_list_t *supp_list);
  */
 supp_entry_t *ws_pae_lib_supp_list_add(supp_list_t *supp_list, const kmp_addr_t *addr);
 
+/**
+ *  ws_pae_lib_supp_list_insert inserts an allocated entry to the start of supplicant list
+ *
+ * \param supp_list supplicant list
+ * \param entry entry, must not be on any list
+ *
+ */
+void ws_pae_lib_supp_list_insert(supp_list_t *supp_list, supp_entry_t *entry);
+
+/**
+ *  ws_pae_lib_supp_list_detach removes entry from supplicant list without deleting it
+ *
+ * \param supp_list supplicant list
+ * \param entry entry
+ *
+ */
+void ws_pae_lib_supp_list_detach(supp_list_t *supp_list, supp_entry_t *entry);
+
 /**
  * ws_pae_lib_supp_deleted supplicant delete callback
  *
@@ -257,19 +320,48 @@ supp_entry_t *ws_pae_lib_supp_list_entry_eui_64_get(const supp_list_t *supp_list
 void ws_pae_lib_supp_list_delete(supp_list_t *supp_list);
 
 /**
- *  ws_pae_lib_supp_list_timer_update updates timers on supplicant list
+ * ws_pae_lib_supp_expired supplicant timers expired callback
  *
  * \param instance Instance
- * \param active_supp_list list of active supplicants
- * \param inactive_supp_list list of inactive supplicants
+ * \param entry entry
+ *
+ */
+typedef void ws_pae_lib_supp_expired(void *instance, supp_entry_t *entry);
+
+/**
+ *  ws_pae_lib_supp_timer_wheel_init initializes supplicant timer wheel
+ *
+ * \param wheel timer wheel
+ * \param instance Instance
+ *
+ */
+void ws_pae_lib_supp_timer_wheel_init(supp_timer_wheel_t *wheel, void *instance);
+
+/**
+ *  ws_pae_lib_supp_timer_wheel_update updates timers of the due supplicants
+ *
+ * \param wheel timer wheel
  * \param ticks timer ticks
- * \param timeout callback to call on timeout
- * \param supp_deleted callback to call on supplicant delete
+ * \param timeout callback to call on KMP timeout
+ * \param expired callback to call when supplicant timers have expired
  *
  * \return true timer needs still to be running
  * \return false timer can be stopped
  */
-bool ws_pae_lib_supp_list_timer_update(void *instance, supp_list_t *active_supp_list, uint16_t ticks, ws_pae_lib_kmp_timer_timeout timeout, ws_pae_lib_supp_deleted supp_deleted);
+bool ws_pae_lib_supp_timer_wheel_update(supp_timer_wheel_t *wheel, uint16_t ticks, ws_pae_lib_kmp_timer_timeout timeout, ws_pae_lib_supp_expired expired);
+
+/**
+ *  ws_pae_lib_supp_timer_schedule schedules supplicant on timer wheel
+ *
+ * Must be called when the entry is added to a supplicant list and when its
+ * KMP timers are started or stopped. Setting the supplicant or waiting ticks
+ * reschedules the entry.
+ *
+ * \param wheel timer wheel
+ * \param entry supplicant entry
+ *
+ */
+void ws_pae_lib_supp_timer_schedule(supp_timer_wheel_t *wheel, supp_entry_t *entry);
 
 /**
  *  ws_pae_lib_supp_list_slow_timer_update updates slow timer on supplicant list
@@ -395,6 +487,9 @@ bool ws_pae_lib_supp_list_entry_is_in_list(supp_list_t *supp_list, supp_entry_t
 /**
  *  ws_pae_lib_supp_list_kmp_receive_check check if received message is for this KMP in a list of supplicants
  *
+ * Only KMPs whose receive identifier has been set with ws_pae_lib_kmp_receive_id_set()
+ * are checked. The identifier is read from the RADIUS message.
+ *
  * \param supp_list list of supplicants
  * \param pdu pdu
  * \param size pdu size
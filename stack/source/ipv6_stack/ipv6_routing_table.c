@@ -39,8 +39,10 @@
 #include <inttypes.h>
 #include "common/rand.h"
 #include "common/bits.h"
+#include "common/utils.h"
 #include "common/log_legacy.h"
 #include "service_libs/etx/etx.h"
+#include "service_libs/fnv_hash/fnv_hash.h"
 
 #include "core/ns_address_internal.h"
 #include "common_protocols/ipv6_constants.h"
@@ -96,6 +98,21 @@ static neighbour_cache_config_t neighbour_cache_config = {NCACHE_MAX_ABSOLUTE, N
 static NS_LIST_DEFINE(ipv6_destination_cache, ipv6_destination_t, link);
 static NS_LIST_DEFINE(ipv6_routing_table, ipv6_route_t, link);
 
+/* Destination Cache entries are also indexed by address, and sorted by expiry
+ * time. Since the lifetime given on use only depends on the address scope,
+ * keeping one list per scope class and appending refreshed entries at the end
+ * keeps each list sorted: the GC only needs to look at the start of the lists.
+ */
+typedef NS_LIST_HEAD(ipv6_destination_t, expiry_link) ipv6_destination_expiry_list_t;
+static ipv6_destination_expiry_list_t ipv6_destination_expiry[2] = {
+    NS_LIST_INIT(ipv6_destination_expiry[0]),
+    NS_LIST_INIT(ipv6_destination_expiry[1]),
+};
+static ipv6_destination_t *ipv6_destination_hash[DCACHE_HASH_SIZE];
+static uint16_t ipv6_destination_cache_count;
+static uint32_t ipv6_destination_gc_epoch;
+static struct ipv6_cache_stats ipv6_cache_stats_data;
+
 static ipv6_destination_t *ipv6_destination_lookup(const uint8_t *address, int8_t interface_id);
 static void ipv6_destination_cache_forget_router(ipv6_neighbour_cache_t *cache, const uint8_t neighbour_addr[16]);
 static void ipv6_destination_cache_forget_neighbour(const ipv6_neighbour_t *neighbour);
@@ -121,6 +138,54 @@ static uint32_t next_probe_time(ipv6_neighbour_cache_t *cache, uint_fast8_t retr
     return rand_randomise_base(t, 0x4000, 0xBFFF);
 }
 
+static void ipv6_cache_stats_update(uint16_t *size, uint16_t *peak, uint16_t *chain_max,
+                                    uint16_t new_size, uint16_t chain_len)
+{
+    *size = new_size;
+    if (*peak < new_size)
+        *peak = new_size;
+    if (*chain_max < chain_len)
+        *chain_max = chain_len;
+}
+
+void ipv6_cache_stats(struct ipv6_cache_stats *stats)
+{
+    *stats = ipv6_cache_stats_data;
+}
+
+static ipv6_neighbour_t **ipv6_neighbour_hash_bucket(ipv6_neighbour_cache_t *cache, const uint8_t address[static 16])
+{
+    return &cache->hash[fnv_hash_1a_32_reverse_block(address, 16) % NCACHE_HASH_SIZE];
+}
+
+static void ipv6_neighbour_hash_insert(ipv6_neighbour_cache_t *cache, ipv6_neighbour_t *entry)
+{
+    ipv6_neighbour_t **bucket = ipv6_neighbour_hash_bucket(cache, entry->ip_address);
+    uint16_t chain_len = 1;
+
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    for (ipv6_neighbour_t *cur = entry->hash_next; cur; cur = cur->hash_next)
+        chain_len++;
+    cache->num_entries++;
+    ipv6_cache_stats_update(&ipv6_cache_stats_data.ncache_size, &ipv6_cache_stats_data.ncache_peak,
+                            &ipv6_cache_stats_data.ncache_chain_max, cache->num_entries, chain_len);
+}
+
+static void ipv6_neighbour_hash_remove(ipv6_neighbour_cache_t *cache, ipv6_neighbour_t *entry)
+{
+    ipv6_neighbour_t **prev = ipv6_neighbour_hash_bucket(cache, entry->ip_address);
+
+    while (*prev && *prev != entry)
+        prev = &(*prev)->hash_next;
+    if (!*prev)
+        return;
+    *prev = entry->hash_next;
+    entry->hash_next = NULL;
+    cache->num_entries--;
+    ipv6_cache_stats_data.ncache_size = cache->num_entries;
+}
+
 int8_t ipv6_neighbour_set_current_max_cache(uint16_t max_cache)
 {
     if (max_cache < 4) {
@@ -248,7 +313,7 @@ void ipv6_neighbour_cache_flush(ipv6_neighbour_cache_t *cache)
 
 ipv6_neighbour_t *ipv6_neighbour_lookup(ipv6_neighbour_cache_t *cache, const uint8_t *address)
 {
-    ns_list_foreach(ipv6_neighbour_t, cur, &cache->list) {
+    for (ipv6_neighbour_t *cur = *ipv6_neighbour_hash_bucket(cache, address); cur; cur = cur->hash_next) {
         if (addr_ipv6_equal(cur->ip_address, address)) {
             return cur;
         }
@@ -275,6 +340,7 @@ void ipv6_neighbour_entry_remove(ipv6_neighbour_cache_t *cache, ipv6_neighbour_t
      * the entry.
      */
     ns_list_remove(&cache->list, entry);
+    ipv6_neighbour_hash_remove(cache, entry);
     switch (entry->state) {
         case IP_NEIGHBOUR_NEW:
             break;
@@ -306,19 +372,23 @@ ipv6_neighbour_t *ipv6_neighbour_lookup_or_create(ipv6_neighbour_cache_t *cache,
     ipv6_neighbour_t *entry = NULL;
     ipv6_neighbour_t *garbage_possible_entry = NULL;
 
-    ns_list_foreach(ipv6_neighbour_t, cur, &cache->list) {
-
-        if (cur->type == IP_NEIGHBOUR_GARBAGE_COLLECTIBLE) {
-            garbage_possible_entry = cur;
-            count++;
+    entry = ipv6_neighbour_lookup(cache, address);
+    if (entry) {
+        if (entry != ns_list_get_first(&cache->list)) {
+            ns_list_remove(&cache->list, entry);
+            ns_list_add_to_start(&cache->list, entry);
         }
+        return entry;
+    }
 
-        if (addr_ipv6_equal(cur->ip_address, address)) {
-            if (cur != ns_list_get_first(&cache->list)) {
-                ns_list_remove(&cache->list, cur);
-                ns_list_add_to_start(&cache->list, cur);
+    // The garbage-collectible entries are a subset of the cache, only count
+    // them when the limit may have been reached.
+    if (cache->num_entries >= neighbour_cache_config.max_entries) {
+        ns_list_foreach(ipv6_neighbour_t, cur, &cache->list) {
+            if (cur->type == IP_NEIGHBOUR_GARBAGE_COLLECTIBLE) {
+                garbage_possible_entry = cur;
+                count++;
             }
-            return cur;
         }
     }
 
@@ -355,6 +425,7 @@ ipv6_neighbour_t *ipv6_neighbour_lookup_or_create(ipv6_neighbour_cache_t *cache,
     }
 
     ns_list_add_to_start(&cache->list, entry);
+    ipv6_neighbour_hash_insert(cache, entry);
 
     return entry;
 }
@@ -697,15 +768,8 @@ void ipv6_neighbour_cache_print(const ipv6_neighbour_cache_t *cache)
     }
 }
 
-static void ipv6_neighbour_cache_gc_periodic(ipv6_neighbour_cache_t *cache)
+static void ipv6_neighbour_cache_gc_periodic(ipv6_neighbour_cache_t *cache, uint_fast16_t gc_count)
 {
-    uint_fast16_t gc_count = 0;
-    ns_list_foreach_safe(ipv6_neighbour_t, entry, &cache->list) {
-        if (entry->type == IP_NEIGHBOUR_GARBAGE_COLLECTIBLE) {
-            gc_count++;
-        }
-    }
-
     if (gc_count <= neighbour_cache_config.long_term_entries) {
         return;
     }
@@ -734,8 +798,13 @@ static void ipv6_neighbour_cache_gc_periodic(ipv6_neighbour_cache_t *cache)
 void ipv6_neighbour_cache_slow_timer(int seconds)
 {
     ipv6_neighbour_cache_t *cache = &protocol_stack_interface_info_get()->ipv6_neighbour_cache;
+    uint_fast16_t gc_count = 0;
 
     ns_list_foreach_safe(ipv6_neighbour_t, cur, &cache->list) {
+        if (cur->type == IP_NEIGHBOUR_GARBAGE_COLLECTIBLE) {
+            gc_count++;
+        }
+
         if (cur->lifetime == 0 || cur->lifetime == 0xffffffff) {
             continue;
         }
@@ -769,7 +838,7 @@ void ipv6_neighbour_cache_slow_timer(int seconds)
 
     cache->gc_timer = NCACHE_GC_PERIOD;
     //ipv6_neighbour_cache_print(cache);
-    ipv6_neighbour_cache_gc_periodic(cache);
+    ipv6_neighbour_cache_gc_periodic(cache, gc_count);
 }
 
 void ipv6_neighbour_cache_fast_timer(int ticks)
@@ -857,7 +926,8 @@ void ipv6_destination_cache_print()
 {
     tr_debug("Destination Cache:");
     ns_list_foreach(ipv6_destination_t, entry, &ipv6_destination_cache) {
-        tr_debug(" %s (%d id) (life %u)", tr_ipv6(entry->destination), entry->interface_id, entry->lifetime);
+        tr_debug(" %s (%d id) (life %"PRIu32")", tr_ipv6(entry->destination), entry->interface_id,
+                 entry->expiry > ipv6_destination_gc_epoch ? entry->expiry - ipv6_destination_gc_epoch : 0);
         if (entry->redirected) {
             tr_debug("     Redirect %s%%%u", tr_ipv6(entry->redirect_addr), entry->interface_id);
         }
@@ -867,6 +937,16 @@ void ipv6_destination_cache_print()
     }
 }
 
+static ipv6_destination_t **ipv6_destination_hash_bucket(const uint8_t address[static 16])
+{
+    return &ipv6_destination_hash[fnv_hash_1a_32_reverse_block(address, 16) % DCACHE_HASH_SIZE];
+}
+
+static ipv6_destination_expiry_list_t *ipv6_destination_expiry_list(const ipv6_destination_t *entry)
+{
+    return &ipv6_destination_expiry[addr_ipv6_scope(entry->destination, NULL) <= IPV6_SCOPE_LINK_LOCAL];
+}
+
 static ipv6_destination_t *ipv6_destination_lookup(const uint8_t *address, int8_t interface_id)
 {
     bool is_ll = addr_is_ipv6_link_local(address);
@@ -875,7 +955,7 @@ static ipv6_destination_t *ipv6_destination_lookup(const uint8_t *address, int8_
         return NULL;
     }
 
-    ns_list_foreach(ipv6_destination_t, cur, &ipv6_destination_cache) {
+    for (ipv6_destination_t *cur = *ipv6_destination_hash_bucket(address); cur; cur = cur->hash_next) {
         if (!addr_ipv6_equal(cur->destination, address)) {
             continue;
         }
@@ -904,17 +984,17 @@ static ipv6_destination_t *ipv6_destination_lookup(const uint8_t *address, int8_
  */
 ipv6_destination_t *ipv6_destination_lookup_or_create(const uint8_t *address, int8_t interface_id)
 {
-    uint_fast16_t count = 0;
+    ipv6_destination_t **bucket = ipv6_destination_hash_bucket(address);
     ipv6_destination_t *entry = NULL;
     bool interface_specific = addr_ipv6_scope(address, NULL) <= IPV6_SCOPE_REALM_LOCAL;
+    uint16_t chain_len = 1;
 
     if (interface_specific && interface_id == -1) {
         return NULL;
     }
 
     /* Find any existing entry */
-    ns_list_foreach(ipv6_destination_t, cur, &ipv6_destination_cache) {
-        count++;
+    for (ipv6_destination_t *cur = *bucket; cur; cur = cur->hash_next) {
         if (!addr_ipv6_equal(cur->destination, address)) {
             continue;
         }
@@ -929,7 +1009,7 @@ ipv6_destination_t *ipv6_destination_lookup_or_create(const uint8_t *address, in
 
 
     if (!entry) {
-        if (count > destination_cache_config.max_entries) {
+        if (ipv6_destination_cache_count > destination_cache_config.max_entries) {
             entry = ns_list_get_last(&ipv6_destination_cache);
             ipv6_destination_release(entry);
         }
@@ -956,16 +1036,31 @@ ipv6_destination_t *ipv6_destination_lookup_or_create(const uint8_t *address, in
             entry->interface_id = -1;
         }
         ns_list_add_to_start(&ipv6_destination_cache, entry);
-    } else if (entry != ns_list_get_first(&ipv6_destination_cache)) {
-        /* If there was an entry, and it wasn't at the start, move it */
-        ns_list_remove(&ipv6_destination_cache, entry);
-        ns_list_add_to_start(&ipv6_destination_cache, entry);
+        ns_list_add_to_end(ipv6_destination_expiry_list(entry), entry);
+        bucket = ipv6_destination_hash_bucket(address);
+        entry->hash_next = *bucket;
+        *bucket = entry;
+        for (ipv6_destination_t *cur = entry->hash_next; cur; cur = cur->hash_next)
+            chain_len++;
+        ipv6_destination_cache_count++;
+        ipv6_cache_stats_update(&ipv6_cache_stats_data.dcache_size, &ipv6_cache_stats_data.dcache_peak,
+                                &ipv6_cache_stats_data.dcache_chain_max, ipv6_destination_cache_count, chain_len);
+    } else {
+        if (entry != ns_list_get_first(&ipv6_destination_cache)) {
+            /* If there was an entry, and it wasn't at the start, move it */
+            ns_list_remove(&ipv6_destination_cache, entry);
+            ns_list_add_to_start(&ipv6_destination_cache, entry);
+        }
+        if (entry != ns_list_get_last(ipv6_destination_expiry_list(entry))) {
+            ns_list_remove(ipv6_destination_expiry_list(entry), entry);
+            ns_list_add_to_end(ipv6_destination_expiry_list(entry), entry);
+        }
     }
 
     if (addr_ipv6_scope(address, NULL) <= IPV6_SCOPE_LINK_LOCAL) {
-        entry->lifetime = DCACHE_GC_AGE_LL;
+        entry->expiry = ipv6_destination_gc_epoch + DCACHE_GC_AGE_LL;
     } else {
-        entry->lifetime = destination_cache_config.entry_lifetime / DCACHE_GC_PERIOD;
+        entry->expiry = ipv6_destination_gc_epoch + destination_cache_config.entry_lifetime / DCACHE_GC_PERIOD;
     }
 
     return entry;
@@ -1068,8 +1163,17 @@ void ipv6_destination_cache_clean(int8_t interface_id)
 
 static bool ipv6_destination_release(ipv6_destination_t *dest)
 {
+    ipv6_destination_t **prev;
+
     if (--dest->refcount == 0) {
         ns_list_remove(&ipv6_destination_cache, dest);
+        ns_list_remove(ipv6_destination_expiry_list(dest), dest);
+        prev = ipv6_destination_hash_bucket(dest->destination);
+        while (*prev != dest)
+            prev = &(*prev)->hash_next;
+        *prev = dest->hash_next;
+        ipv6_destination_cache_count--;
+        ipv6_cache_stats_data.dcache_size = ipv6_destination_cache_count;
         tr_debug("Destination cache remove: %s", tr_ipv6(dest->destination));
         free(dest);
         return true;
@@ -1079,13 +1183,9 @@ static bool ipv6_destination_release(ipv6_destination_t *dest)
 
 static void ipv6_destination_cache_gc_periodic(void)
 {
-    uint_fast16_t gc_count = 0;
-    ns_list_foreach_safe(ipv6_destination_t, entry, &ipv6_destination_cache) {
-        if (entry->lifetime) {
-            entry->lifetime--;
-        }
-        gc_count++;
+    ipv6_destination_gc_epoch++;
 #ifdef HAVE_IPV6_PMTUD
+    ns_list_foreach(ipv6_destination_t, entry, &ipv6_destination_cache) {
         /* Purge old PMTU values */
         if (entry->pmtu_lifetime) {
             if (entry->pmtu_lifetime <= DCACHE_GC_PERIOD) {
@@ -1104,30 +1204,39 @@ static void ipv6_destination_cache_gc_periodic(void)
                 entry->pmtu_lifetime -= DCACHE_GC_PERIOD;
             }
         }
-#endif
     }
+#endif
 
-    if (gc_count <= destination_cache_config.long_term_entries) {
+    if (ipv6_destination_cache_count <= destination_cache_config.long_term_entries) {
         return;
     }
 
-    /* Cache is in most-recently-used-first order. GC strategy is to start from
-     * the back, and reduce the size to "MAX_SHORT_TERM" every GC period,
-     * deleting any entry. Timed-out entries will be deleted to keep it to
-     * MAX_LONG_TERM.
+    /* Timed-out entries are deleted to keep the cache to MAX_LONG_TERM. They
+     * are found at the start of the expiry lists, so the walk stops at the
+     * first live entry.
      */
-    ns_list_foreach_reverse_safe(ipv6_destination_t, entry, &ipv6_destination_cache) {
-        if (entry->lifetime == 0 || gc_count > destination_cache_config.short_term_entries) {
-            if (ipv6_destination_release(entry)) {
-                gc_count--;
-            }
-
-            if (gc_count <= destination_cache_config.long_term_entries) {
+    for (int i = 0; i < ARRAY_SIZE(ipv6_destination_expiry); i++) {
+        ns_list_foreach_safe(ipv6_destination_t, entry, &ipv6_destination_expiry[i]) {
+            if (entry->expiry > ipv6_destination_gc_epoch) {
                 break;
             }
+            ipv6_destination_release(entry);
+            if (ipv6_destination_cache_count <= destination_cache_config.long_term_entries) {
+                return;
+            }
         }
     }
 
+    /* Cache is in most-recently-used-first order. Reduce the size to
+     * "MAX_SHORT_TERM" every GC period, deleting any entry from the back.
+     * Entries still referenced cannot be released and are skipped.
+     */
+    ns_list_foreach_reverse_safe(ipv6_destination_t, entry, &ipv6_destination_cache) {
+        if (ipv6_destination_cache_count <= destination_cache_config.short_term_entries) {
+            break;
+        }
+        ipv6_destination_release(entry);
+    }
 }
 
 void ipv6_destination_cache_timer(int ticks)
@@ -46,6 +46,12 @@
 
 #define DCACHE_GC_PERIOD    20  /* seconds */
 
+/* Number of buckets of the address hash tables of the Neighbour Cache and of
+ * the Destination Cache. Keep it a power of 2.
+ */
+#define NCACHE_HASH_SIZE    64
+#define DCACHE_HASH_SIZE    64
+
 /* XXX in the process of renaming this - it's really specifically the
  * IP Neighbour Cache  but was initially called a routing table */
 
@@ -106,6 +112,7 @@ typedef struct ipv6_neighbour {
     uint32_t                        timer;                      /* 100ms ticks */
     uint32_t                        lifetime;                   /* seconds */
     ns_list_link_t                  link;                       /*!< List link */
+    struct ipv6_neighbour           *hash_next;                 /*!< Next entry in the same hash bucket */
     NS_LIST_HEAD_INCOMPLETE(struct buffer) queue;
     uint8_t                         ll_address[];
 } ipv6_neighbour_t;
@@ -138,8 +145,9 @@ typedef struct ipv6_neighbour_cache {
     uint32_t                                reachable_time;
     // Interface specific information for route
     ipv6_route_interface_info_t             route_if_info;
-    //uint8_t                                   num_entries;
+    uint16_t                                num_entries;
     NS_LIST_HEAD(ipv6_neighbour_t, link)    list;
+    ipv6_neighbour_t                        *hash[NCACHE_HASH_SIZE];
 } ipv6_neighbour_cache_t;
 
 void ipv6_neighbour_cache_init(ipv6_neighbour_cache_t *cache, int8_t interface_id);
@@ -172,6 +180,18 @@ int8_t ipv6_neighbour_set_current_max_cache(uint16_t max_cache);
 int8_t ipv6_destination_cache_configure(uint16_t max_entries, uint16_t short_term_threshold, uint16_t long_term_threshold, uint16_t lifetime);
 int8_t ipv6_neighbour_cache_configure(uint16_t max_entries, uint16_t short_term_threshold, uint16_t long_term_threshold, uint16_t lifetime);
 
+// Occupancy of the Neighbour and Destination Caches, and longest hash chain seen
+struct ipv6_cache_stats {
+    uint16_t ncache_size;
+    uint16_t ncache_peak;
+    uint16_t ncache_chain_max;
+    uint16_t dcache_size;
+    uint16_t dcache_peak;
+    uint16_t dcache_chain_max;
+};
+
+void ipv6_cache_stats(struct ipv6_cache_stats *stats);
+
 /* Backwards compatibility with test app */
 #define ROUTE_RPL_UP ROUTE_RPL_DIO
 #define ROUTE_RPL_DOWN ROUTE_RPL_DAO
@@ -192,7 +212,7 @@ typedef struct ipv6_destination {
     bool                            redirected;         // we have a redirect in force
     int8_t                          interface_id;       // fixed if link-local destination, else variable and gets set from redirect interface and/or last_neighbour interface
     uint16_t                        refcount;
-    uint16_t                        lifetime;           // Life in GC calls, so 20s units
+    uint32_t                        expiry;             // GC epoch at which the entry becomes collectible
 #ifdef HAVE_IPV6_PMTUD
     uint16_t                        pmtu;               // note this may be less than 1280 - upper layers may choose to send smaller based on this
     uint16_t                        pmtu_lifetime;      // seconds
@@ -201,7 +221,9 @@ typedef struct ipv6_destination {
     uint32_t                        fragment_id;
 #endif
     ipv6_neighbour_t                *last_neighbour;    // last neighbour used (only for reachability confirmation)
-    ns_list_link_t                  link;
+    struct ipv6_destination         *hash_next;
+    ns_list_link_t                  link;               // most-recently-used-first list
+    ns_list_link_t                  expiry_link;        // soonest-expiry-first list
 } ipv6_destination_t;
 
 #ifdef HAVE_IPV6_PMTUD
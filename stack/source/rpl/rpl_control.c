@@ -405,7 +405,7 @@ static void rpl_control_addr_notifier(struct net_if *interface, const if_address
     }
 }
 
-static void rpl_control_etx_change_callback(int8_t  nwk_id, uint16_t previous_etx, uint16_t current_etx, uint8_t attribute_index, const uint8_t *mac64)
+static void rpl_control_etx_change_callback(int8_t  nwk_id, uint16_t previous_etx, uint16_t current_etx, uint16_t attribute_index, const uint8_t *mac64)
 {
 
     struct net_if *cur = protocol_stack_interface_info_get_by_id(nwk_id);
@@ -84,8 +84,6 @@
 #include "common/endian.h"
 #include "common/rand.h"
 #include "common/log_legacy.h"
-#include "app_wsbrd/dbus.h"
-#include "app_wsbrd/wsbr.h"
 #include "common/ns_list.h"
 #include "common/utils.h"
 #include "stack/net_rpl.h"
@@ -96,6 +94,7 @@
 #include "common_protocols/icmpv6.h"
 #include "nwk_interface/protocol.h"
 #include "ipv6_stack/ipv6_routing_table.h"
+#include "6lowpan/ws/ws_bbr_api_internal.h"
 
 #include "rpl/rpl_protocol.h"
 #include "rpl/rpl_policy.h"
@@ -1483,8 +1482,7 @@ void rpl_downward_paths_invalidate(rpl_instance_t *instance)
 {
     instance->root_paths_valid = false;
     rpl_data_sr_invalidate();
-    // FIXME: do not include app_wsbrd
-    dbus_emit_nodes_change(&g_ctxt);
+    ws_bbr_nodes_changed();
 }
 #endif // HAVE_RPL_ROOT
 
@@ -80,6 +80,7 @@ struct kmp_service {
     kmp_service_api_get                *api_get;                /**< Callback to get KMP API from a service */
     kmp_service_timer_if_start         *timer_start;            /**< Callback to start timer */
     kmp_service_timer_if_stop          *timer_stop;             /**< Callback to stop timer */
+    kmp_service_receive_id_if_set      *receive_id_set;         /**< Callback to set receive identifier */
     kmp_service_event_if_event_send    *event_send;             /**< Callback to send event */
     kmp_service_shared_comp_add        *shared_comp_add;        /**< Callback to shared component add */
     kmp_service_shared_comp_remove     *shared_comp_remove;     /**< Callback to shared component remove */
@@ -112,6 +113,7 @@ static void kmp_sec_prot_eui64_addr_get(sec_prot_t *prot, uint8_t *local_eui64,
 static void kmp_sec_prot_ip_addr_get(sec_prot_t *prot, uint8_t *address);
 static sec_prot_t *kmp_sec_prot_by_type_get(sec_prot_t *prot, uint8_t type);
 static void kmp_sec_prot_receive_disable(sec_prot_t *prot);
+static void kmp_sec_prot_receive_id_set(sec_prot_t *prot, uint8_t id);
 
 #define kmp_api_get_from_prot(prot) (kmp_api_t *)(((uint8_t *)prot) - offsetof(kmp_api_t, sec_prot));
 
@@ -178,6 +180,7 @@ kmp_api_t *kmp_api_create(kmp_service_t *service, kmp_type_e type, uint8_t msg_i
     kmp->sec_prot.ip_addr_get = kmp_sec_prot_ip_addr_get;
     kmp->sec_prot.type_get = kmp_sec_prot_by_type_get;
     kmp->sec_prot.receive_disable = kmp_sec_prot_receive_disable;
+    kmp->sec_prot.receive_id_set = kmp_sec_prot_receive_id_set;
     kmp->sec_prot.sec_cfg = sec_cfg;
     kmp->sec_prot.msg_if_instance_id = msg_if_instance_id;
 
@@ -384,6 +387,14 @@ static void kmp_sec_prot_receive_disable(sec_prot_t *prot)
     kmp->receive_disable = true;
 }
 
+static void kmp_sec_prot_receive_id_set(sec_prot_t *prot, uint8_t id)
+{
+    kmp_api_t *kmp = kmp_api_get_from_prot(prot);
+    if (kmp->service->receive_id_set) {
+        kmp->service->receive_id_set(kmp->service, kmp, id);
+    }
+}
+
 void kmp_api_delete(kmp_api_t *kmp)
 {
     if (kmp->sec_prot.delete) {
@@ -484,6 +495,7 @@ kmp_service_t *kmp_service_create(void)
     service->api_get = 0;
     service->shared_comp_add = NULL;
     service->shared_comp_remove = NULL;
+    service->receive_id_set = NULL;
 
     ns_list_add_to_start(&kmp_service_list, service);
 
@@ -689,6 +701,16 @@ int8_t kmp_service_timer_if_register(kmp_service_t *service, kmp_service_timer_i
     return 0;
 }
 
+int8_t kmp_service_receive_id_if_register(kmp_service_t *service, kmp_service_receive_id_if_set set)
+{
+    if (!service) {
+        return -1;
+    }
+
+    service->receive_id_set = set;
+    return 0;
+}
+
 int8_t kmp_service_shared_comp_if_register(kmp_service_t *service, kmp_service_shared_comp_add add, kmp_service_shared_comp_remove remove)
 {
     if (!service) {
@@ -535,6 +535,34 @@ int8_t kmp_service_timer_if_register(kmp_service_t *service,
                                      kmp_service_timer_if_start start,
                                      kmp_service_timer_if_stop stop);
 
+/**
+ * kmp_service_receive_id_if_set receive identifier set callback
+ *
+ * Called when KMP starts waiting for messages with a new identifier (the one
+ * matched by kmp_api_receive_check()).
+ *
+ * \param service KMP service
+ * \param kmp KMP instance
+ * \param id identifier
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+typedef int8_t kmp_service_receive_id_if_set(kmp_service_t *service, kmp_api_t *kmp, uint8_t id);
+
+/**
+ * kmp_service_receive_id_if_register register a receive identifier interface to KMP service
+ *
+ * \param service KMP service
+ * \param set receive identifier set callback
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+int8_t kmp_service_receive_id_if_register(kmp_service_t *service, kmp_service_receive_id_if_set set);
+
 /**
  * kmp_service_shared_comp_timer_timeout shared component timer timeout
  *
@@ -29,8 +29,10 @@
 #include "common/trickle.h"
 #include "common/log_legacy.h"
 #include "common/ns_list.h"
+#include "common/utils.h"
 #include "service_libs/hmac/hmac_md.h"
 #include "stack/mac/fhss_config.h"
+#include "stack/timers.h"
 
 #include "nwk_interface/protocol.h"
 #include "6lowpan/ws/ws_config.h"
@@ -79,16 +81,18 @@ typedef enum {
 #define MS_MPPE_RECV_KEY_SALT_LEN     2
 #define MS_MPPE_RECV_KEY_BLOCK_LEN    16
 
-#define RADIUS_CONN_NUMBER            3
-#define RADIUS_ID_RANGE_SIZE          10
-#define RADIUS_ID_RANGE_NUM           (255 / RADIUS_ID_RANGE_SIZE) - 1
-
-#define RADIUS_ID_TIMEOUT             60
+#define RADIUS_ID_NUMBER              256
+// Identifier of an unanswered request is not reused while the server may still
+// answer it. Once answered, a late duplicate answer does not match the request
+// authenticator of a new request, so the identifier is reused immediately.
+#define RADIUS_ID_TIMEOUT             12
 
 typedef struct radius_client_sec_prot_lib_int radius_client_sec_prot_lib_int_t;
 
 typedef struct radius_client_sec_prot_int {
     sec_prot_common_t             common;                       /**< Common data */
+    sec_prot_t                    *prot;                        /**< Security protocol */
+    ns_list_link_t                link;                         /**< Link on the request queue */
     sec_prot_t                    *radius_eap_tls_prot;         /**< Radius EAP-TLS security protocol */
     sec_prot_receive              *radius_eap_tls_send;         /**< Radius EAP-TLS security protocol send (receive from peer) */
     sec_prot_delete               *radius_eap_tls_deleted;      /**< Radius EAP-TLS security protocol peer deleted (notify to peer that radius client deleted) */
@@ -97,37 +101,49 @@ typedef struct radius_client_sec_prot_int {
     uint16_t                      recv_eap_msg_len;             /**< Received EAP message length */
     uint8_t                       *recv_eap_msg;                /**< Received EAP message */
     uint16_t                      send_radius_msg_len;          /**< Send radius message length */
+    uint16_t                      send_radius_msg_auth_offset;  /**< Offset of the message authenticator in send radius message */
     uint8_t                       *send_radius_msg;             /**< Send radius message */
+    uint32_t                      send_time;                    /**< Time the request was first sent; 100ms ticks */
+    uint16_t                      rto;                          /**< Retry timeout; 100ms ticks */
+    uint16_t                      rto_ticks;                    /**< Ticks left before retry */
+    uint8_t                       retries;                      /**< Number of retries of the request */
     uint8_t                       identity_len;                 /**< Supplicant EAP identity length */
     uint8_t                       *identity;                    /**< Supplicant EAP identity */
     uint8_t                       radius_code;                  /**< Radius code that was received */
     uint8_t                       radius_identifier;            /**< Radius identifier that was last sent */
-    uint8_t                       radius_id_conn_num;           /**< Radius identifier connection number (socket instance) */
-    uint8_t                       radius_id_range;              /**< Radius identifier range */
     uint8_t                       request_authenticator[16];    /**< Radius request authenticator that was last sent */
     uint8_t                       state_len;                    /**< Radius state length that was last received */
     uint8_t                       *state;                       /**< Radius state that was last received */
     uint8_t                       remote_eui_64_hash[8];        /**< Remote EUI-64 hash used for calling station id */
     bool                          remote_eui_64_hash_set : 1;   /**< Remote EUI-64 hash used for calling station id set */
     bool                          new_pmk_set : 1;              /**< New Pair Wise Master Key set */
-    bool                          radius_id_range_set : 1;      /**< Radius identifier start value set */
+    bool                          radius_id_set : 1;            /**< Radius identifier allocated, request waits for a response */
+    bool                          queued : 1;                   /**< Request waits for room in the window */
 } radius_client_sec_prot_int_t;
 
+typedef NS_LIST_HEAD(radius_client_sec_prot_int_t, link) radius_client_sec_prot_queue_t;
+
 typedef struct radius_client_sec_prot_shared {
-    uint8_t radius_identifier_timer[RADIUS_CONN_NUMBER][RADIUS_ID_RANGE_NUM];
+    sec_prot_t *radius_identifier_owner[RADIUS_ID_NUMBER];      /**< Protocol waiting for a response, per identifier */
+    uint8_t radius_identifier_timer[RADIUS_ID_NUMBER];          /**< Identifier reuse timer; seconds */
+    uint8_t radius_identifier_next;                             /**< Next identifier to allocate */
+    uint16_t in_flight;                                         /**< Requests waiting for a response */
+    radius_client_sec_prot_queue_t queue;                       /**< Requests waiting for room in the window */
+    uint32_t srtt;                                              /**< Smoothed round-trip time; 1/8 of 100ms ticks */
+    uint32_t rttvar;                                            /**< Round-trip time variation; 1/4 of 100ms ticks */
     shared_comp_data_t comp_data;                               /**< Shared component data (timer, delete) */
     uint8_t local_eui64_hash[8];                                /**< Local EUI-64 hash used for called stations id */
     uint8_t hash_random[16];                                    /**< Random used to generate local and remote EUI-64 hashes */
     bool local_eui64_hash_set : 1;                              /**< Local EUI-64 hash used for called stations id set */
     bool hash_random_set : 1;                                   /**< Random used to generate local and remote EUI-64 hashes set */
     bool radius_id_timer_running : 1;                           /**> Radius identifier timer running */
+    bool rtt_set : 1;                                           /**< Round-trip time measured */
 } radius_client_sec_prot_shared_t;
 
 static uint16_t radius_client_sec_prot_size(void);
 static int8_t radius_client_sec_prot_init(sec_prot_t *prot);
 static int8_t radius_client_sec_prot_shared_data_timeout(uint16_t ticks);
 static int8_t radius_client_sec_prot_shared_data_delete(void);
-static void radius_identifier_timer_value_set(uint8_t conn_num, uint8_t id_range, uint8_t value);
 static void radius_client_sec_prot_create_response(sec_prot_t *prot, sec_prot_result_e result);
 static void radius_client_sec_prot_delete(sec_prot_t *prot);
 static int8_t radius_client_sec_prot_receive_check(sec_prot_t *prot, const void *pdu, uint16_t size);
@@ -137,10 +153,14 @@ static uint16_t radius_client_sec_prot_eap_avps_handle(uint16_t avp_length, uint
 static int8_t radius_client_sec_prot_receive(sec_prot_t *prot, const void *pdu, uint16_t size, uint8_t conn_number);
 static int8_t radius_client_sec_prot_radius_eap_receive(sec_prot_t *prot, const void *pdu, uint16_t size);
 static void radius_client_sec_prot_allocate_and_create_radius_message(sec_prot_t *prot);
+static int8_t radius_client_sec_prot_radius_msg_sign(sec_prot_t *prot);
 static int8_t radius_client_sec_prot_radius_msg_send(sec_prot_t *prot);
 static void radius_client_sec_prot_radius_msg_free(sec_prot_t *prot);
-static uint8_t radius_client_sec_prot_identifier_allocate(sec_prot_t *prot, uint8_t value);
-static void radius_client_sec_prot_identifier_free(sec_prot_t *prot);
+static int radius_client_sec_prot_identifier_allocate(sec_prot_t *prot);
+static void radius_client_sec_prot_identifier_free(sec_prot_t *prot, bool answered);
+static void radius_client_sec_prot_request_submit(sec_prot_t *prot);
+static void radius_client_sec_prot_request_done(sec_prot_t *prot, bool answered);
+static void radius_client_sec_prot_queue_run(void);
 static uint8_t radius_client_sec_prot_hex_to_ascii(uint8_t value);
 static int8_t radius_client_sec_prot_eui_64_hash_generate(uint8_t *eui_64, uint8_t *hashed_eui_64);
 static void radius_client_sec_prot_station_id_generate(uint8_t *eui_64, uint8_t *station_id_ptr);
@@ -182,14 +202,12 @@ static int8_t radius_client_sec_prot_shared_data_timeout(uint16_t ticks)
 
     bool timer_running = false;
 
-    for (uint8_t conn_num = 0; conn_num < RADIUS_CONN_NUMBER; conn_num++) {
-        for (uint8_t id_range = 0; id_range < RADIUS_ID_RANGE_NUM; id_range++) {
-            if (shared_data->radius_identifier_timer[conn_num][id_range] > ticks) {
-                shared_data->radius_identifier_timer[conn_num][id_range] -= ticks;
-                timer_running = true;
-            } else {
-                shared_data->radius_identifier_timer[conn_num][id_range] = 0;
-            }
+    for (int id = 0; id < RADIUS_ID_NUMBER; id++) {
+        if (shared_data->radius_identifier_timer[id] > ticks) {
+            shared_data->radius_identifier_timer[id] -= ticks;
+            timer_running = true;
+        } else {
+            shared_data->radius_identifier_timer[id] = 0;
         }
     }
 
@@ -197,13 +215,10 @@ static int8_t radius_client_sec_prot_shared_data_timeout(uint16_t ticks)
         shared_data->radius_id_timer_running = false;
     }
 
-    return 0;
-}
+    // Requests may have been waiting for an identifier
+    radius_client_sec_prot_queue_run();
 
-static void radius_identifier_timer_value_set(uint8_t conn_num, uint8_t id_range, uint8_t value)
-{
-    shared_data->radius_identifier_timer[conn_num][id_range] = value;
-    shared_data->radius_id_timer_running = true;
+    return 0;
 }
 
 static int8_t radius_client_sec_prot_shared_data_delete(void)
@@ -233,6 +248,7 @@ static int8_t radius_client_sec_prot_init(sec_prot_t *prot)
 
     sec_prot_init(&data->common);
     sec_prot_state_set(prot, &data->common, RADIUS_STATE_INIT);
+    data->prot = prot;
     data->radius_eap_tls_prot = NULL;
     data->radius_eap_tls_send = NULL;
     data->radius_eap_tls_header_size = 0;
@@ -240,7 +256,12 @@ static int8_t radius_client_sec_prot_init(sec_prot_t *prot)
     data->recv_eap_msg_len = 0;
     data->recv_eap_msg = NULL;
     data->send_radius_msg_len = 0;
+    data->send_radius_msg_auth_offset = 0;
     data->send_radius_msg = NULL;
+    data->send_time = 0;
+    data->rto = 0;
+    data->rto_ticks = 0;
+    data->retries = 0;
     data->identity_len = 0;
     data->identity = NULL;
     data->radius_code = RADIUS_MESSAGE_NONE;
@@ -251,7 +272,8 @@ static int8_t radius_client_sec_prot_init(sec_prot_t *prot)
     memset(data->remote_eui_64_hash, 0, 8);
     data->remote_eui_64_hash_set = false;
     data->new_pmk_set = false;
-    data->radius_id_range_set = false;
+    data->radius_id_set = false;
+    data->queued = false;
 
     if (!shared_data) {
         shared_data = malloc(sizeof(radius_client_sec_prot_shared_t));
@@ -259,6 +281,7 @@ static int8_t radius_client_sec_prot_init(sec_prot_t *prot)
             return -1;
         }
         memset(shared_data, 0, sizeof(radius_client_sec_prot_shared_t));
+        ns_list_init(&shared_data->queue);
         shared_data->local_eui64_hash_set = false;
         shared_data->hash_random_set = false;
         shared_data->radius_id_timer_running = false;
@@ -275,6 +298,8 @@ static void radius_client_sec_prot_delete(sec_prot_t *prot)
 {
     radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
 
+    radius_client_sec_prot_request_done(prot, false);
+
     if (data->recv_eap_msg != NULL) {
         free(data->recv_eap_msg);
     }
@@ -300,11 +325,10 @@ static void radius_client_sec_prot_create_response(sec_prot_t *prot, sec_prot_re
 
 static int8_t radius_client_sec_prot_receive_check(sec_prot_t *prot, const void *pdu, uint16_t size)
 {
-    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
-
     if (size >= 2) {
         const uint8_t *radius_msg = pdu;
-        if (radius_msg[1] == data->radius_identifier) {
+        // Identifier may have been given to another protocol since last request
+        if (shared_data->radius_identifier_owner[radius_msg[1]] == prot) {
             return 0;
         }
     }
@@ -549,43 +573,153 @@ static int8_t radius_client_sec_prot_radius_eap_receive(sec_prot_t *prot, const
     return 0;
 }
 
-static uint8_t radius_client_sec_prot_identifier_allocate(sec_prot_t *prot, uint8_t value)
+static int radius_client_sec_prot_identifier_allocate(sec_prot_t *prot)
 {
-    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
+    uint8_t id;
 
-    if (!data->radius_id_range_set || value >= (data->radius_id_range * RADIUS_ID_RANGE_SIZE) + RADIUS_ID_RANGE_SIZE - 1) {
-        for (uint8_t conn_num = 0; conn_num < RADIUS_CONN_NUMBER; conn_num++) {
-            for (uint8_t id_range = 0; id_range < RADIUS_ID_RANGE_NUM; id_range++) {
-                if (shared_data->radius_identifier_timer[conn_num][id_range] == 0) {
-                    // If range has been already reserved
-                    if (data->radius_id_range_set) {
-                        // Set previous range to timeout at 1/5 of identifier timeout
-                        radius_identifier_timer_value_set(data->radius_id_conn_num, data->radius_id_range, RADIUS_ID_TIMEOUT / 5);
-                    }
-                    // Set timeout for new range to 60 seconds
-                    radius_identifier_timer_value_set(conn_num, id_range, RADIUS_ID_TIMEOUT);
-                    data->radius_id_conn_num = conn_num;
-                    data->radius_id_range = id_range;
-                    data->radius_id_range_set = true;
-                    return id_range * RADIUS_ID_RANGE_SIZE;
-                }
-            }
+    for (int i = 0; i < RADIUS_ID_NUMBER; i++) {
+        id = shared_data->radius_identifier_next++;
+        if (!shared_data->radius_identifier_owner[id] && !shared_data->radius_identifier_timer[id]) {
+            shared_data->radius_identifier_owner[id] = prot;
+            return id;
         }
-    } else {
-        radius_identifier_timer_value_set(data->radius_id_conn_num, data->radius_id_range, RADIUS_ID_TIMEOUT);
-        return value + 1;
     }
 
+    return -1;
+}
+
+static void radius_client_sec_prot_identifier_free(sec_prot_t *prot, bool answered)
+{
+    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
+
+    shared_data->radius_identifier_owner[data->radius_identifier] = NULL;
+    if (!answered) {
+        shared_data->radius_identifier_timer[data->radius_identifier] = RADIUS_ID_TIMEOUT;
+        shared_data->radius_id_timer_running = true;
+    }
+    data->radius_id_set = false;
+}
+
+static uint16_t radius_client_sec_prot_rto_get(sec_prot_t *prot)
+{
+    const trickle_params_t *params = &prot->sec_cfg->radius_cfg->radius_retry_trickle_params;
+    uint32_t rto;
+
+    if (!shared_data->rtt_set) {
+        return params->Imax;
+    }
+
+    // RTO = SRTT + 4 * RTTVAR (RFC 6298)
+    rto = (shared_data->srtt >> 3) + shared_data->rttvar;
+    rto = MAX(rto, (uint32_t)params->Imin);
+    rto = MIN(rto, (uint32_t)RADIUS_CLIENT_RTO_MAX);
+    return rto;
+}
+
+static void radius_client_sec_prot_rtt_update(uint32_t rtt)
+{
+    int32_t delta;
+
+    rtt = MIN(rtt, (uint32_t)RADIUS_CLIENT_RTO_MAX);
+    if (!shared_data->rtt_set) {
+        shared_data->srtt = rtt << 3;
+        shared_data->rttvar = rtt << 1;
+        shared_data->rtt_set = true;
+        return;
+    }
+
+    // SRTT += (RTT - SRTT) / 8, RTTVAR += (|RTT - SRTT| - RTTVAR) / 4
+    delta = rtt - (shared_data->srtt >> 3);
+    shared_data->srtt += delta;
+    if (delta < 0) {
+        delta = -delta;
+    }
+    shared_data->rttvar += delta - (shared_data->rttvar >> 2);
+}
+
+static int radius_client_sec_prot_request_send(sec_prot_t *prot)
+{
+    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
+    int id;
+
+    id = radius_client_sec_prot_identifier_allocate(prot);
+    if (id < 0) {
+        return -1;
+    }
+    data->radius_identifier = id;
+    data->radius_id_set = true;
+    prot->receive_id_set(prot, data->radius_identifier);
+    shared_data->in_flight++;
+
+    if (radius_client_sec_prot_radius_msg_sign(prot) < 0) {
+        tr_error("Radius: msg sign error");
+    } else if (radius_client_sec_prot_radius_msg_send(prot) < 0) {
+        tr_error("Radius: msg send error");
+    }
+
+    data->send_time = g_monotonic_time_100ms;
+    data->retries = 0;
+    data->rto = radius_client_sec_prot_rto_get(prot);
+    data->rto_ticks = data->rto;
     return 0;
 }
 
-static void radius_client_sec_prot_identifier_free(sec_prot_t *prot)
+static void radius_client_sec_prot_request_submit(sec_prot_t *prot)
 {
     radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
 
-    if (data->radius_id_range_set) {
-        // Timeout at 1/5 of identifier timeout
-        radius_identifier_timer_value_set(data->radius_id_conn_num, data->radius_id_range, RADIUS_ID_TIMEOUT / 5);
+    // Older requests go first
+    if (ns_list_is_empty(&shared_data->queue) &&
+        shared_data->in_flight < prot->sec_cfg->radius_cfg->radius_window &&
+        !radius_client_sec_prot_request_send(prot)) {
+        return;
+    }
+
+    tr_debug("Radius: queue access request, eui-64: %s", tr_eui64(sec_prot_remote_eui_64_addr_get(prot)));
+    ns_list_add_to_end(&shared_data->queue, data);
+    data->queued = true;
+}
+
+static void radius_client_sec_prot_request_done(sec_prot_t *prot, bool answered)
+{
+    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
+
+    if (!shared_data) {
+        return;
+    }
+
+    if (data->queued) {
+        ns_list_remove(&shared_data->queue, data);
+        data->queued = false;
+    }
+
+    if (!data->radius_id_set) {
+        return;
+    }
+
+    // Retried requests are ambiguous and not measured (Karn's algorithm)
+    if (answered && !data->retries) {
+        radius_client_sec_prot_rtt_update(g_monotonic_time_100ms - data->send_time);
+    }
+    radius_client_sec_prot_identifier_free(prot, answered);
+    shared_data->in_flight--;
+
+    radius_client_sec_prot_queue_run();
+}
+
+static void radius_client_sec_prot_queue_run(void)
+{
+    radius_client_sec_prot_int_t *data;
+
+    while ((data = ns_list_get_first(&shared_data->queue))) {
+        if (shared_data->in_flight >= data->prot->sec_cfg->radius_cfg->radius_window) {
+            return;
+        }
+        if (radius_client_sec_prot_request_send(data->prot) < 0) {
+            return;
+        }
+        ns_list_remove(&shared_data->queue, data);
+        data->queued = false;
     }
 }
 
@@ -674,8 +808,7 @@ static void radius_client_sec_prot_allocate_and_create_radius_message(sec_prot_t
     uint8_t *radius_msg_start_ptr = radius_msg_ptr;
 
     *radius_msg_ptr++ = RADIUS_ACCESS_REQUEST;                                // code
-    data->radius_identifier = radius_client_sec_prot_identifier_allocate(prot, data->radius_identifier);
-    *radius_msg_ptr++ = data->radius_identifier;                              // identifier
+    *radius_msg_ptr++ = 0;                                                    // identifier, set on send
     radius_msg_ptr = write_be16(radius_msg_ptr, radius_msg_length);  // length
 
     rand_get_n_bytes_random(data->request_authenticator, 16);
@@ -726,17 +859,8 @@ static void radius_client_sec_prot_allocate_and_create_radius_message(sec_prot_t
         }
     }
 
-    uint8_t *message_auth_ptr = radius_msg_ptr;
-    uint8_t message_auth[16];
-    memset(message_auth, 0, 16); // zero for value calculation
-    radius_msg_ptr = avp_message_authenticator_write(radius_msg_ptr, message_auth);
-    // Calculate message authenticator
-    if (radius_client_sec_prot_message_authenticator_calc(prot, radius_msg_length, radius_msg_start_ptr, message_auth) < 0) {
-        free(radius_msg_start_ptr);
-        return;
-    }
-    // Write message authenticator
-    radius_msg_ptr = avp_message_authenticator_write(message_auth_ptr, message_auth);
+    // Message authenticator covers the identifier, it is calculated on send
+    data->send_radius_msg_auth_offset = radius_msg_ptr - radius_msg_start_ptr;
 
     // Store message for sending
     if (data->send_radius_msg != NULL) {
@@ -746,6 +870,30 @@ static void radius_client_sec_prot_allocate_and_create_radius_message(sec_prot_t
     data->send_radius_msg_len = radius_msg_length;
 }
 
+static int8_t radius_client_sec_prot_radius_msg_sign(sec_prot_t *prot)
+{
+    radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
+
+    if (!data->send_radius_msg || data->send_radius_msg_len == 0) {
+        return -1;
+    }
+
+    uint8_t *message_auth_ptr = data->send_radius_msg + data->send_radius_msg_auth_offset;
+    uint8_t message_auth[16];
+
+    data->send_radius_msg[1] = data->radius_identifier;
+    memset(message_auth, 0, 16); // zero for value calculation
+    avp_message_authenticator_write(message_auth_ptr, message_auth);
+    // Calculate message authenticator
+    if (radius_client_sec_prot_message_authenticator_calc(prot, data->send_radius_msg_len, data->send_radius_msg, message_auth) < 0) {
+        return -1;
+    }
+    // Write message authenticator
+    avp_message_authenticator_write(message_auth_ptr, message_auth);
+
+    return 0;
+}
+
 static int8_t radius_client_sec_prot_radius_msg_send(sec_prot_t *prot)
 {
     radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
@@ -754,7 +902,7 @@ static int8_t radius_client_sec_prot_radius_msg_send(sec_prot_t *prot)
         return -1;
     }
 
-    if (prot->conn_send(prot, data->send_radius_msg, data->send_radius_msg_len, data->radius_id_conn_num, SEC_PROT_SEND_FLAG_NO_DEALLOC) < 0) {
+    if (prot->conn_send(prot, data->send_radius_msg, data->send_radius_msg_len, 0, SEC_PROT_SEND_FLAG_NO_DEALLOC) < 0) {
         return -1;
     }
 
@@ -1017,7 +1165,25 @@ static void radius_client_sec_prot_timer_timeout(sec_prot_t *prot, uint16_t tick
 {
     radius_client_sec_prot_int_t *data = radius_client_sec_prot_get(prot);
 
-    sec_prot_timer_timeout_handle(prot, &data->common, &prot->sec_cfg->radius_cfg->radius_retry_trickle_params, ticks);
+    if (data->radius_id_set) {
+        if (data->rto_ticks > ticks) {
+            data->rto_ticks -= ticks;
+        } else if (data->retries < prot->sec_cfg->radius_cfg->radius_retry_trickle_params.TimerExpirations) {
+            // Exponential back-off from the timeout measured for the request
+            data->retries++;
+            data->rto = MIN(data->rto * 2, RADIUS_CLIENT_RTO_MAX);
+            data->rto_ticks = data->rto;
+            sec_prot_result_set(&data->common, SEC_RESULT_TIMEOUT);
+            prot->state_machine(prot);
+        } else {
+            tr_info("Radius: no response, eui-64: %s", tr_eui64(sec_prot_remote_eui_64_addr_get(prot)));
+            radius_client_sec_prot_request_done(prot, false);
+            sec_prot_result_set(&data->common, SEC_RESULT_TIMEOUT);
+            sec_prot_state_set(prot, &data->common, RADIUS_STATE_FINISH);
+        }
+    }
+
+    sec_prot_timer_timeout_handle(prot, &data->common, NULL, ticks);
 }
 
 static void radius_client_sec_prot_state_machine(sec_prot_t *prot)
@@ -1065,12 +1231,8 @@ static void radius_client_sec_prot_state_machine(sec_prot_t *prot)
         case RADIUS_STATE_SEND_INITIAL_ACCESS_REQUEST:
             tr_debug("Radius: send initial access request, eui-64: %s", tr_eui64(sec_prot_remote_eui_64_addr_get(prot)));
 
-            if (radius_client_sec_prot_radius_msg_send(prot) < 0) {
-                tr_error("Radius: msg send error");
-            }
-
-            // Start trickle timer to re-send if no response
-            sec_prot_timer_trickle_start(&data->common, &prot->sec_cfg->radius_cfg->radius_retry_trickle_params);
+            // Sends when there is room in the window, re-sends if no response
+            radius_client_sec_prot_request_submit(prot);
 
             sec_prot_state_set(prot, &data->common, RADIUS_STATE_ACCESS_ACCEPT_REJECT_CHALLENGE);
             break;
@@ -1091,8 +1253,8 @@ static void radius_client_sec_prot_state_machine(sec_prot_t *prot)
             // Free radius access-request buffer since answer received and retries not needed
             radius_client_sec_prot_radius_msg_free(prot);
 
-            // Stop trickle timer, EAP-TLS will continue and on reject/accept negotiation will end
-            sec_prot_timer_trickle_stop(&data->common);
+            // Stop retries and release the window, EAP-TLS will continue and on reject/accept negotiation will end
+            radius_client_sec_prot_request_done(prot, true);
 
             // Set timeout to wait for EAP-TLS to continue
             data->common.ticks = prot->sec_cfg->prot_cfg.sec_prot_retry_timeout;
@@ -1148,12 +1310,8 @@ static void radius_client_sec_prot_state_machine(sec_prot_t *prot)
 
             radius_client_sec_prot_allocate_and_create_radius_message(prot);
 
-            if (radius_client_sec_prot_radius_msg_send(prot) < 0) {
-                tr_error("Radius: msg send error");
-            }
-
-            // Start trickle timer to re-send if no response
-            sec_prot_timer_trickle_start(&data->common, &prot->sec_cfg->radius_cfg->radius_retry_trickle_params);
+            // Sends when there is room in the window, re-sends if no response
+            radius_client_sec_prot_request_submit(prot);
 
             sec_prot_state_set(prot, &data->common, RADIUS_STATE_ACCESS_ACCEPT_REJECT_CHALLENGE);
             break;
@@ -1179,7 +1337,7 @@ static void radius_client_sec_prot_state_machine(sec_prot_t *prot)
         case RADIUS_STATE_FINISHED: {
             tr_debug("Radius: finished, eui-64: %s", tr_eui64(sec_prot_remote_eui_64_addr_get(prot)));
 
-            radius_client_sec_prot_identifier_free(prot);
+            radius_client_sec_prot_request_done(prot, false);
 
             // Indicate to radius EAP-TLS peer protocol that radius client has been deleted
             if (data->radius_eap_tls_deleted) {
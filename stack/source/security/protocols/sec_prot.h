@@ -365,6 +365,15 @@ typedef void sec_prot_receive_disable(sec_prot_t *prot);
  */
 typedef int8_t sec_prot_receive_check(sec_prot_t *prot, const void *pdu, uint16_t size);
 
+/**
+ * sec_prot_receive_id_set sets identifier of the messages the protocol waits for
+ *
+ * \param prot protocol
+ * \param id identifier that receive check matches
+ *
+ */
+typedef void sec_prot_receive_id_set(sec_prot_t *prot, uint8_t id);
+
 typedef struct sec_prot_int_data sec_prot_int_data_t;
 
 // Security protocol data
@@ -404,6 +413,7 @@ struct sec_prot {
     sec_prot_by_type_get          *type_get;             /**< Gets security protocol by type */
     sec_prot_receive_disable      *receive_disable;      /**< Disable receiving of messages */
     sec_prot_receive_check        *receive_check;        /**< Check if messages is for this protocol */
+    sec_prot_receive_id_set       *receive_id_set;       /**< Sets identifier of the messages the protocol waits for */
 
     sec_prot_keys_t               *sec_keys;             /**< Security keys storage pointer */
     sec_cfg_t                     *sec_cfg;              /**< Security configuration configuration pointer */
@@ -64,6 +64,7 @@ typedef struct sec_radius_cfg {
     const uint8_t *radius_shared_secret;             /**< Radius shared secret */
     uint16_t radius_shared_secret_len;               /**< Radius shared secret length */
     trickle_params_t radius_retry_trickle_params;    /**< Radius retry trickle params */
+    uint8_t radius_window;                           /**< Maximum number of Access-Requests waiting for a response */
     bool radius_addr_set : 1;                        /**< Radius server address is set */
 } sec_radius_cfg_t;
 
@@ -119,6 +119,9 @@ typedef struct frame_counter {
     uint32_t frame_counter;                           /**< Current frame counter */
     uint32_t stored_frame_counter;                    /**< Stored frame counter */
     uint32_t max_frame_counter_chg;                   /**< Maximum frame counter change */
+    uint32_t checked_frame_counter;                   /**< Frame counter on previous store check */
+    uint32_t store_threshold;                         /**< Frame counter increment before it is stored */
+    uint32_t stored_threshold;                        /**< Store threshold when the frame counter was stored */
     bool set : 1;                                     /**< Value has been set */
 } frame_counter_t;
 
@@ -57,8 +57,6 @@ typedef enum {
     TLS_STATE_FINISHED = SEC_STATE_FINISHED
 } eap_tls_sec_prot_state_e;
 
-typedef struct tls_sec_prot_lib_int tls_sec_prot_lib_int_t;
-
 typedef struct tls_sec_prot_int {
     sec_prot_common_t             common;            /**< Common data */
     uint8_t                       new_pmk[PMK_LEN];  /**< New Pair Wise Master Key */
@@ -74,7 +72,7 @@ typedef struct tls_sec_prot_int {
     bool                          queued : 1;        /**< TLS is queued */
 #endif
     bool                          library_init : 1;  /**< TLS library has been initialized */
-    tls_sec_prot_lib_int_t        *tls_sec_inst;     /**< TLS security library storage, SHALL BE THE LAST FIELD */
+    tls_security_t                *tls_sec;          /**< TLS security library instance */
 } tls_sec_prot_int_t;
 
 // TLS server EC queue is currently disabled, since EC calculation is made on server in one go
@@ -105,6 +103,7 @@ static int16_t tls_sec_prot_tls_receive(void *handle, unsigned char *buf, size_t
 static void tls_sec_prot_tls_export_keys(void *handle, const uint8_t *master_secret, const uint8_t *eap_tls_key_material);
 static void tls_sec_prot_tls_set_timer(void *handle, uint32_t inter, uint32_t fin);
 static int8_t tls_sec_prot_tls_get_timer(void *handle);
+static void tls_sec_prot_tls_process_done(void *handle);
 
 static int8_t tls_sec_prot_tls_configure_and_connect(sec_prot_t *prot, bool is_server);
 
@@ -153,7 +152,7 @@ int8_t server_tls_sec_prot_register(kmp_service_t *service)
 
 static uint16_t tls_sec_prot_size(void)
 {
-    return sizeof(tls_sec_prot_int_t) + tls_sec_prot_lib_size();
+    return sizeof(tls_sec_prot_int_t);
 }
 
 static int8_t client_tls_sec_prot_init(sec_prot_t *prot)
@@ -227,7 +226,7 @@ static void tls_sec_prot_delete(sec_prot_t *prot)
     eap_tls_sec_prot_lib_message_free(&data->tls_recv);
     if (data->library_init) {
         tr_info("TLS: free library");
-        tls_sec_prot_lib_free((tls_security_t *) &data->tls_sec_inst);
+        tls_sec_prot_lib_free(data->tls_sec);
     }
     tls_sec_prot_queue_remove(prot);
 }
@@ -346,8 +345,13 @@ static void client_tls_sec_prot_state_machine(sec_prot_t *prot)
             break;
 
         case TLS_STATE_PROCESS:
-            result = tls_sec_prot_lib_process((tls_security_t *) &data->tls_sec_inst);
+            result = tls_sec_prot_lib_process(data->tls_sec);
 
+            // Handshake processed by a worker, tls_sec_prot_tls_process_done() continues
+            if (result == TLS_SEC_PROT_LIB_PENDING) {
+                data->calculating = true;
+                return;
+            }
             if (result == TLS_SEC_PROT_LIB_CALCULATING) {
                 data->calculating = true;
                 prot->state_machine_call(prot);
@@ -383,14 +387,14 @@ static void client_tls_sec_prot_state_machine(sec_prot_t *prot)
             prot->finished_ind(prot, sec_prot_result_get(&data->common), prot->sec_keys);
             sec_prot_state_set(prot, &data->common, TLS_STATE_FINISHED);
 
-            tls_sec_prot_lib_free((tls_security_t *) &data->tls_sec_inst);
+            tls_sec_prot_lib_free(data->tls_sec);
             data->library_init = false;
             break;
 
         case TLS_STATE_FINISHED:
             tr_debug("TLS: finished, free %s", data->library_init ? "T" : "F");
             if (data->library_init) {
-                tls_sec_prot_lib_free((tls_security_t *) &data->tls_sec_inst);
+                tls_sec_prot_lib_free(data->tls_sec);
                 data->library_init = false;
             }
             prot->timer_stop(prot);
@@ -465,8 +469,13 @@ static void server_tls_sec_prot_state_machine(sec_prot_t *prot)
             }
 #endif
 
-            result = tls_sec_prot_lib_process((tls_security_t *) &data->tls_sec_inst);
+            result = tls_sec_prot_lib_process(data->tls_sec);
 
+            // Handshake processed by a worker, tls_sec_prot_tls_process_done() continues
+            if (result == TLS_SEC_PROT_LIB_PENDING) {
+                data->calculating = true;
+                return;
+            }
             if (result == TLS_SEC_PROT_LIB_CALCULATING) {
                 data->calculating = true;
                 prot->state_machine_call(prot);
@@ -503,14 +512,14 @@ static void server_tls_sec_prot_state_machine(sec_prot_t *prot)
             sec_prot_state_set(prot, &data->common, TLS_STATE_FINISHED);
 
             tls_sec_prot_queue_remove(prot);
-            tls_sec_prot_lib_free((tls_security_t *) &data->tls_sec_inst);
+            tls_sec_prot_lib_free(data->tls_sec);
             data->library_init = false;
             break;
 
         case TLS_STATE_FINISHED: {
             tr_debug("TLS: finished, eui-64: %s free %s", tr_eui64(sec_prot_remote_eui_64_addr_get(prot)), data->library_init ? "T" : "F");
             if (data->library_init) {
-                tls_sec_prot_lib_free((tls_security_t *) &data->tls_sec_inst);
+                tls_sec_prot_lib_free(data->tls_sec);
                 data->library_init = false;
             }
             prot->timer_stop(prot);
@@ -639,22 +648,34 @@ static int8_t tls_sec_prot_tls_get_timer(void *handle)
     return TLS_SEC_PROT_LIB_TIMER_NO_EXPIRY;
 }
 
+static void tls_sec_prot_tls_process_done(void *handle)
+{
+    sec_prot_t *prot = handle;
+    tls_sec_prot_int_t *data = tls_sec_prot_get(prot);
+
+    // Continues without waiting for the next timer tick
+    if (data->calculating) {
+        prot->state_machine(prot);
+    }
+}
+
 static int8_t tls_sec_prot_tls_configure_and_connect(sec_prot_t *prot, bool is_server)
 {
     tls_sec_prot_int_t *data = tls_sec_prot_get(prot);
 
     // Must be free if library initialize is done
     data->library_init = true;
-    if (tls_sec_prot_lib_init((tls_security_t *)&data->tls_sec_inst) < 0) {
+    if (tls_sec_prot_lib_init(&data->tls_sec) < 0) {
         tr_error("TLS: library init fail");
         return -1;
     }
 
-    tls_sec_prot_lib_set_cb_register((tls_security_t *)&data->tls_sec_inst, prot,
+    tls_sec_prot_lib_set_cb_register(data->tls_sec, prot,
                                      tls_sec_prot_tls_send, tls_sec_prot_tls_receive, tls_sec_prot_tls_export_keys,
-                                     tls_sec_prot_tls_set_timer, tls_sec_prot_tls_get_timer);
+                                     tls_sec_prot_tls_set_timer, tls_sec_prot_tls_get_timer,
+                                     tls_sec_prot_tls_process_done);
 
-    if (tls_sec_prot_lib_connect((tls_security_t *)&data->tls_sec_inst, is_server, prot->sec_keys->certs) < 0) {
+    if (tls_sec_prot_lib_connect(data->tls_sec, is_server, prot->sec_keys->certs) < 0) {
         tr_error("TLS: library connect fail");
         return -1;
     }
@@ -20,17 +20,24 @@
 #include <string.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
 #include <mbedtls/version.h>
 #include <mbedtls/sha256.h>
 #include <mbedtls/error.h>
 #include <mbedtls/platform.h>
 #include <mbedtls/ssl_cookie.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/ssl_ciphersuites.h>
 #include <mbedtls/debug.h>
 #include <mbedtls/oid.h>
 #include "common/endian.h"
+#include "common/events_scheduler.h"
+#include "common/iobuf.h"
+#include "common/log.h"
 #include "common/rand.h"
 #include "common/trickle.h"
 #include "common/log_legacy.h"
@@ -41,6 +48,13 @@
 
 #include "security/protocols/tls_sec_prot/tls_sec_prot_lib.h"
 
+#if defined(HAVE_PAE_AUTH) && defined(MBEDTLS_SSL_CACHE_C)
+#define TLS_SEC_PROT_LIB_SESSION_CACHE
+#endif
+#if defined(HAVE_PAE_AUTH) && defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+#define TLS_SEC_PROT_LIB_SESSION_TICKETS
+#endif
+
 #define TRACE_GROUP "tlsl"
 
 #define TLS_HANDSHAKE_TIMEOUT_MIN 25000
@@ -50,6 +64,15 @@
 
 typedef int tls_sec_prot_lib_crt_verify_cb(tls_security_t *sec, mbedtls_x509_crt *crt, uint32_t *flags);
 
+enum tls_sec_prot_lib_job_state {
+    TLS_JOB_NONE,                                        /**< No handshake processing ongoing */
+    TLS_JOB_WAITING,                                     /**< Waiting for room in the worker queue */
+    TLS_JOB_QUEUED,                                      /**< Waiting for a worker thread */
+    TLS_JOB_RUNNING,                                     /**< Processed by a worker thread */
+    TLS_JOB_DONE,                                        /**< Processed, completion not notified */
+    TLS_JOB_NOTIFIED,                                    /**< Processed, completion notified */
+};
+
 struct tls_security {
     mbedtls_ssl_config             conf;                 /**< mbed TLS SSL configuration */
     mbedtls_ssl_context            ssl;                  /**< mbed TLS SSL context */
@@ -71,8 +94,73 @@ struct tls_security {
     tls_sec_prot_lib_export_keys   *export_keys;         /**< Export keys callback */
     tls_sec_prot_lib_set_timer     *set_timer;           /**< Set timer callback */
     tls_sec_prot_lib_get_timer     *get_timer;           /**< Get timer callback */
+    tls_sec_prot_lib_process_done  *process_done;        /**< Process done callback */
+
+    /* Handshake processed by a worker thread. The worker does not call the
+       callbacks above: input is read before the job is queued, output, timer
+       and keys are given to the caller once the job is done. */
+    enum tls_sec_prot_lib_job_state job_state;           /**< Worker thread job state */
+    int8_t                         job_ret;              /**< Result of the processing */
+    int8_t                         job_timer;            /**< Timer state when job was queued */
+    bool                           job_timer_set : 1;    /**< Timer has been set by the job */
+    bool                           job_keys_set : 1;     /**< Keys have been exported by the job */
+    bool                           job_abandoned : 1;    /**< Instance freed by the worker once done */
+    uint32_t                       job_timer_inter;      /**< Intermediate timeout set by the job */
+    uint32_t                       job_timer_fin;        /**< Final timeout set by the job */
+    struct iobuf_write             job_in;               /**< Received data */
+    int                            job_in_offset;        /**< Received data read by TLS */
+    struct iobuf_write             job_out;              /**< Data to send */
+    uint8_t                        job_master_secret[48];
+    uint8_t                        job_key_material[128];
+    ns_list_link_t                 job_link;             /**< Link on worker waiting, queue or done list */
 };
 
+#define TLS_WORKERS_EVENT_DONE 1
+
+static struct {
+    int threads;
+    int queue_size;
+    int queue_len;
+    int8_t tasklet_id;
+    bool event_pending;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    NS_LIST_HEAD(tls_security_t, job_link) waiting; // Only accessed by the main thread
+    NS_LIST_HEAD(tls_security_t, job_link) queue;
+    NS_LIST_HEAD(tls_security_t, job_link) done_list;
+} tls_workers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .queued = PTHREAD_COND_INITIALIZER,
+};
+
+/* Sessions of the EAP-TLS server, resumed either from the session ID (cache)
+   or from a ticket held by the supplicant. Shared by all the handshakes, so
+   accesses from the worker threads are serialized by the lock. */
+static struct {
+    pthread_mutex_t lock;
+    int cache_size;
+    int lifetime;                                        /**< Seconds, 0 if resumption is disabled */
+    uint32_t hits;
+    uint32_t misses;
+#ifdef TLS_SEC_PROT_LIB_SESSION_CACHE
+    mbedtls_ssl_cache_context cache;
+#endif
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+    bool ticket_set;
+    mbedtls_ssl_ticket_context ticket;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_entropy_context entropy;
+#endif
+} tls_sessions = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int8_t tls_sec_prot_lib_handshake(tls_security_t *sec);
+static bool tls_sec_prot_lib_job_cancel(tls_security_t *sec);
+#ifdef HAVE_PAE_AUTH
+static void tls_sec_prot_lib_sessions_configure(mbedtls_ssl_config *conf);
+#endif
+
 static void tls_sec_prot_lib_ssl_set_timer(void *ctx, uint32_t int_ms, uint32_t fin_ms);
 static int tls_sec_prot_lib_ssl_get_timer(void *ctx);
 static int tls_sec_lib_entropy_poll(void *data, unsigned char *output, size_t len, size_t *olen);
@@ -122,14 +210,27 @@ static void tls_sec_prot_lib_mem_free(void *ptr);
 #define is_server_is_not_set true
 #endif
 
-int8_t tls_sec_prot_lib_init(tls_security_t *sec)
+int8_t tls_sec_prot_lib_init(tls_security_t **sec_ptr)
 {
     const char *pers = "ws_tls";
+    tls_security_t *sec;
+
+    sec = calloc(1, sizeof(tls_security_t));
+    BUG_ON(!sec);
+    *sec_ptr = sec;
 
 #ifdef TLS_SEC_PROT_LIB_USE_MBEDTLS_PLATFORM_MEMORY
     mbedtls_platform_set_calloc_free(tls_sec_prot_lib_mem_calloc, tls_sec_prot_lib_mem_free);
 #endif
 
+    sec->job_state = TLS_JOB_NONE;
+    sec->job_timer_set = false;
+    sec->job_keys_set = false;
+    sec->job_abandoned = false;
+    memset(&sec->job_in, 0, sizeof(sec->job_in));
+    sec->job_in_offset = 0;
+    memset(&sec->job_out, 0, sizeof(sec->job_out));
+
     mbedtls_ssl_init(&sec->ssl);
     mbedtls_ssl_config_init(&sec->conf);
     mbedtls_ctr_drbg_init(&sec->ctr_drbg);
@@ -166,15 +267,10 @@ int8_t tls_sec_prot_lib_init(tls_security_t *sec)
     return 0;
 }
 
-uint16_t tls_sec_prot_lib_size(void)
-{
-    return sizeof(tls_security_t);
-}
-
 void tls_sec_prot_lib_set_cb_register(tls_security_t *sec, void *handle,
                                       tls_sec_prot_lib_send *send, tls_sec_prot_lib_receive *receive,
                                       tls_sec_prot_lib_export_keys *export_keys, tls_sec_prot_lib_set_timer *set_timer,
-                                      tls_sec_prot_lib_get_timer *get_timer)
+                                      tls_sec_prot_lib_get_timer *get_timer, tls_sec_prot_lib_process_done *process_done)
 {
     if (!sec) {
         return;
@@ -186,10 +282,15 @@ void tls_sec_prot_lib_set_cb_register(tls_security_t *sec, void *handle,
     sec->export_keys = export_keys;
     sec->set_timer = set_timer;
     sec->get_timer = get_timer;
+    sec->process_done = process_done;
 }
 
-void tls_sec_prot_lib_free(tls_security_t *sec)
+static void tls_sec_prot_lib_release(tls_security_t *sec)
 {
+    memset(sec->job_master_secret, 0, sizeof(sec->job_master_secret));
+    memset(sec->job_key_material, 0, sizeof(sec->job_key_material));
+    iobuf_free(&sec->job_in);
+    iobuf_free(&sec->job_out);
     mbedtls_x509_crt_free(&sec->cacert);
     if (sec->crl) {
         mbedtls_x509_crl_free(sec->crl);
@@ -201,6 +302,17 @@ void tls_sec_prot_lib_free(tls_security_t *sec)
     mbedtls_ctr_drbg_free(&sec->ctr_drbg);
     mbedtls_ssl_config_free(&sec->conf);
     mbedtls_ssl_free(&sec->ssl);
+    free(sec);
+}
+
+void tls_sec_prot_lib_free(tls_security_t *sec)
+{
+    if (!sec)
+        return;
+    // A worker thread still uses the instance, it frees it once done
+    if (tls_sec_prot_lib_job_cancel(sec))
+        return;
+    tls_sec_prot_lib_release(sec);
 }
 
 static int tls_sec_prot_lib_configure_certificates(tls_security_t *sec, const sec_prot_certs_t *certs)
@@ -409,6 +521,11 @@ int8_t tls_sec_prot_lib_connect(tls_security_t *sec, bool is_server, const sec_p
     mbedtls_ssl_set_verify(&sec->ssl, tls_sec_prot_lib_x509_crt_verify, sec);
 #endif
 
+#ifdef HAVE_PAE_AUTH
+    if (is_server_is_set)
+        tls_sec_prot_lib_sessions_configure(&sec->conf);
+#endif
+
     /* Currently assuming we are running fast enough HW that ECC calculations are not blocking any normal operation.
      *
      * If there is a problem with ECC calculations and those are taking too long in border router
@@ -426,7 +543,387 @@ static void tls_sec_prot_lib_debug(void *ctx, int level, const char *file, int l
 }
 #endif
 
+static void tls_sec_prot_lib_job_queue(tls_security_t *sec)
+{
+    uint8_t buf[1024];
+    int16_t len;
+
+    // Reads all received data, TLS context buffers what it does not use yet
+    while ((len = sec->receive(sec->handle, buf, sizeof(buf))) > 0)
+        iobuf_push_data(&sec->job_in, buf, len);
+    sec->job_in_offset = 0;
+    sec->job_timer = sec->get_timer(sec->handle);
+    sec->job_timer_set = false;
+    sec->job_keys_set = false;
+    sec->job_state = TLS_JOB_QUEUED;
+    ns_list_add_to_end(&tls_workers.queue, sec);
+    tls_workers.queue_len++;
+    pthread_cond_signal(&tls_workers.queued);
+}
+
+static void tls_sec_prot_lib_job_complete(tls_security_t *sec)
+{
+    if (sec->job_out.len && sec->send(sec->handle, sec->job_out.data, sec->job_out.len) != sec->job_out.len) {
+        tr_error("TLS send fail");
+        sec->job_ret = TLS_SEC_PROT_LIB_ERROR;
+    }
+    if (sec->job_timer_set)
+        sec->set_timer(sec->handle, sec->job_timer_inter, sec->job_timer_fin);
+    if (sec->job_keys_set)
+        sec->export_keys(sec->handle, sec->job_master_secret, sec->job_key_material);
+    memset(sec->job_master_secret, 0, sizeof(sec->job_master_secret));
+    memset(sec->job_key_material, 0, sizeof(sec->job_key_material));
+    iobuf_free(&sec->job_in);
+    iobuf_free(&sec->job_out);
+}
+
+// Return true if the job is running, the worker then frees the instance
+static bool tls_sec_prot_lib_job_cancel(tls_security_t *sec)
+{
+    bool abandoned = false;
+
+    if (!tls_workers.threads)
+        return false;
+
+    pthread_mutex_lock(&tls_workers.lock);
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        sec->job_abandoned = true;
+        abandoned = true;
+    } else if (sec->job_state == TLS_JOB_WAITING) {
+        ns_list_remove(&tls_workers.waiting, sec);
+    } else if (sec->job_state == TLS_JOB_QUEUED) {
+        ns_list_remove(&tls_workers.queue, sec);
+        tls_workers.queue_len--;
+    } else if (sec->job_state == TLS_JOB_DONE) {
+        ns_list_remove(&tls_workers.done_list, sec);
+    }
+    if (!abandoned)
+        sec->job_state = TLS_JOB_NONE;
+    pthread_mutex_unlock(&tls_workers.lock);
+    return abandoned;
+}
+
+static void *tls_sec_prot_lib_worker(void *arg)
+{
+    tls_security_t *sec;
+    int8_t ret;
+
+    pthread_mutex_lock(&tls_workers.lock);
+    for (;;) {
+        sec = ns_list_get_first(&tls_workers.queue);
+        if (!sec) {
+            pthread_cond_wait(&tls_workers.queued, &tls_workers.lock);
+            continue;
+        }
+        ns_list_remove(&tls_workers.queue, sec);
+        tls_workers.queue_len--;
+        sec->job_state = TLS_JOB_RUNNING;
+        pthread_mutex_unlock(&tls_workers.lock);
+
+        ret = tls_sec_prot_lib_handshake(sec);
+
+        pthread_mutex_lock(&tls_workers.lock);
+        if (sec->job_abandoned) {
+            pthread_mutex_unlock(&tls_workers.lock);
+            tls_sec_prot_lib_release(sec);
+            pthread_mutex_lock(&tls_workers.lock);
+            continue;
+        }
+        sec->job_ret = ret;
+        sec->job_state = TLS_JOB_DONE;
+        ns_list_add_to_end(&tls_workers.done_list, sec);
+        if (!tls_workers.event_pending) {
+            tls_workers.event_pending = true;
+            event_send_from_thread(&(struct event_payload) {
+                .receiver = tls_workers.tasklet_id,
+                .event_type = TLS_WORKERS_EVENT_DONE,
+                .priority = ARM_LIB_MED_PRIORITY_EVENT,
+            });
+        }
+    }
+    return NULL;
+}
+
+static void tls_sec_prot_lib_workers_event_handler(struct event_payload *event)
+{
+    tls_security_t *sec;
+
+    if (event->event_type != TLS_WORKERS_EVENT_DONE)
+        return;
+
+    // Jobs have left the queue, admit the waiting ones
+    pthread_mutex_lock(&tls_workers.lock);
+    while (tls_workers.queue_len < tls_workers.queue_size &&
+           (sec = ns_list_get_first(&tls_workers.waiting))) {
+        ns_list_remove(&tls_workers.waiting, sec);
+        tls_sec_prot_lib_job_queue(sec);
+    }
+    pthread_mutex_unlock(&tls_workers.lock);
+
+    for (;;) {
+        pthread_mutex_lock(&tls_workers.lock);
+        sec = ns_list_get_first(&tls_workers.done_list);
+        if (sec) {
+            ns_list_remove(&tls_workers.done_list, sec);
+            sec->job_state = TLS_JOB_NOTIFIED;
+        } else {
+            tls_workers.event_pending = false;
+        }
+        pthread_mutex_unlock(&tls_workers.lock);
+        if (!sec)
+            break;
+        // May free the instance
+        if (sec->process_done)
+            sec->process_done(sec->handle);
+    }
+}
+
+void tls_sec_prot_lib_workers_start(int threads, int queue_size)
+{
+    sigset_t set, oldset;
+    pthread_t thread;
+    int ret;
+
+    BUG_ON(tls_workers.threads);
+    if (!threads)
+        return;
+    ns_list_init(&tls_workers.waiting);
+    ns_list_init(&tls_workers.queue);
+    ns_list_init(&tls_workers.done_list);
+    tls_workers.queue_size = queue_size;
+    tls_workers.tasklet_id = event_handler_create(tls_sec_prot_lib_workers_event_handler, 0);
+    // Signals must be handled by the main thread
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &oldset);
+    for (int i = 0; i < threads; i++) {
+        ret = pthread_create(&thread, NULL, tls_sec_prot_lib_worker, NULL);
+        FATAL_ON(ret, 2, "pthread_create: %s", strerror(ret));
+        pthread_detach(thread);
+    }
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+    tls_workers.threads = threads;
+    INFO("EAP-TLS handshakes processed by %d threads", threads);
+}
+
+#ifdef TLS_SEC_PROT_LIB_SESSION_CACHE
+#if (MBEDTLS_VERSION_MAJOR >= 3)
+static int tls_sec_prot_lib_cache_get(void *data, unsigned char const *session_id,
+                                      size_t session_id_len, mbedtls_ssl_session *session)
+#else
+static int tls_sec_prot_lib_cache_get(void *data, mbedtls_ssl_session *session)
+#endif
+{
+    int ret;
+
+    pthread_mutex_lock(&tls_sessions.lock);
+#if (MBEDTLS_VERSION_MAJOR >= 3)
+    ret = mbedtls_ssl_cache_get(data, session_id, session_id_len, session);
+#else
+    ret = mbedtls_ssl_cache_get(data, session);
+#endif
+    if (ret)
+        tls_sessions.misses++;
+    else
+        tls_sessions.hits++;
+    pthread_mutex_unlock(&tls_sessions.lock);
+    return ret;
+}
+
+#if (MBEDTLS_VERSION_MAJOR >= 3)
+static int tls_sec_prot_lib_cache_set(void *data, unsigned char const *session_id,
+                                      size_t session_id_len, const mbedtls_ssl_session *session)
+#else
+static int tls_sec_prot_lib_cache_set(void *data, const mbedtls_ssl_session *session)
+#endif
+{
+    int ret;
+
+    pthread_mutex_lock(&tls_sessions.lock);
+#if (MBEDTLS_VERSION_MAJOR >= 3)
+    ret = mbedtls_ssl_cache_set(data, session_id, session_id_len, session);
+#else
+    ret = mbedtls_ssl_cache_set(data, session);
+#endif
+    pthread_mutex_unlock(&tls_sessions.lock);
+    return ret;
+}
+#endif
+
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+static int tls_sec_prot_lib_ticket_write(void *p_ticket, const mbedtls_ssl_session *session,
+                                         unsigned char *start, const unsigned char *end,
+                                         size_t *tlen, uint32_t *lifetime)
+{
+    int ret;
+
+    pthread_mutex_lock(&tls_sessions.lock);
+    ret = mbedtls_ssl_ticket_write(p_ticket, session, start, end, tlen, lifetime);
+    pthread_mutex_unlock(&tls_sessions.lock);
+    return ret;
+}
+
+static int tls_sec_prot_lib_ticket_parse(void *p_ticket, mbedtls_ssl_session *session,
+                                         unsigned char *buf, size_t len)
+{
+    int ret;
+
+    pthread_mutex_lock(&tls_sessions.lock);
+    ret = mbedtls_ssl_ticket_parse(p_ticket, session, buf, len);
+    if (ret)
+        tls_sessions.misses++;
+    else
+        tls_sessions.hits++;
+    pthread_mutex_unlock(&tls_sessions.lock);
+    return ret;
+}
+#endif
+
+// Must be called with the lock held
+static void tls_sec_prot_lib_sessions_setup(void)
+{
+#ifdef TLS_SEC_PROT_LIB_SESSION_CACHE
+    mbedtls_ssl_cache_init(&tls_sessions.cache);
+    mbedtls_ssl_cache_set_max_entries(&tls_sessions.cache, tls_sessions.cache_size);
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_ssl_cache_set_timeout(&tls_sessions.cache, tls_sessions.lifetime);
+#endif
+#endif
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+    // A new ticket key is drawn, so the tickets already issued are rejected
+    mbedtls_ssl_ticket_init(&tls_sessions.ticket);
+    tls_sessions.ticket_set = !mbedtls_ssl_ticket_setup(&tls_sessions.ticket, mbedtls_ctr_drbg_random,
+                                                        &tls_sessions.ctr_drbg, MBEDTLS_CIPHER_AES_128_CCM,
+                                                        tls_sessions.lifetime);
+    WARN_ON(!tls_sessions.ticket_set, "EAP-TLS session tickets unavailable");
+#endif
+}
+
+// Must be called with the lock held
+static void tls_sec_prot_lib_sessions_teardown(void)
+{
+#ifdef TLS_SEC_PROT_LIB_SESSION_CACHE
+    mbedtls_ssl_cache_free(&tls_sessions.cache);
+#endif
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+    mbedtls_ssl_ticket_free(&tls_sessions.ticket);
+    tls_sessions.ticket_set = false;
+#endif
+}
+
+void tls_sec_prot_lib_sessions_init(int cache_size, int lifetime)
+{
+    BUG_ON(tls_sessions.lifetime);
+    if (!lifetime)
+        return;
+#if !defined(TLS_SEC_PROT_LIB_SESSION_CACHE) && !defined(TLS_SEC_PROT_LIB_SESSION_TICKETS)
+    WARN("EAP-TLS session resumption not supported by mbedtls");
+#else
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+    mbedtls_ctr_drbg_init(&tls_sessions.ctr_drbg);
+    mbedtls_entropy_init(&tls_sessions.entropy);
+    // See tls_sec_prot_lib_init()
+#if (MBEDTLS_VERSION_MAJOR >= 3)
+    tls_sessions.entropy.private_source_count = 0;
+#else
+    tls_sessions.entropy.source_count = 0;
+#endif
+    if (mbedtls_entropy_add_source(&tls_sessions.entropy, tls_sec_lib_entropy_poll, NULL,
+                                   128, MBEDTLS_ENTROPY_SOURCE_STRONG) < 0 ||
+        mbedtls_ctr_drbg_seed(&tls_sessions.ctr_drbg, mbedtls_entropy_func, &tls_sessions.entropy,
+                              (const unsigned char *)"ws_tls_ticket", strlen("ws_tls_ticket")))
+        FATAL(1, "%s: drbg seed fail", __func__);
+#endif
+    pthread_mutex_lock(&tls_sessions.lock);
+    tls_sessions.cache_size = cache_size;
+    tls_sessions.lifetime = lifetime;
+    tls_sec_prot_lib_sessions_setup();
+    pthread_mutex_unlock(&tls_sessions.lock);
+    INFO("EAP-TLS session resumption for %d seconds (cache size %d)", lifetime, cache_size);
+#endif
+}
+
+void tls_sec_prot_lib_sessions_flush(void)
+{
+    if (!tls_sessions.lifetime)
+        return;
+    pthread_mutex_lock(&tls_sessions.lock);
+    tls_sec_prot_lib_sessions_teardown();
+    tls_sec_prot_lib_sessions_setup();
+    pthread_mutex_unlock(&tls_sessions.lock);
+    INFO("EAP-TLS sessions flushed");
+}
+
+void tls_sec_prot_lib_sessions_stats(uint32_t *hits, uint32_t *misses)
+{
+    pthread_mutex_lock(&tls_sessions.lock);
+    *hits = tls_sessions.hits;
+    *misses = tls_sessions.misses;
+    pthread_mutex_unlock(&tls_sessions.lock);
+}
+
+#ifdef HAVE_PAE_AUTH
+static void tls_sec_prot_lib_sessions_configure(mbedtls_ssl_config *conf)
+{
+    if (!tls_sessions.lifetime)
+        return;
+#ifdef TLS_SEC_PROT_LIB_SESSION_CACHE
+    if (tls_sessions.cache_size)
+        mbedtls_ssl_conf_session_cache(conf, &tls_sessions.cache,
+                                       tls_sec_prot_lib_cache_get, tls_sec_prot_lib_cache_set);
+#endif
+#ifdef TLS_SEC_PROT_LIB_SESSION_TICKETS
+    if (tls_sessions.ticket_set)
+        mbedtls_ssl_conf_session_tickets_cb(conf, tls_sec_prot_lib_ticket_write,
+                                            tls_sec_prot_lib_ticket_parse, &tls_sessions.ticket);
+#endif
+}
+#endif
+
 int8_t tls_sec_prot_lib_process(tls_security_t *sec)
+{
+    bool completed = false;
+    int8_t ret;
+
+    if (!tls_workers.threads)
+        return tls_sec_prot_lib_handshake(sec);
+
+    pthread_mutex_lock(&tls_workers.lock);
+    switch (sec->job_state) {
+    case TLS_JOB_NONE:
+        // If queue is full, queued when a job completes
+        if (tls_workers.queue_len < tls_workers.queue_size) {
+            tls_sec_prot_lib_job_queue(sec);
+        } else {
+            sec->job_state = TLS_JOB_WAITING;
+            ns_list_add_to_end(&tls_workers.waiting, sec);
+        }
+        ret = TLS_SEC_PROT_LIB_PENDING;
+        break;
+    case TLS_JOB_WAITING:
+    case TLS_JOB_QUEUED:
+    case TLS_JOB_RUNNING:
+        ret = TLS_SEC_PROT_LIB_PENDING;
+        break;
+    case TLS_JOB_DONE:
+        ns_list_remove(&tls_workers.done_list, sec);
+        // fall through
+    case TLS_JOB_NOTIFIED:
+    default:
+        sec->job_state = TLS_JOB_NONE;
+        completed = true;
+        ret = sec->job_ret;
+        break;
+    }
+    pthread_mutex_unlock(&tls_workers.lock);
+
+    if (completed) {
+        tls_sec_prot_lib_job_complete(sec);
+        ret = sec->job_ret;
+    }
+    return ret;
+}
+
+static int8_t tls_sec_prot_lib_handshake(tls_security_t *sec)
 {
     int32_t ret = -1;
 
@@ -459,25 +956,57 @@ int8_t tls_sec_prot_lib_process(tls_security_t *sec)
 static void tls_sec_prot_lib_ssl_set_timer(void *ctx, uint32_t int_ms, uint32_t fin_ms)
 {
     tls_security_t *sec = (tls_security_t *)ctx;
+
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        sec->job_timer_set = true;
+        sec->job_timer_inter = int_ms;
+        sec->job_timer_fin = fin_ms;
+        return;
+    }
     sec->set_timer(sec->handle, int_ms, fin_ms);
 }
 
 static int tls_sec_prot_lib_ssl_get_timer(void *ctx)
 {
     tls_security_t *sec = (tls_security_t *)ctx;
+
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        if (!sec->job_timer_set)
+            return sec->job_timer;
+        if (!sec->job_timer_fin)
+            return TLS_SEC_PROT_LIB_TIMER_CANCELLED;
+        return TLS_SEC_PROT_LIB_TIMER_NO_EXPIRY;
+    }
     return sec->get_timer(sec->handle);
 }
 
 static int tls_sec_prot_lib_ssl_send(void *ctx, const unsigned char *buf, size_t len)
 {
     tls_security_t *sec = (tls_security_t *)ctx;
+
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        iobuf_push_data(&sec->job_out, buf, len);
+        return len;
+    }
     return sec->send(sec->handle, buf, len);
 }
 
 static int tls_sec_prot_lib_ssl_recv(void *ctx, unsigned char *buf, size_t len)
 {
     tls_security_t *sec = (tls_security_t *)ctx;
-    int16_t ret = sec->receive(sec->handle, buf, len);
+    int16_t ret;
+
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        if (len > sec->job_in.len - sec->job_in_offset)
+            len = sec->job_in.len - sec->job_in_offset;
+        if (!len)
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        memcpy(buf, sec->job_in.data + sec->job_in_offset, len);
+        sec->job_in_offset += len;
+        return len;
+    }
+
+    ret = sec->receive(sec->handle, buf, len);
 
     if (ret == TLS_SEC_PROT_LIB_NO_DATA) {
         return MBEDTLS_ERR_SSL_WANT_READ;
@@ -528,7 +1057,13 @@ static int tls_sec_prot_lib_ssl_export_keys(void *p_expkey, const unsigned char
 #endif
     }
 
-    sec->export_keys(sec->handle, secret, eap_tls_key_material);
+    if (sec->job_state == TLS_JOB_RUNNING) {
+        memcpy(sec->job_master_secret, secret, sizeof(sec->job_master_secret));
+        memcpy(sec->job_key_material, eap_tls_key_material, sizeof(sec->job_key_material));
+        sec->job_keys_set = true;
+    } else {
+        sec->export_keys(sec->handle, secret, eap_tls_key_material);
+    }
 
 #if (MBEDTLS_VERSION_MAJOR < 3)
     return 0;
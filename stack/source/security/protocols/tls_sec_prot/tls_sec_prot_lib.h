@@ -35,6 +35,7 @@ typedef enum {
     TLS_SEC_PROT_LIB_CONTINUE = 0,
     TLS_SEC_PROT_LIB_CALCULATING,
     TLS_SEC_PROT_LIB_HANDSHAKE_OVER,
+    TLS_SEC_PROT_LIB_PENDING,
 } tls_sec_prot_lib_ret_e;
 
 typedef enum {
@@ -48,21 +49,15 @@ typedef enum {
 #define ECC_CALCULATION_MAX_OPS            200
 
 /**
- * tls_sec_prot_lib_init initialize security library
+ * tls_sec_prot_lib_init allocate and initialize security library
  *
- * \param sec security library instance
+ * \param sec security library instance, to be freed with tls_sec_prot_lib_free()
+ *            even if the initialization fails
  *
  * \return < 0 failure
  * \return >= 0 success
  */
-int8_t tls_sec_prot_lib_init(tls_security_t *sec);
-
-/**
- * tls_sec_prot_lib_size get security library instance size
- *
- * \return size
- */
-uint16_t tls_sec_prot_lib_size(void);
+int8_t tls_sec_prot_lib_init(tls_security_t **sec);
 
 /**
  * tls_sec_prot_lib_send send data callback
@@ -120,6 +115,16 @@ typedef int8_t tls_sec_prot_lib_get_timer(void *handle);
  */
 typedef void tls_sec_prot_lib_export_keys(void *handle, const uint8_t *master_secret, const uint8_t *eap_tls_key_material);
 
+/**
+ * tls_sec_prot_lib_process_done processing made by a worker thread has completed
+ *
+ * \param handle caller defined handle
+ *
+ * Caller should call tls_sec_prot_lib_process() to get the result.
+ *
+ */
+typedef void tls_sec_prot_lib_process_done(void *handle);
+
 /**
  * tls_sec_prot_lib_set_cb_register register callbacks to library
  *
@@ -130,18 +135,22 @@ typedef void tls_sec_prot_lib_export_keys(void *handle, const uint8_t *master_se
  * \param export_keys export keys callback
  * \param set_timer set timer callback
  * \param get_timer get timer callback
+ * \param process_done process done callback
  *
  */
 void tls_sec_prot_lib_set_cb_register(tls_security_t *sec, void *handle,
                                       tls_sec_prot_lib_send *send, tls_sec_prot_lib_receive *receive,
                                       tls_sec_prot_lib_export_keys *export_keys, tls_sec_prot_lib_set_timer *set_timer,
-                                      tls_sec_prot_lib_get_timer *get_timer);
+                                      tls_sec_prot_lib_get_timer *get_timer, tls_sec_prot_lib_process_done *process_done);
 
 /**
- * tls_sec_prot_lib_free free security library internal data (e.g. TLS data)
+ * tls_sec_prot_lib_free free security library instance
  *
  * \param sec security library instance
  *
+ * If a worker thread is processing the handshake, the instance is freed by
+ * the worker once it is done. No callback is called anymore.
+ *
  */
 void tls_sec_prot_lib_free(tls_security_t *sec);
 
@@ -166,8 +175,52 @@ int8_t tls_sec_prot_lib_connect(tls_security_t *sec, bool is_server, const sec_p
  * \return TLS_SEC_PROT_LIB_CONTINUE continue processing (send output message)
  * \return TLS_SEC_PROT_LIB_CALCULATING calculation ongoing, call process again
  * \return TLS_SEC_PROT_LIB_HANDSHAKE_OVER handshake completed successfully
+ * \return TLS_SEC_PROT_LIB_PENDING processed by a worker thread, wait for process done
+ *
+ * If worker threads are started, the handshake is processed by a worker thread
+ * and TLS_SEC_PROT_LIB_PENDING is returned until it has completed. The caller
+ * must not poll: process done callback is called when the result is available.
  *
  */
 int8_t tls_sec_prot_lib_process(tls_security_t *sec);
 
+/**
+ * tls_sec_prot_lib_workers_start start worker threads for TLS handshakes
+ *
+ * \param threads number of worker threads, 0 to process handshakes on the calling thread
+ * \param queue_size maximum number of handshakes waiting for a worker thread
+ *
+ * Must be called after the event scheduler is initialized.
+ *
+ */
+void tls_sec_prot_lib_workers_start(int threads, int queue_size);
+
+/**
+ * tls_sec_prot_lib_sessions_init enable resumption of EAP-TLS server sessions
+ *
+ * \param cache_size maximum number of sessions resumable from their session ID,
+ *                   0 to only use session tickets
+ * \param lifetime session and ticket lifetime in seconds, 0 disables resumption
+ *
+ */
+void tls_sec_prot_lib_sessions_init(int cache_size, int lifetime);
+
+/**
+ * tls_sec_prot_lib_sessions_flush forget all the resumable sessions
+ *
+ * Called when access is revoked, so a revoked supplicant cannot skip the
+ * certificate verification by resuming a session.
+ *
+ */
+void tls_sec_prot_lib_sessions_flush(void);
+
+/**
+ * tls_sec_prot_lib_sessions_stats get session resumption statistics
+ *
+ * \param hits sessions resumed from the cache or a ticket
+ * \param misses resumptions attempted with an unknown session or invalid ticket
+ *
+ */
+void tls_sec_prot_lib_sessions_stats(uint32_t *hits, uint32_t *misses);
+
 #endif
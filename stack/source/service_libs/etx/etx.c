@@ -33,13 +33,13 @@
 #define TRACE_GROUP "etx"
 
 typedef struct ext_neigh_info {
-    uint8_t attribute_index;
+    uint16_t attribute_index;
     const uint8_t *mac64;
 } ext_neigh_info_t;
 
 static uint16_t etx_current_calc(uint16_t etx, uint8_t accumulated_failures);
 static void etx_value_change_callback_needed_check(uint16_t etx, uint16_t *stored_diff_etx, uint8_t accumulated_failures, ext_neigh_info_t *etx_neigh_info);
-static void etx_cache_entry_init(uint8_t attribute_index);
+static void etx_cache_entry_init(uint16_t attribute_index);
 
 #if ETX_ACCELERATED_SAMPLE_COUNT == 0 || ETX_ACCELERATED_SAMPLE_COUNT > 6
 #error "ETX_ACCELERATED_SAMPLE_COUNT accepted values 1-6"
@@ -64,7 +64,7 @@ typedef struct ext_info {
     uint16_t init_etx_sample_count;
     uint8_t accum_threshold;
     uint8_t etx_min_sampling_time;
-    uint8_t ext_storage_list_size;
+    uint16_t ext_storage_list_size;
     uint8_t min_attempts_count;
     uint8_t drop_bad_max;
     uint8_t bad_link_level;
@@ -138,7 +138,7 @@ static void etx_calculation(etx_storage_t *entry, uint16_t attempts, uint8_t ack
     }
 }
 
-static void etx_cache_entry_init(uint8_t attribute_index)
+static void etx_cache_entry_init(uint16_t attribute_index)
 {
     if (!etx_info.cache_sample_requested) {
         return;
@@ -183,7 +183,7 @@ static bool etx_update_possible(etx_sample_storage_t *storage, etx_storage_t *en
 }
 
 
-static etx_sample_storage_t *etx_cache_sample_update(uint8_t attribute_index, uint8_t attempts, bool ack_rx)
+static etx_sample_storage_t *etx_cache_sample_update(uint16_t attribute_index, uint8_t attempts, bool ack_rx)
 {
     etx_sample_storage_t *storage = etx_info.etx_cache_storage_list + attribute_index;
     storage->attempts_count += attempts;
@@ -228,7 +228,7 @@ static bool etx_drop_bad_sample(etx_storage_t *entry, uint8_t attempts, bool suc
  * \param addr_type address type, ADDR_802_15_4_SHORT or ADDR_802_15_4_LONG
  * \param addr_ptr PAN ID with 802.15.4 address
  */
-void etx_transm_attempts_update(int8_t interface_id, uint8_t attempts, bool success, uint8_t attribute_index, const uint8_t *mac64_addr_ptr)
+void etx_transm_attempts_update(int8_t interface_id, uint8_t attempts, bool success, uint16_t attribute_index, const uint8_t *mac64_addr_ptr)
 {
     uint8_t accumulated_failures;
     // Gets table entry
@@ -314,7 +314,7 @@ uint16_t etx_read(int8_t interface_id, addrtype_e addr_type, const uint8_t *addr
         return interface->etx_read_override(interface, addr_type, addr_ptr);
     }
 
-    uint8_t attribute_index;
+    uint16_t attribute_index;
 
     //Must Support old MLE table and new still same time
     mac_neighbor_table_entry_t *mac_neighbor = mac_neighbor_table_address_discover(interface->mac_parameters.mac_neighbor_table, addr_ptr + PAN_ID_LEN, addr_type);
@@ -345,7 +345,7 @@ uint16_t etx_read(int8_t interface_id, addrtype_e addr_type, const uint8_t *addr
  * \return 0x0100 to 0xFFFF incoming IDR value (8 bit fraction)
  * \return 0x0000 address unknown
  */
-uint16_t etx_local_etx_read(int8_t interface_id, uint8_t attribute_index)
+uint16_t etx_local_etx_read(int8_t interface_id, uint16_t attribute_index)
 {
     etx_storage_t *entry = etx_storage_entry_get(interface_id, attribute_index);
     if (!entry) {
@@ -415,7 +415,7 @@ uint8_t etx_value_change_callback_register(int8_t interface_id, uint16_t hystere
     }
 }
 
-bool etx_storage_list_allocate(int8_t interface_id, uint8_t etx_storage_size)
+bool etx_storage_list_allocate(int8_t interface_id, uint16_t etx_storage_size)
 {
     if (!etx_storage_size) {
         free(etx_info.etx_storage_list);
@@ -447,7 +447,7 @@ bool etx_storage_list_allocate(int8_t interface_id, uint8_t etx_storage_size)
     etx_info.ext_storage_list_size = etx_storage_size;
     etx_info.interface_id = interface_id;
     etx_storage_t *list_ptr = etx_info.etx_storage_list;
-    for (uint8_t i = 0; i < etx_storage_size; i++) {
+    for (uint16_t i = 0; i < etx_storage_size; i++) {
         memset(list_ptr, 0, sizeof(etx_storage_t));
 
         list_ptr++;
@@ -477,7 +477,7 @@ bool etx_cached_etx_parameter_set(uint8_t min_wait_time, uint8_t etx_min_attempt
             }
             etx_info.cache_sample_requested = true;
             etx_sample_storage_t *sample_list = etx_info.etx_cache_storage_list;
-            for (uint8_t i = 0; i < etx_info.ext_storage_list_size; i++) {
+            for (uint16_t i = 0; i < etx_info.ext_storage_list_size; i++) {
                 memset(sample_list, 0, sizeof(etx_sample_storage_t));
                 sample_list++;
             }
@@ -547,7 +547,7 @@ void etx_max_set(uint16_t etx_max)
     }
 }
 
-etx_storage_t *etx_storage_entry_get(int8_t interface_id, uint8_t attribute_index)
+etx_storage_t *etx_storage_entry_get(int8_t interface_id, uint16_t attribute_index)
 {
     if (etx_info.interface_id != interface_id || !etx_info.etx_storage_list || attribute_index >= etx_info.ext_storage_list_size) {
         return NULL;
@@ -612,7 +612,7 @@ static void etx_value_change_callback_needed_check(uint16_t etx, uint16_t *store
  * \param mac64_addr_ptr long MAC address
  *
  */
-void etx_neighbor_remove(int8_t interface_id, uint8_t attribute_index, const uint8_t *mac64_addr_ptr)
+void etx_neighbor_remove(int8_t interface_id, uint16_t attribute_index, const uint8_t *mac64_addr_ptr)
 {
 
     //tr_debug("Remove attribute %u", attribute_index);
@@ -83,7 +83,7 @@ typedef struct etx_sample_storage {
  * \param attribute_index Neighbour attribute index
  * \param mac64_addr_ptr Neighbour MAC64
  */
-void etx_transm_attempts_update(int8_t interface_id, uint8_t attempts, bool success, uint8_t attribute_index, const uint8_t *mac64_addr_ptr);
+void etx_transm_attempts_update(int8_t interface_id, uint8_t attempts, bool success, uint16_t attribute_index, const uint8_t *mac64_addr_ptr);
 
 /**
  * \brief A function to read ETX value
@@ -111,7 +111,7 @@ uint16_t etx_read(int8_t interface_id, enum addrtype addr_type, const uint8_t *a
  * \return 0x0100 to 0xFFFF ETX value (8 bit fraction)
  * \return 0x0000 address unknown
  */
-uint16_t etx_local_etx_read(int8_t interface_id, uint8_t attribute_index);
+uint16_t etx_local_etx_read(int8_t interface_id, uint16_t attribute_index);
 
 /**
  * \brief A function callback that indicates ETX value change
@@ -126,7 +126,7 @@ uint16_t etx_local_etx_read(int8_t interface_id, uint8_t attribute_index);
  * \param mac64_addr_ptr Pointer to MAC64 for given etx update
  *
  */
-typedef void (etx_value_change_handler_t)(int8_t nwk_id, uint16_t previous_etx, uint16_t current_etx, uint8_t attribute_index, const uint8_t *mac64_addr_ptr);
+typedef void (etx_value_change_handler_t)(int8_t nwk_id, uint16_t previous_etx, uint16_t current_etx, uint16_t attribute_index, const uint8_t *mac64_addr_ptr);
 
 /**
  * \brief A function to register ETX value change callback
@@ -152,7 +152,7 @@ uint8_t etx_value_change_callback_register(int8_t interface_id, uint16_t hystere
  * \return false Allocate fail
  * \return true Allocate OK
  */
-bool etx_storage_list_allocate(int8_t interface_id, uint8_t etx_storage_size);
+bool etx_storage_list_allocate(int8_t interface_id, uint16_t etx_storage_size);
 
 /**
  * \brief A function to read ETX storage for defined neighbour
@@ -163,7 +163,7 @@ bool etx_storage_list_allocate(int8_t interface_id, uint8_t etx_storage_size);
  * \return Pointer to ETX storage
  * \return NULL When unknow interface or attribute
  */
-etx_storage_t *etx_storage_entry_get(int8_t interface_id, uint8_t attribute_index);
+etx_storage_t *etx_storage_entry_get(int8_t interface_id, uint16_t attribute_index);
 
 /**
  * \brief A function to remove ETX neighbor
@@ -175,7 +175,7 @@ etx_storage_t *etx_storage_entry_get(int8_t interface_id, uint8_t attribute_inde
  * \param mac64_addr_ptr Neighbour MAC64
  *
  */
-void etx_neighbor_remove(int8_t interface_id, uint8_t attribute_index, const uint8_t *mac64_addr_ptr);
+void etx_neighbor_remove(int8_t interface_id, uint16_t attribute_index, const uint8_t *mac64_addr_ptr);
 
 /**
  * \brief A function for update cached ETX calculation
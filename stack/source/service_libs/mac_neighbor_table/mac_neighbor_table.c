@@ -22,6 +22,8 @@
 #include <stdlib.h>
 #include "common/log_legacy.h"
 #include "common/endian.h"
+#include "common/utils.h"
+#include "service_libs/fnv_hash/fnv_hash.h"
 #include "service_libs/mac_neighbor_table/mac_neighbor_table.h"
 #include "stack/mac/platform/topo_trace.h"
 #include "stack/mac/fhss_ws_extension.h"
@@ -29,7 +31,62 @@
 
 #include "core/ns_address_internal.h"
 
-mac_neighbor_table_t *mac_neighbor_table_create(uint8_t table_size, neighbor_entry_remove_notify *remove_cb, neighbor_entry_nud_notify *nud_cb, void *user_indentifier)
+static mac_neighbor_table_entry_t **mac_neighbor_table_mac64_bucket(mac_neighbor_table_t *table_class, const uint8_t mac64[8])
+{
+    return &table_class->mac64_hash[fnv_hash_1a_32_reverse_block(mac64, 8) % MAC_NEIGHBOR_HASH_SIZE];
+}
+
+static mac_neighbor_table_entry_t **mac_neighbor_table_mac16_bucket(mac_neighbor_table_t *table_class, uint16_t mac16)
+{
+    return &table_class->mac16_hash[mac16 % MAC_NEIGHBOR_HASH_SIZE];
+}
+
+static void mac_neighbor_table_mac16_unlink(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *entry)
+{
+    mac_neighbor_table_entry_t **prev;
+
+    if (entry->mac16 == 0xffff)
+        return;
+    prev = mac_neighbor_table_mac16_bucket(table_class, entry->mac16);
+    while (*prev && *prev != entry)
+        prev = &(*prev)->mac16_hash_next;
+    if (*prev)
+        *prev = entry->mac16_hash_next;
+    entry->mac16_hash_next = NULL;
+}
+
+static void mac_neighbor_table_mac64_unlink(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *entry)
+{
+    mac_neighbor_table_entry_t **prev = mac_neighbor_table_mac64_bucket(table_class, entry->mac64);
+
+    while (*prev && *prev != entry)
+        prev = &(*prev)->mac64_hash_next;
+    if (*prev)
+        *prev = entry->mac64_hash_next;
+    entry->mac64_hash_next = NULL;
+}
+
+static void mac_neighbor_table_wheel_insert(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *entry, uint32_t deadline)
+{
+    // Slots are only visited for the seconds still to come
+    if (deadline <= table_class->time_now)
+        deadline = table_class->time_now + 1;
+    entry->wheel_deadline = deadline;
+    entry->wheel_linked = true;
+    ns_list_add_to_end(&table_class->wheel[deadline % MAC_NEIGHBOR_WHEEL_SIZE], entry);
+}
+
+static void mac_neighbor_table_wheel_unlink(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *entry)
+{
+    if (entry->wheel_linked)
+        ns_list_remove(&table_class->wheel[entry->wheel_deadline % MAC_NEIGHBOR_WHEEL_SIZE], entry);
+    entry->wheel_linked = false;
+    if (entry->nud_polled)
+        ns_list_remove(&table_class->nud_poll_list, entry);
+    entry->nud_polled = false;
+}
+
+mac_neighbor_table_t *mac_neighbor_table_create(uint16_t table_size, neighbor_entry_remove_notify *remove_cb, neighbor_entry_nud_notify *nud_cb, void *user_indentifier)
 {
     mac_neighbor_table_t *table_class = malloc(sizeof(mac_neighbor_table_t) + sizeof(mac_neighbor_table_entry_t) * table_size);
     if (!table_class) {
@@ -44,7 +101,10 @@ mac_neighbor_table_t *mac_neighbor_table_create(uint8_t table_size, neighbor_ent
     table_class->user_remove_notify_cb = remove_cb;
     ns_list_init(&table_class->neighbour_list);
     ns_list_init(&table_class->free_list);
-    for (uint8_t i = 0; i < table_size; i++) {
+    ns_list_init(&table_class->nud_poll_list);
+    for (int i = 0; i < ARRAY_SIZE(table_class->wheel); i++)
+        ns_list_init(&table_class->wheel[i]);
+    for (uint16_t i = 0; i < table_size; i++) {
         memset(cur_ptr, 0, sizeof(mac_neighbor_table_entry_t));
         cur_ptr->index = i;
         //Add to list
@@ -65,6 +125,9 @@ void mac_neighbor_table_delete(mac_neighbor_table_t *table_class)
 static void neighbor_table_class_remove_entry(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *entry)
 {
     ns_list_remove(&table_class->neighbour_list, entry);
+    mac_neighbor_table_mac64_unlink(table_class, entry);
+    mac_neighbor_table_mac16_unlink(table_class, entry);
+    mac_neighbor_table_wheel_unlink(table_class, entry);
     table_class->neighbour_list_size--;
     if (entry->nud_active) {
         entry->nud_active = false;
@@ -76,7 +139,7 @@ static void neighbor_table_class_remove_entry(mac_neighbor_table_t *table_class,
     }
     topo_trace(TOPOLOGY_MLE, entry->mac64, TOPO_REMOVE);
 
-    uint8_t index = entry->index;
+    uint16_t index = entry->index;
     memset(entry, 0, sizeof(mac_neighbor_table_entry_t));
     entry->index = index;
     ns_list_add_to_end(&table_class->free_list, entry);
@@ -98,6 +161,8 @@ void mac_neighbor_table_neighbor_timeout_update(int time_update)
 {
     struct net_if *interface = protocol_stack_interface_info_get();
     mac_neighbor_table_t *table_class;
+    mac_neighbor_table_wheel_t *slot;
+    uint32_t start;
 
     if (!(interface->lowpan_info & INTERFACE_NWK_ACTIVE))
         return;
@@ -107,29 +172,69 @@ void mac_neighbor_table_neighbor_timeout_update(int time_update)
         return;
     }
 
-    ns_list_foreach_safe(mac_neighbor_table_entry_t, cur, &table_class->neighbour_list) {
-
-        if (cur->lifetime > time_update) {
-            if (cur->lifetime == 0xffffffff && cur->link_lifetime == 0xffffffff) {
-                continue; //Infinite Lifetime too not touch
-            }
-
-            cur->lifetime -= time_update;
-            if (!table_class->user_nud_notify_cb ||  table_class->active_nud_process > ACTIVE_NUD_PROCESS_MAX || cur->nud_active) {
+    start = table_class->time_now;
+    table_class->time_now += time_update;
+    // Only the slots of the elapsed seconds are visited, entries of a later
+    // round stay in place.
+    for (int i = 1; i <= MIN(time_update, MAC_NEIGHBOR_WHEEL_SIZE); i++) {
+        slot = &table_class->wheel[(start + i) % MAC_NEIGHBOR_WHEEL_SIZE];
+        ns_list_foreach_safe(mac_neighbor_table_entry_t, cur, slot) {
+            if (cur->wheel_deadline > table_class->time_now)
                 continue;
+            ns_list_remove(slot, cur);
+            cur->wheel_linked = false;
+            if (cur->expiry <= table_class->time_now) {
+                neighbor_table_class_remove_entry(table_class, cur);
+            } else {
+                // NUD threshold reached
+                ns_list_add_to_end(&table_class->nud_poll_list, cur);
+                cur->nud_polled = true;
+                mac_neighbor_table_wheel_insert(table_class, cur, cur->expiry);
             }
+        }
+    }
 
-            if (table_class->user_nud_notify_cb(cur, table_class->table_user_identifier)) {
-                table_class->active_nud_process++;
-                cur->nud_active = true;
-            }
-
-        } else {
-            neighbor_table_class_remove_entry(table_class, cur);
+    if (!table_class->user_nud_notify_cb)
+        return;
+    ns_list_foreach_safe(mac_neighbor_table_entry_t, cur, &table_class->nud_poll_list) {
+        if (table_class->active_nud_process > ACTIVE_NUD_PROCESS_MAX)
+            break;
+        if (cur->nud_active)
+            continue;
+        if (table_class->user_nud_notify_cb(cur, table_class->table_user_identifier)) {
+            table_class->active_nud_process++;
+            cur->nud_active = true;
         }
     }
 }
 
+void mac_neighbor_table_lifetime_set(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint32_t life_time)
+{
+    int64_t nud_start;
+
+    mac_neighbor_table_wheel_unlink(table_class, neighbor_entry);
+    if (life_time == 0xffffffff && neighbor_entry->link_lifetime == 0xffffffff)
+        return; //Infinite Lifetime too not touch
+
+    neighbor_entry->expiry = table_class->time_now + MIN(life_time, UINT32_MAX - table_class->time_now);
+    nud_start = (int64_t)neighbor_entry->expiry - neighbor_entry->link_lifetime + table_class->nud_threshold;
+    if (nud_start <= table_class->time_now) {
+        ns_list_add_to_end(&table_class->nud_poll_list, neighbor_entry);
+        neighbor_entry->nud_polled = true;
+        mac_neighbor_table_wheel_insert(table_class, neighbor_entry, neighbor_entry->expiry);
+    } else {
+        mac_neighbor_table_wheel_insert(table_class, neighbor_entry, MIN(nud_start, neighbor_entry->expiry));
+    }
+}
+
+uint32_t mac_neighbor_table_lifetime_get(const mac_neighbor_table_t *table_class, const mac_neighbor_table_entry_t *neighbor_entry)
+{
+    if (!neighbor_entry->wheel_linked)
+        return 0xffffffff;
+    if (neighbor_entry->expiry <= table_class->time_now)
+        return 0;
+    return neighbor_entry->expiry - table_class->time_now;
+}
 
 mac_neighbor_table_entry_t *mac_neighbor_table_entry_allocate(mac_neighbor_table_t *table_class, const uint8_t *mac64)
 {
@@ -146,12 +251,15 @@ mac_neighbor_table_entry_t *mac_neighbor_table_entry_allocate(mac_neighbor_table
     ns_list_add_to_end(&table_class->neighbour_list, entry);
     table_class->neighbour_list_size++;
     memcpy(entry->mac64, mac64, 8);
+    entry->mac64_hash_next = *mac_neighbor_table_mac64_bucket(table_class, mac64);
+    *mac_neighbor_table_mac64_bucket(table_class, mac64) = entry;
     entry->mac16 = 0xffff;
+    entry->in_use = true;
     entry->nud_active = false;
     entry->connected_device = false;
     entry->trusted_device = false;
-    entry->lifetime = NEIGHBOR_CLASS_LINK_DEFAULT_LIFETIME;
     entry->link_lifetime = NEIGHBOR_CLASS_LINK_DEFAULT_LIFETIME;
+    mac_neighbor_table_lifetime_set(table_class, entry, NEIGHBOR_CLASS_LINK_DEFAULT_LIFETIME);
     entry->link_role = NORMAL_NEIGHBOUR;
     entry->ms_mode = 0;
     topo_trace(TOPOLOGY_MLE, mac64, TOPO_ADD);
@@ -160,13 +268,12 @@ mac_neighbor_table_entry_t *mac_neighbor_table_entry_allocate(mac_neighbor_table
 
 static mac_neighbor_table_entry_t *neighbor_table_class_entry_validate(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry)
 {
-    ns_list_foreach(mac_neighbor_table_entry_t, cur, &table_class->neighbour_list) {
-        if (cur == neighbor_entry) {
-            return cur;
-        }
+    if (neighbor_entry < table_class->neighbor_entry_buffer ||
+        neighbor_entry >= table_class->neighbor_entry_buffer + table_class->list_total_size ||
+        !neighbor_entry->in_use) {
+        return NULL;
     }
-    return NULL;
-
+    return neighbor_entry;
 }
 
 void mac_neighbor_table_neighbor_remove(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry)
@@ -180,8 +287,8 @@ void mac_neighbor_table_neighbor_remove(mac_neighbor_table_t *table_class, mac_n
 
 void mac_neighbor_table_neighbor_refresh(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint32_t life_time)
 {
-    neighbor_entry->lifetime = life_time;
     neighbor_entry->link_lifetime = life_time;
+    mac_neighbor_table_lifetime_set(table_class, neighbor_entry, life_time);
     if (neighbor_entry->nud_active) {
         neighbor_entry->nud_active = false;
         table_class->active_nud_process--;
@@ -197,13 +304,27 @@ void mac_neighbor_table_neighbor_connected(mac_neighbor_table_t *table_class, ma
 
 void mac_neighbor_table_trusted_neighbor(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, bool trusted_device)
 {
-    (void)table_class;
     if (!neighbor_entry->trusted_device && trusted_device) {
-        neighbor_entry->lifetime = neighbor_entry->link_lifetime;
+        mac_neighbor_table_lifetime_set(table_class, neighbor_entry, neighbor_entry->link_lifetime);
     }
     neighbor_entry->trusted_device = trusted_device;
 }
 
+void mac_neighbor_table_mac16_set(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint16_t mac16)
+{
+    mac_neighbor_table_entry_t **bucket;
+
+    if (neighbor_entry->mac16 == mac16)
+        return;
+    mac_neighbor_table_mac16_unlink(table_class, neighbor_entry);
+    neighbor_entry->mac16 = mac16;
+    if (mac16 == 0xffff)
+        return;
+    bucket = mac_neighbor_table_mac16_bucket(table_class, mac16);
+    neighbor_entry->mac16_hash_next = *bucket;
+    *bucket = neighbor_entry;
+}
+
 mac_neighbor_table_entry_t *mac_neighbor_table_address_discover(mac_neighbor_table_t *table_class, const uint8_t *address, uint8_t address_type)
 {
     if (!table_class) {
@@ -218,12 +339,17 @@ mac_neighbor_table_entry_t *mac_neighbor_table_address_discover(mac_neighbor_tab
         return NULL;
     }
 
-    ns_list_foreach(mac_neighbor_table_entry_t, cur, &table_class->neighbour_list) {
-        if (address_type == ADDR_802_15_4_SHORT) {
-            if (cur->mac16 != 0xffff && cur->mac16 == short_address) {
+    if (address_type == ADDR_802_15_4_SHORT) {
+        if (short_address == 0xffff) {
+            return NULL;
+        }
+        for (mac_neighbor_table_entry_t *cur = *mac_neighbor_table_mac16_bucket(table_class, short_address); cur; cur = cur->mac16_hash_next) {
+            if (cur->mac16 == short_address) {
                 return cur;
             }
-        } else {
+        }
+    } else {
+        for (mac_neighbor_table_entry_t *cur = *mac_neighbor_table_mac64_bucket(table_class, address); cur; cur = cur->mac64_hash_next) {
             if (memcmp(cur->mac64, address, 8) == 0) {
                 return cur;
             }
@@ -233,15 +359,12 @@ mac_neighbor_table_entry_t *mac_neighbor_table_address_discover(mac_neighbor_tab
     return NULL;
 }
 
-mac_neighbor_table_entry_t *mac_neighbor_table_attribute_discover(mac_neighbor_table_t *table_class, uint8_t index)
+mac_neighbor_table_entry_t *mac_neighbor_table_attribute_discover(mac_neighbor_table_t *table_class, uint16_t index)
 {
-    ns_list_foreach(mac_neighbor_table_entry_t, cur, &table_class->neighbour_list) {
-
-        if (cur->index == index) {
-            return cur;
-        }
+    if (index >= table_class->list_total_size || !table_class->neighbor_entry_buffer[index].in_use) {
+        return NULL;
     }
-    return NULL;
+    return &table_class->neighbor_entry_buffer[index];
 }
 
 mac_neighbor_table_entry_t *mac_neighbor_entry_get_by_ll64(mac_neighbor_table_t *table_class, const uint8_t *ipv6Address, bool allocateNew, bool *new_entry_allocated)
@@ -26,6 +26,10 @@
 
 #define ACTIVE_NUD_PROCESS_MAX 3 //Limit That how many activate NUD process is active in same time
 
+#define MAC_NEIGHBOR_HASH_SIZE 64 //Number of buckets of the EUI-64 and short address indexes
+
+#define MAC_NEIGHBOR_WHEEL_SIZE 256 //Number of one second slots of the expiry timer wheel
+
 #define NORMAL_NEIGHBOUR                0
 #define SECONDARY_PARENT_NEIGHBOUR      1
 #define CHILD_NEIGHBOUR                 2
@@ -34,10 +38,11 @@
  * Generic Neighbor table entry
  */
 typedef struct mac_neighbor_table_entry {
-    uint8_t         index;                  /*!< Unique Neighbour index */
+    uint16_t        index;                  /*!< Unique Neighbour index */
     uint8_t         mac64[8];               /*!< MAC64 */
     uint16_t        mac16;                  /*!< MAC16 address for neighbor 0xffff when no 16-bit address is unknown */
-    uint32_t        lifetime;               /*!< Life time in seconds which goes down */
+    uint32_t        expiry;                 /*!< Table time at which the entry expires, see mac_neighbor_table_lifetime_get() */
+    uint32_t        wheel_deadline;         /*!< Table time of the next timer wheel event of this entry */
     uint32_t        link_lifetime;          /*!< Configured link timeout*/
     uint8_t         phy_mode_ids[16];       /*!< List of PhyModeId supported by this neighbor */
     uint8_t         phy_mode_id_count;      /*!< Number of PhyModeId in phy_mode_ids */
@@ -49,12 +54,21 @@ typedef struct mac_neighbor_table_entry {
     bool            connected_device: 1;    /*!< True Link is connected and data rx is accepted , False RX data is not accepted*/
     bool            trusted_device: 1;      /*!< True mean use normal group key, false for enable pairwise key */
     bool            nud_active: 1;          /*!< True Neighbor NUD process is active, false not active process */
+    bool            in_use: 1;              /*!< True when entry is in neighbour_list, false when in free_list */
+    bool            wheel_linked: 1;        /*!< True when entry is in the timer wheel (lifetime is not infinite) */
+    bool            nud_polled: 1;          /*!< True when entry is in nud_poll_list */
     unsigned        link_role: 2;           /*!< Link role: NORMAL_NEIGHBOUR, PRIORITY_PARENT_NEIGHBOUR, SECONDARY_PARENT_NEIGHBOUR, CHILD_NEIGHBOUR */
     uint8_t         node_role;
+    struct mac_neighbor_table_entry *mac64_hash_next; /*!< Next entry in the same EUI-64 hash bucket */
+    struct mac_neighbor_table_entry *mac16_hash_next; /*!< Next entry in the same short address hash bucket */
     ns_list_link_t  link;
+    ns_list_link_t  wheel_link;
+    ns_list_link_t  nud_link;
 } mac_neighbor_table_entry_t;
 
 typedef NS_LIST_HEAD(mac_neighbor_table_entry_t, link) mac_neighbor_table_list_t;
+typedef NS_LIST_HEAD(mac_neighbor_table_entry_t, wheel_link) mac_neighbor_table_wheel_t;
+typedef NS_LIST_HEAD(mac_neighbor_table_entry_t, nud_link) mac_neighbor_table_nud_list_t;
 
 /**
  * Remove entry notify
@@ -82,13 +96,18 @@ typedef bool neighbor_entry_nud_notify(mac_neighbor_table_entry_t *entry_ptr, vo
 typedef struct mac_neighbor_table {
     mac_neighbor_table_list_t neighbour_list;               /*!< List of active neighbors */
     mac_neighbor_table_list_t free_list;                    /*!< List of free neighbors entries */
-    uint32_t nud_threshold;                                 /*!< NUD threshold time which generates keep alive message */
-    uint8_t list_total_size;                                /*!< Total number allocated neighbor entries */
+    uint32_t nud_threshold;                                 /*!< Seconds since the last refresh before an entry is offered to user_nud_notify_cb */
+    uint32_t time_now;                                      /*!< Table time in seconds, advanced by mac_neighbor_table_neighbor_timeout_update() */
+    uint16_t list_total_size;                               /*!< Total number allocated neighbor entries */
     uint8_t active_nud_process;                             /*!< Indicate Active NUD Process */
-    uint8_t neighbour_list_size;                            /*!< Active Neighbor list size */
+    uint16_t neighbour_list_size;                           /*!< Active Neighbor list size */
     void *table_user_identifier;                            /*!< Table user identifier like interface pointer */
     neighbor_entry_remove_notify *user_remove_notify_cb;    /*!< Neighbor Remove Callback notify */
     neighbor_entry_nud_notify *user_nud_notify_cb;          /*!< Trig NUD process for neighbor */
+    mac_neighbor_table_entry_t *mac64_hash[MAC_NEIGHBOR_HASH_SIZE]; /*!< Active neighbors indexed by EUI-64 */
+    mac_neighbor_table_entry_t *mac16_hash[MAC_NEIGHBOR_HASH_SIZE]; /*!< Active neighbors indexed by short address */
+    mac_neighbor_table_wheel_t wheel[MAC_NEIGHBOR_WHEEL_SIZE];      /*!< Active neighbors with a finite lifetime, slotted by wheel_deadline */
+    mac_neighbor_table_nud_list_t nud_poll_list;            /*!< Active neighbors past nud_threshold */
     mac_neighbor_table_entry_t neighbor_entry_buffer[];     /*!< Pointer for allocated neighbor table entries*/
 } mac_neighbor_table_t;
 
@@ -107,7 +126,7 @@ typedef struct mac_neighbor_table {
  * \return NULL when memory allocation happen
  *
  */
-mac_neighbor_table_t *mac_neighbor_table_create(uint8_t table_size, neighbor_entry_remove_notify *remove_cb, neighbor_entry_nud_notify *nud_cb, void *user_indentifier);
+mac_neighbor_table_t *mac_neighbor_table_create(uint16_t table_size, neighbor_entry_remove_notify *remove_cb, neighbor_entry_nud_notify *nud_cb, void *user_indentifier);
 
 /**
  * mac_neighbor_table_delete Delete Neigbor table class
@@ -160,6 +179,28 @@ void mac_neighbor_table_neighbor_remove(mac_neighbor_table_t *table_class, mac_n
  */
 void mac_neighbor_table_neighbor_refresh(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint32_t life_time);
 
+/**
+ * mac_neighbor_table_lifetime_set Restart the remaining lifetime of a neighbor
+ *
+ * Set link_lifetime before calling this function as the NUD threshold is
+ * relative to it.
+ *
+ * \param table_class pointer to table class
+ * \param neighbor_entry pointer to updated entry
+ * \param life_time remaining lifetime in seconds, 0xffffffff with an infinite link_lifetime never expires
+ */
+void mac_neighbor_table_lifetime_set(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint32_t life_time);
+
+/**
+ * mac_neighbor_table_lifetime_get Get the remaining lifetime of a neighbor
+ *
+ * \param table_class pointer to table class
+ * \param neighbor_entry pointer to entry
+ *
+ * \return remaining lifetime in seconds, 0xffffffff for an infinite lifetime
+ */
+uint32_t mac_neighbor_table_lifetime_get(const mac_neighbor_table_t *table_class, const mac_neighbor_table_entry_t *neighbor_entry);
+
 /**
  * mac_neighbor_table_neighbor_connected Mark neighbour connected state and data is accepted from device
  *
@@ -181,6 +222,18 @@ void mac_neighbor_table_neighbor_connected(mac_neighbor_table_t *table_class, ma
  */
 void mac_neighbor_table_trusted_neighbor(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, bool trusted_device);
 
+/**
+ * mac_neighbor_table_mac16_set Set the 16-bit MAC address of a neighbor
+ *
+ * Use this instead of writing mac16 directly so the short address index stays
+ * consistent.
+ *
+ * \param table_class pointer to table class
+ * \param neighbor_entry pointer to updated entry
+ * \param mac16 16-bit MAC address, 0xffff when unknown
+ */
+void mac_neighbor_table_mac16_set(mac_neighbor_table_t *table_class, mac_neighbor_table_entry_t *neighbor_entry, uint16_t mac16);
+
 /**
  * mac_neighbor_table_address_discover Discover neighbor from list by address
  *
@@ -200,7 +253,7 @@ mac_neighbor_table_entry_t *mac_neighbor_table_address_discover(mac_neighbor_tab
  *
  *  \return pointer to discover neighbor entry if it exist
  */
-mac_neighbor_table_entry_t *mac_neighbor_table_attribute_discover(mac_neighbor_table_t *table_class, uint8_t index);
+mac_neighbor_table_entry_t *mac_neighbor_table_attribute_discover(mac_neighbor_table_t *table_class, uint16_t index);
 
 mac_neighbor_table_entry_t *mac_neighbor_entry_get_by_ll64(mac_neighbor_table_t *table_class, const uint8_t *ipv6Address, bool allocateNew, bool *new_entry_allocated);
 
@@ -68,9 +68,9 @@ typedef struct bbr_route_info {
  * \brief Struct bbr_radius_timing_t is RADIUS timing configuration structure.
  */
 typedef struct bbr_radius_timing {
-    /** RADIUS retry timer Imin; in 100ms units; range 1-1200; default 20 (2 seconds) */
+    /** RADIUS minimum retry timeout; in 100ms units; range 1-1200; default 20 (2 seconds) */
     uint16_t radius_retry_imin;
-    /** RADIUS retry timer Imax; in 100ms units; range 1-1200; default 30 (3 seconds) */
+    /** RADIUS retry timeout until a round-trip time is measured; in 100ms units; range 1-1200; default 30 (3 seconds) */
     uint16_t radius_retry_imax;
     /** RADIUS retry count; default 3 */
     uint8_t radius_retry_count;
@@ -235,6 +235,22 @@ int ws_bbr_node_access_revoke_start(int8_t interface_id, bool is_lgtk, uint8_t n
  */
 int ws_bbr_eapol_node_limit_set(int8_t interface_id, uint16_t limit);
 
+/**
+ * Set EAPOL authentication limits
+ *
+ * Supplicants joining when a limit is reached wait until an ongoing
+ * authentication completes. Supplicants with a PMK only need a 4-way handshake
+ * and are admitted before the ones needing a full EAP-TLS authentication.
+ *
+ * \param interface_id Network interface ID.
+ * \param full_auth_max Max number of ongoing EAP-TLS authentications, 0 for no limit.
+ * \param key_auth_max Max number of ongoing 4WH/GKH of supplicants with a PMK, 0 for no limit.
+ *
+ * \return 0, Limits set
+ * \return <0 Limits set failed.
+ */
+int ws_bbr_eapol_auth_limit_set(int8_t interface_id, uint16_t full_auth_max, uint16_t key_auth_max);
+
 /**
  * Extended certificate validation
  */
@@ -467,6 +483,22 @@ int ws_bbr_radius_timing_get(int8_t interface_id, bbr_radius_timing_t *timing);
  */
 int ws_bbr_radius_timing_validate(int8_t interface_id, bbr_radius_timing_t *timing);
 
+/**
+ * Set RADIUS request window
+ *
+ * Function sets the maximum number of RADIUS Access-Requests waiting for a
+ * response. Further requests are queued until a response is received or a
+ * request times out.
+ *
+ * \param interface_id Network interface ID.
+ * \param window Number of requests; range 1-255; default 32.
+ *
+ * \return < 0 failure
+ * \return >= 0 success
+ *
+ */
+int ws_bbr_radius_window_set(int8_t interface_id, uint8_t window);
+
 /**
  * \brief A function to set DNS query results to border router
  *
@@ -499,4 +531,18 @@ int ws_bbr_set_phy_operating_modes(int8_t interface_id, uint8_t * phy_operating_
 
 int ws_bbr_set_mode_switch(int8_t interface_id, int mode, uint8_t phy_mode_id, uint8_t * neighbor_mac_address);
 
+/**
+ * \brief Callback called when the nodes known by the border router may have
+ * changed: supplicants authenticated or removed, or RPL downward routes
+ * updated.
+ */
+typedef void ws_bbr_nodes_changed_cb(void);
+
+/**
+ * \brief Set the function notified of the changes of the nodes.
+ *
+ * \param cb Callback, NULL to disable the notifications.
+ */
+void ws_bbr_nodes_changed_cb_set(ws_bbr_nodes_changed_cb *cb);
+
 #endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023 Silicon Laboratories Inc. (www.silabs.com)
+ *
+ * The licensor of this software is Silicon Laboratories Inc. Your use of this
+ * software is governed by the terms of the Silicon Labs Master Software License
+ * Agreement (MSLA) available at [1].  This software is distributed to you in
+ * Object Code format and/or Source Code format and is governed by the sections
+ * of the MSLA applicable to Object Code, Source Code and Modified Open Source
+ * Code. By using this software, you agree to the terms of the MSLA.
+ *
+ * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
+ */
+/*
+ * Check that struct ieee802154_ie_index answers exactly like the linear
+ * ieee802154_ie_find_*() functions. The input file is used as a raw IE list
+ * and parsed as header, payload and nested IEs. Any difference aborts.
+ *
+ *     afl-fuzz -i in/ -o out/ -- wsbrd-fuzz-ie @@
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "common/ieee802154_ie.h"
+#include "common/iobuf.h"
+#include "common/log.h"
+
+static int ie_fuzz_find(uint8_t type, const uint8_t *data, size_t len, uint8_t id, bool is_long,
+                        struct iobuf_read *ie_content)
+{
+    switch (type) {
+    case IEEE802154_IE_INDEX_HEADER:
+        return ieee802154_ie_find_header(data, len, id, ie_content);
+    case IEEE802154_IE_INDEX_PAYLOAD:
+        return ieee802154_ie_find_payload(data, len, id, ie_content);
+    default:
+        return ieee802154_ie_find_nested(data, len, id, ie_content, is_long);
+    }
+}
+
+static void ie_fuzz_compare(int ret_ref, const struct iobuf_read *ref, int ret, const struct iobuf_read *val)
+{
+    BUG_ON(ret_ref != ret, "return value %d != %d", ret, ret_ref);
+    BUG_ON(ref->err != val->err);
+    BUG_ON(ref->data != val->data);
+    BUG_ON(ref->data_size != val->data_size);
+    BUG_ON(ref->cnt != val->cnt);
+}
+
+static void ie_fuzz_check(uint8_t type, const uint8_t *data, size_t len, uint8_t id, bool is_long)
+{
+    struct ieee802154_ie_index index;
+    struct iobuf_read ref, val;
+    const uint8_t *ptr = data;
+    int ret_ref, ret;
+
+    switch (type) {
+    case IEEE802154_IE_INDEX_HEADER:
+        ieee802154_ie_index_header(&index, data, len);
+        ret = ieee802154_ie_index_find(&index, id, &val);
+        break;
+    case IEEE802154_IE_INDEX_PAYLOAD:
+        ieee802154_ie_index_payload(&index, data, len);
+        ret = ieee802154_ie_index_find(&index, id, &val);
+        break;
+    default:
+        ieee802154_ie_index_nested(&index, data, len);
+        ret = ieee802154_ie_index_find_nested(&index, id, &val, is_long);
+        break;
+    }
+    ret_ref = ie_fuzz_find(type, data, len, id, is_long, &ref);
+    ie_fuzz_compare(ret_ref, &ref, ret, &val);
+
+    // Walk the following occurrences the way ws_wh_find_subid() does
+    while (!ref.err) {
+        len -= ref.data + ref.data_size - ptr;
+        ptr = ref.data + ref.data_size;
+        ret_ref = ie_fuzz_find(type, ptr, len, id, is_long, &ref);
+        ret = ieee802154_ie_index_find_next(&index, &val);
+        ie_fuzz_compare(ret_ref, &ref, ret, &val);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t data[4096];
+    FILE *file = stdin;
+    size_t len;
+
+    if (argc > 1) {
+        file = fopen(argv[1], "rb");
+        FATAL_ON(!file, 2, "fopen %s: %m", argv[1]);
+    }
+    len = fread(data, 1, sizeof(data), file);
+    if (file != stdin)
+        fclose(file);
+
+    for (int id = 0; id < 256; id++) {
+        ie_fuzz_check(IEEE802154_IE_INDEX_HEADER, data, len, id, false);
+        ie_fuzz_check(IEEE802154_IE_INDEX_PAYLOAD, data, len, id, false);
+        ie_fuzz_check(IEEE802154_IE_INDEX_NESTED, data, len, id, false);
+        ie_fuzz_check(IEEE802154_IE_INDEX_NESTED, data, len, id, true);
+    }
+    return 0;
+}
@@ -10,6 +10,7 @@
  *
  * [1]: https:www.silabs.com/about-us/legal/master-software-license-agreement
  */
+#define _GNU_SOURCE
 #include <stdint.h>
 #include <assert.h>
 #include <unistd.h>
@@ -225,6 +226,46 @@ ssize_t __wrap_recvfrom(int sockfd, void *buf, size_t len, int flags, struct soc
     return size;
 }
 
+int __real_recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout);
+int __wrap_recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout)
+{
+    struct sockaddr_in6 *src_ipv6;
+    struct msghdr *hdr;
+    ssize_t size;
+    int ret;
+
+    if (g_fuzz_ctxt.replay_count) {
+        // Replayed frames are read one by one from a pipe
+        hdr = &msgvec[0].msg_hdr;
+        BUG_ON(hdr->msg_iovlen != 1);
+        hdr->msg_controllen = 0;
+        size = __wrap_recvfrom(sockfd, hdr->msg_iov[0].iov_base, hdr->msg_iov[0].iov_len, flags,
+                               hdr->msg_name, &hdr->msg_namelen);
+        if (size < 0)
+            return size;
+        msgvec[0].msg_len = size;
+        return 1;
+    }
+
+    ret = __real_recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+    if (g_fuzz_ctxt.capture_fd >= 0) {
+        for (int i = 0; i < ret; i++) {
+            hdr = &msgvec[i].msg_hdr;
+            src_ipv6 = hdr->msg_name;
+            BUG_ON(hdr->msg_iovlen != 1);
+            if (src_ipv6) {
+                BUG_ON(src_ipv6->sin6_family != AF_INET6);
+                fuzz_capture_socket(sockfd, src_ipv6->sin6_addr.s6_addr, ntohs(src_ipv6->sin6_port),
+                                    hdr->msg_iov[0].iov_base, msgvec[i].msg_len);
+            } else {
+                fuzz_capture_socket(sockfd, ADDR_UNSPECIFIED, 0,
+                                    hdr->msg_iov[0].iov_base, msgvec[i].msg_len);
+            }
+        }
+    }
+    return ret;
+}
+
 int __real_socket(int domain, int type, int protocol);
 int __wrap_socket(int domain, int type, int protocol)
 {
@@ -280,3 +321,16 @@ ssize_t __wrap_sendmsg(int sockfd, const struct msghdr *msg, int flags)
         return __real_sendmsg(sockfd, msg, flags);
     }
 }
+
+int __real_sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int __wrap_sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+    if (!g_fuzz_ctxt.replay_count)
+        return __real_sendmmsg(sockfd, msgvec, vlen, flags);
+    for (int i = 0; i < vlen; i++) {
+        msgvec[i].msg_len = 0;
+        for (int j = 0; j < msgvec[i].msg_hdr.msg_iovlen; j++)
+            msgvec[i].msg_len += msgvec[i].msg_hdr.msg_iov[j].iov_len;
+    }
+    return vlen;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 Silicon Laboratories Inc. (www.silabs.com)
+ *
+ * The licensor of this software is Silicon Laboratories Inc. Your use of this
+ * software is governed by the terms of the Silicon Labs Master Software License
+ * Agreement (MSLA) available at [1].  This software is distributed to you in
+ * Object Code format and/or Source Code format and is governed by the sections
+ * of the MSLA applicable to Object Code, Source Code and Modified Open Source
+ * Code. By using this software, you agree to the terms of the MSLA.
+ *
+ * [1]: https://www.silabs.com/about-us/legal/master-software-license-agreement
+ */
+/*
+ * Render a trace ring dump written by wsbrd (on SIGUSR1 or on crash) using the
+ * same text format than the traces.
+ *
+ *     wsbrd-trace-decode /var/lib/wsbrd/trace-ring
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "common/log.h"
+#include "common/utils.h"
+
+void print_help(FILE *stream, int exit_code)
+{
+    fprintf(stream, "Usage:\n");
+    fprintf(stream, "  wsbrd-trace-decode [FILE]\n");
+    fprintf(stream, "\n");
+    fprintf(stream, "Decode a binary trace ring dumped by wsbrd. Read standard input if FILE is not\n");
+    fprintf(stream, "given.\n");
+    exit(exit_code);
+}
+
+int main(int argc, char *argv[])
+{
+    struct trace_ring_header hdr;
+    struct trace_ring_entry entry;
+    FILE *file = stdin;
+    char line[1024];
+    char *fmt;
+
+    if (argc > 2 || (argc == 2 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))))
+        print_help(argc > 2 ? stderr : stdout, argc > 2 ? 1 : 0);
+    if (argc == 2) {
+        file = fopen(argv[1], "rb");
+        FATAL_ON(!file, 2, "fopen %s: %m", argv[1]);
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1)
+        FATAL(1, "truncated header");
+    if (memcmp(hdr.magic, TRACE_RING_MAGIC, sizeof(hdr.magic)))
+        FATAL(1, "not a trace ring dump");
+    if (hdr.version != TRACE_RING_VERSION)
+        FATAL(1, "unsupported version %u", hdr.version);
+    if (hdr.entry_size != sizeof(entry))
+        FATAL(1, "unsupported entry size %u", hdr.entry_size);
+    // Guarantee the last message is terminated
+    fmt = calloc(1, hdr.fmt_size + 1);
+    FATAL_ON(!fmt, 2, "%s: %m", __func__);
+    if (fread(fmt, 1, hdr.fmt_size, file) != hdr.fmt_size)
+        FATAL(1, "truncated messages");
+
+    for (uint32_t i = 0; i < hdr.entry_count; i++) {
+        if (fread(&entry, sizeof(entry), 1, file) != 1)
+            FATAL(1, "truncated entry %u", i);
+        if (entry.fmt >= hdr.fmt_size || entry.argc > TRACE_RING_ARGS) {
+            printf("%6u.%03u: <corrupted entry>\n", entry.time_s, entry.time_ns / 1000000);
+            continue;
+        }
+        trace_ring_format(line, sizeof(line), fmt + entry.fmt, entry.args, entry.argc);
+        printf("%6u.%03u: %s\n", entry.time_s, entry.time_ns / 1000000, line);
+    }
+    free(fmt);
+    if (file != stdin)
+        fclose(file);
+    return 0;
+}